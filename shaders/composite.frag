@@ -0,0 +1,13 @@
+#version 330 core
+in vec4  v_color;
+in vec2  v_uv;
+flat in float v_layer;
+
+layout(location = 0) out vec4 f_color;
+uniform sampler2D u_image;
+
+void main() {
+	// Render caches are stored premultiplied and blended with (ONE, ONE_MINUS_SRC_ALPHA)
+	vec2 uv = v_uv / vec2(textureSize(u_image, 0));
+	f_color = texture(u_image, uv) * v_color.a;
+}
@@ -1,12 +1,14 @@
 #version 330 core
 in vec4  v_color;
 in vec2  v_uv;
-in float v_texindex;
+flat in float v_layer;
 
 layout(location = 0) out vec4 f_color;
-uniform sampler2D u_tex[8];
+uniform sampler2DArray u_atlas;
 
 void main() {
-	vec4 sampled = texture(u_tex[int(v_texindex)], v_uv);
+	// UVs come in as texels so atlases can grow without touching the batch
+	vec2 uv = v_uv / vec2(textureSize(u_atlas, 0).xy);
+	vec4 sampled = texture(u_atlas, vec3(uv, v_layer));
 	f_color = vec4(v_color.rgb, v_color.a * sampled.r);
-}
\ No newline at end of file
+}
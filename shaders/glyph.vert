@@ -1,17 +1,26 @@
 #version 330 core
+// Positions arrive as whole pixels, UVs as texels and the color is
+// normalized from RGBA8 by the attribute setup (see Render_Vertex)
 layout (location = 0) in vec2  a_pos;
 layout (location = 1) in vec4  a_color;
 layout (location = 2) in vec2  a_uv;
-layout (location = 3) in float a_texindex;
+layout (location = 3) in float a_layer;
+layout (location = 4) in uint  a_palette;
 
 out vec4  v_color;
 out vec2  v_uv;
-out float v_texindex;
+flat out float v_layer;
 uniform mat4 u_proj;
+uniform vec2 u_translate; // offset of retained layers, zero for the batch
+
+// The ColorTheme, a_palette - 1 indexes it (see THEME_PALETTE)
+layout (std140) uniform Palette {
+    vec4 u_palette[16];
+};
 
 void main() {
-    gl_Position = u_proj * vec4(a_pos, 0.0, 1.0);
-    v_texindex = a_texindex;
+    gl_Position = u_proj * vec4(a_pos + u_translate, 0.0, 1.0);
+    v_layer = a_layer;
     v_uv = a_uv;
-    v_color = a_color;
+    v_color = a_palette > 0u ? u_palette[a_palette - 1u] * a_color : a_color;
 }
@@ -0,0 +1,23 @@
+#version 330 core
+in vec4  v_color;
+in vec2  v_uv;
+flat in float v_layer;
+
+layout(location = 0) out vec4 f_color;
+uniform sampler2DArray u_atlas;
+
+// Distance in atlas pixels encoded by FreeType around each glyph
+uniform float u_sdf_spread;
+// Drawn size / rasterized size of the font
+uniform float u_sdf_scale;
+
+void main() {
+	vec2 uv = v_uv / vec2(textureSize(u_atlas, 0).xy);
+	vec4 sampled = texture(u_atlas, vec3(uv, v_layer));
+
+	// FreeType stores 128 on the outline, positive values inside the glyph.
+	// Convert to a distance in screen pixels and use it as coverage.
+	float sd = (sampled.r * 255.0 - 128.0) / 128.0 * u_sdf_spread;
+	float alpha = clamp(sd * u_sdf_scale + 0.5, 0.0, 1.0);
+	f_color = vec4(v_color.rgb, v_color.a * alpha);
+}
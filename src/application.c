@@ -8,113 +8,82 @@
 #define REGISTER_COMMAND(app, command) \
     applicationRegisterCommand(app, #command, Command_##command);
 
-static bool isCommandForMode(EditorMode mode, CommandType command_type) {
-    if (command_type == COMMAND_TYPE_GLOBAL)
-        return true;
+/* BEGIN GLFW CALLBACKS */
 
-    switch (mode) {
-        case EDITOR_MODE_SAVE:
-            return (command_type == COMMAND_TYPE_SAVE_DIALOG);
-        case EDITOR_MODE_NORMAL:
-            return (command_type == COMMAND_TYPE_EDITOR);
-        case EDITOR_MODE_OPEN:
-            return (command_type == COMMAND_TYPE_BROWSER);
-        default:
-            return false;
+static void queueInput(Application *app, InputEvent event) {
+    if (app->input_event_count == MAX_INPUT_EVENTS) {
+        applicationProcessInput(app);
     }
+    app->input_events[app->input_event_count++] = event;
 }
 
-/* BEGIN GLFW CALLBACKS */
-
 void key_callback(GLFWwindow* window, int key, int scancode, int action , int mods) {
     UNUSED(scancode);
-    UNUSED(mods);
-
     Application *app = glfwGetWindowUserPointer(window);
-
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        applicationProcessEditorInput(app, key, scancode, action, mods);
-    }
-
-    if (action == GLFW_REPEAT || action == GLFW_PRESS) {
-        for (size_t i = 0; i < app->numKeybinds; ++i) {
-            if (app->keybinds[i].key == key && app->keybinds[i].mods == mods && isCommandForMode(app->editor.mode, app->keybinds[i].type)) {
-                app->keybinds[i].command(app);
-                break;
-            }
-        }
-    }
+    queueInput(app, (InputEvent) { .type = INPUT_KEY, .key = key, .action = action, .mods = mods });
 }
 
 void character_callback(GLFWwindow* window, unsigned int codepoint) {
     Application *app = glfwGetWindowUserPointer(window);
-
-    // TODO: keep track of the last character that the user entered,
-    // If they reflexively try to complete these pairs, we should ignore
-    // the second character
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        switch (codepoint) {
-        case '{':
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-            editorInsertCharacter(&app->editor, '}', false);
-            break;
-        case '(':
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-            editorInsertCharacter(&app->editor, ')', false);
-            break;
-        case '\'':
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-            editorInsertCharacter(&app->editor, '\'', false);
-            break;
-        case '"':
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-            editorInsertCharacter(&app->editor, '"', false);
-            break;
-        case '[':
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-            editorInsertCharacter(&app->editor, ']', false);
-            break;
-        default:
-            editorInsertCharacter(&app->editor, (char)codepoint, true);
-        }
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
-        dialogInsertCharacter(&app->editor.sd, (char)codepoint);
-    }
+    queueInput(app, (InputEvent) { .type = INPUT_CHAR, .codepoint = codepoint });
 }
 
 void mouseMoveCallback(GLFWwindow *window, double xpos, double ypos) {
     Application *app = glfwGetWindowUserPointer(window);
-    if (app->mouse_held) {
-        moveCursorToMousePos(&app->editor, &app->ctx, vec2_init(xpos, ypos));
-        editorMakeSelection(&app->editor);
-    } 
+    queueInput(app, (InputEvent) { .type = INPUT_MOUSE_MOVE, .pos = vec2_init(xpos, ypos) });
 }
 
 void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
     Application *app = glfwGetWindowUserPointer(window);
+    f64 mouse_x = 0.0;
+    f64 mouse_y = 0.0;
+    glfwGetCursorPos(window, &mouse_x, &mouse_y);
+    queueInput(app, (InputEvent) { .type = INPUT_MOUSE_BUTTON, .key = button, .action = action, .mods = mods, .pos = vec2_init(mouse_x, mouse_y) });
+}
 
+static void applicationUpdateFontContext(Application *app, u32 font_id) {
+    app->ctx.font_id = font_id;
+    app->ctx.glyph_adv = app->renderer.glyph_adv;
+    app->ctx.line_height = app->renderer.font_atlases[font_id].line_height;
+    app->ctx.descender = app->renderer.descender;
+}
 
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        app->mouse_held = true;
-        f64 mouse_x = 0.0;
-        f64 mouse_y = 0.0;
-        glfwGetCursorPos(app->window, &mouse_x, &mouse_y);
-        moveCursorToMousePos(&app->editor, &app->ctx, vec2_init(mouse_x, mouse_y));
+// Runs on the render thread, fonts live in its GL context
+static void zoomFont(void *arg) {
+    Application *app = (Application *)arg;
+    u32 font_id = app->ctx.font_id;
+    if (app->renderer.font_atlases[font_id].format == GLYPH_ATLAS_SDF) {
+        rendererSetFontSize(&app->renderer, font_id, app->font_size);
+    } else {
+        // Bitmap fonts have to be rasterized again at the new size
+        u32 new_id = rendererLoadFont(&app->renderer, app->config.font_path, app->font_size);
+        if (new_id != font_id) {
+            rendererReleaseFont(&app->renderer, font_id);
+        }
+        font_id = new_id;
+    }
+    applicationUpdateFontContext(app, font_id);
+}
 
-        // Selection
-        if ((mods & GLFW_MOD_SHIFT) == GLFW_MOD_SHIFT)
-            editorMakeSelection(&app->editor);
-        else
-            editorUnselectSelection(&app->editor);
-    } else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
-        app->mouse_held = false;
+static void applicationZoom(Application *app, i32 delta) {
+    i32 size = (i32)app->font_size + delta;
+    size = MAX(MIN_FONT_SIZE, MIN(MAX_FONT_SIZE, size));
+    if ((u32)size == app->font_size) {
+        return;
     }
+    app->font_size = size;
+    renderThreadCall(&app->render_thread, zoomFont, app);
 }
 
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
     UNUSED(xoffset);
     Application *app = glfwGetWindowUserPointer(window);
-    scrollWithMouseWheel(&app->editor, &app->ctx, yoffset);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS) {
+        applicationZoom(app, yoffset > 0 ? 1 : -1);
+        return;
+    }
+    scrollWithMouseWheel(app->editor, &app->ctx, yoffset);
 }
 
 void cursorEnterCallback(GLFWwindow *window, int entered) {
@@ -127,37 +96,142 @@ void cursorEnterCallback(GLFWwindow *window, int entered) {
 }
 
 void resize_window(GLFWwindow *window, int width, int height) {
-   Application *app = glfwGetWindowUserPointer(window);
-   rendererResizeWindow(&app->renderer, width, height);
+    Application *app = glfwGetWindowUserPointer(window);
 
-    app->ctx.screen_width = app->renderer.screen_width;
-    app->ctx.screen_height = app->renderer.screen_height;
+    // The render thread resizes the renderer when it draws a frame of the new size
+    app->ctx.screen_width = (f32)width;
+    app->ctx.screen_height = (f32)height;
+}
+
+static u32 commandSlot(const char *name) {
+    return (u32)fnv1a(FNV_OFFSET_BASIS, name, strlen(name)) & (COMMAND_SLOTS - 1);
+}
+
+// Open addressed, the slot of name or the empty one it would go in
+static u8 *findCommandSlot(Application *app, const char *name) {
+    u32 slot = commandSlot(name);
+    while (app->command_slots[slot] != 0 && strcmp(app->commands[app->command_slots[slot] - 1].name, name) != 0) {
+        slot = (slot + 1) & (COMMAND_SLOTS - 1);
+    }
+    return &app->command_slots[slot];
 }
 
 void applicationRegisterCommand(Application *app, char *name, void (*command)()) {
-    if (app->numCommands < MAX_COMMANDS) {
+    u8 *slot = findCommandSlot(app, name);
+    if (*slot == 0 && app->numCommands < MAX_COMMANDS) {
         app->commands[app->numCommands++] = (Command) { name, command };
+        *slot = (u8)app->numCommands;
+    }
+}
+
+// Binds the keys of the config, in place of the bindings there were
+static void bindKeys(Application *app) {
+    keymapClear(&app->keymap);
+    for (size_t i = 0; i < app->config.numCommandConfigs; i++) {
+        CommandConfig *command = &app->config.commandConfigs[i];
+        applicationBindKey(app, command->keys, command->key_count, command->command_name, command->mode);
     }
 }
 
-void applicationBindKey(Application *app, int key, int mods, const char *commandName, CommandType type) {
-    for (size_t i = 0; i < app->numCommands; i++) {
-        if (strcmp(app->commands[i].name, commandName) == 0) {
-            app->keybinds[app->numKeybinds++] = (KeyBind){key, mods, app->commands[i].command, type};
-            return;
+void applicationBindKey(Application *app, const KeyStroke *keys, u32 key_count, const char *commandName, CommandType type) {
+    u8 slot = *findCommandSlot(app, commandName);
+    if (slot == 0) {
+        LOG_ERROR("Cannot bind command \'%s\' - command not found.", commandName);
+        return;
+    }
+    if (!keymapBind(&app->keymap, keys, key_count, app->commands[slot - 1].command, type)) {
+        char chord[MAX_CHORD_KEYS * 64] = "";
+        for (u32 i = 0; i < key_count; i++) {
+            char stroke[64];
+            keyStrokeToString(keys[i], stroke, sizeof(stroke));
+            if (i > 0) {
+                strncat(chord, " ", sizeof(chord) - strlen(chord) - 1);
+            }
+            strncat(chord, stroke, sizeof(chord) - strlen(chord) - 1);
         }
+        LOG_WARN("Not binding \'%s\' to %s, the keys or a prefix of them are bound already.", commandName, chord);
     }
-    LOG_ERROR("Cannot bind command \'%s\' - command not found.", commandName);
 }
 
 /* END GLFW CALLBACKS */
 
+/* RENDER THREAD */
+
+static void makeContextCurrent(void *arg) {
+    Application *app = (Application *)arg;
+    glfwMakeContextCurrent(app->window);
+}
+
+static void releaseContext(void *arg) {
+    UNUSED(arg);
+    glfwMakeContextCurrent(NULL);
+}
+
+static void renderFrame(void *user, u32 slot) {
+    Application *app = (Application *)user;
+    Frame *frame = &app->frames[slot];
+    AppContext *ctx = &frame->views[frame->focused_view].ctx;
+    GlyphAtlas *atlas = &app->renderer.font_atlases[ctx->font_id];
+
+    f64 now = glfwGetTime();
+    f64 delta_time = now - app->last_render_time;
+    app->last_render_time = now;
+
+    profilerBeginFrame();
+    profilerAddPhases(frame->phase_time);
+    profilerSetQueuedTasks(frame->tasks_queued);
+
+    if (ctx->screen_width != app->renderer.screen_width || ctx->screen_height != app->renderer.screen_height) {
+        rendererResizeWindow(&app->renderer, (i32)ctx->screen_width, (i32)ctx->screen_height);
+    }
+
+    profilerBeginPhase(PROFILE_BUILD);
+    profilerBeginGpu();
+    rendererBegin(&app->renderer);
+        
+    // Render stuff goes here
+    renderEditor(&app->renderer, frame->views, frame->view_count, frame->focused_view, frame->theme);
+
+    // Draw the status message
+    if (frame->status_message[0]) {
+        vec2 status_pos = vec2_init(ctx->glyph_adv, 5.0);
+        renderText(&app->renderer, frame->status_message, &status_pos, atlas, frame->theme.foreground);
+    }
+
+    // Draw FPS counter
+    if (frame->show_fps) {
+        f64 fps = 1.0f / delta_time;
+        char fps_str[200];
+        sprintf(fps_str, "FPS: %f", fps);
+        vec2 fps_pos = vec2_init(app->renderer.screen_width - (app->renderer.glyph_adv * 10.0), ctx->line_height * 2);
+        renderText(&app->renderer, fps_str, &fps_pos, atlas, COLOR_RED);
+    }
+
+    profilerRender(&app->renderer, atlas, ctx->line_height);
+
+    rendererEnd(&app->renderer);
+    profilerEndGpu();
+    profilerEndPhase(PROFILE_BUILD);
+
+    profilerBeginPhase(PROFILE_SWAP);
+    glfwSwapBuffers(app->window);
+    profilerEndPhase(PROFILE_SWAP);
+    profilerEndFrame(app->renderer.stats);
+}
+
+/* END RENDER THREAD */
+
 void applicationInit(Application *app, int argc, char **argv) {
     app->status_message = NULL;
     app->status_disp_time = 0.0f;
     app->mouse_held = false;
+    app->input_event_count = 0;
+    app->typed_len = 0;
+    app->typed_closers_len = 0;
     app->numCommands = 0;
-    app->numKeybinds = 0;
+    memset(app->command_slots, 0, sizeof(app->command_slots));
+    keymapClear(&app->keymap);
+    app->drop_char = false;
 
     REGISTER_COMMAND(app, moveRight);
     REGISTER_COMMAND(app, selectRight);
@@ -196,6 +270,16 @@ void applicationInit(Application *app, int argc, char **argv) {
     REGISTER_COMMAND(app, submitSaveDialog);
 
     REGISTER_COMMAND(app, openNewFile);
+    REGISTER_COMMAND(app, toggleProfiler);
+
+    REGISTER_COMMAND(app, nextBuffer);
+    REGISTER_COMMAND(app, previousBuffer);
+    REGISTER_COMMAND(app, closeBuffer);
+
+    REGISTER_COMMAND(app, splitHorizontal);
+    REGISTER_COMMAND(app, splitVertical);
+    REGISTER_COMMAND(app, nextPane);
+    REGISTER_COMMAND(app, closePane);
 
     // Initialize glfw
     if (!glfwInit()) {
@@ -224,33 +308,25 @@ void applicationInit(Application *app, int argc, char **argv) {
     LOG_INFO("OpenGL ver. %s", glGetString(GL_VERSION));
 
     app->config = configInit();
-    loadConfigFromFile(&app->config, "./config/config.toml");
-
-    // bind hotkeys
-    for (size_t i = 0; i < app->config.numCommandConfigs; i++) {
-        int key =  app->config.commandConfigs[i].key;
-        int mods =  app->config.commandConfigs[i].mods;
-        CommandType type = app->config.commandConfigs[i].mode;
-        char *commandName = (char *)malloc(sizeof(char) * (strlen(app->config.commandConfigs[i].command_name) + 1));
-        strcpy(commandName, app->config.commandConfigs[i].command_name);
-        applicationBindKey(app, key, mods, commandName, type);
-        free(commandName);
-    }
+    loadConfigFromFile(&app->config, CONFIG_PATH);
+    bindKeys(app);
 
+    // Started first, the renderer and the profiler hook into it
+    jobsInit(jobsDefaultThreads());
     rendererInit(&app->renderer, COLOR_BLACK);
-    u32 font_id = rendererLoadFont(&app->renderer, app->config.font_path, app->config.font_size);
-    rect editor_frame = rect_init(10, 0, INITIAL_SCREEN_WIDTH - 10, INITIAL_SCREEN_HEIGHT - 200);
+    profilerInit(app->config.show_profiler);
+    // The software rasterizer samples coverage, it has no SDF path
+    rendererSetBackend(&app->renderer, app->config.software_renderer ? RENDER_BACKEND_SOFTWARE : RENDER_BACKEND_GL);
+    app->renderer.font_format = app->config.sdf_fonts && !app->config.software_renderer ? GLYPH_ATLAS_SDF : GLYPH_ATLAS_BITMAP;
+    rendererSetLigatures(&app->renderer, app->config.ligatures);
+    app->font_size = app->config.font_size;
+    u32 font_id = rendererLoadFont(&app->renderer, app->config.font_path, app->font_size);
 
     app->ctx = (AppContext) {
-        .font_id = font_id,
-        .glyph_adv = app->renderer.glyph_adv,
-        .line_height = app->renderer.font_atlases[font_id].atlas_height,
-        .descender = app->renderer.descender,
         .screen_width = app->renderer.screen_width,
         .screen_height = app->renderer.screen_height
     };
-
-    editorInit(&app->editor, editor_frame, &app->ctx, ".");
+    applicationUpdateFontContext(app, font_id);
 
     glfwSetWindowUserPointer(app->window, app);
     glfwSetFramebufferSizeCallback(app->window, resize_window);
@@ -261,29 +337,76 @@ void applicationInit(Application *app, int argc, char **argv) {
     glfwSetCursorEnterCallback(app->window, cursorEnterCallback);
     glfwSetCursorPosCallback(app->window, mouseMoveCallback);
     
-    if (argc > 1) {
-        const char *file_path = argv[1];
-        if (checkPath(file_path) == 0) {
-            editorLoadFile(&app->editor, &app->ctx, file_path);
-        } else if (checkPath(file_path) == 1) {
-            editorDestroy(&app->editor);
-            editorInit(&app->editor, editor_frame, &app->ctx, file_path);
-            editorChangeMode(&app->editor, &app->ctx, EDITOR_MODE_OPEN);
-        } else {
-            editorLoadFile(&app->editor, &app->ctx, file_path);
-        }
-    }
-
     app->theme = colorThemeInit();
-    if (app->config.theme_path)
+    app->theme_stamp = (FileStamp) { 0 };
+    if (app->config.theme_path) {
+        getFileStamp(app->config.theme_path, &app->theme_stamp);
         colorThemeLoad(&app->theme, app->config.theme_path);
+    }
+    app->shown_theme = app->theme;
+    app->theme_fade = 0.0f;
+
+    fileWatcherInit(&app->watcher);
+    fileWatcherAdd(&app->watcher, CONFIG_PATH);
+    if (app->config.theme_path) {
+        fileWatcherAdd(&app->watcher, app->config.theme_path);
+    }
+    for (u32 i = 0; i < FILE_TYPE_UNKNOWN; i++) {
+        fileWatcherAdd(&app->watcher, syntaxFilePath((FileType)i));
+    }
 
-    editorLoadConfig(&app->editor, &app->config);
+    app->buffer_count = 0;
+    app->current_buffer = 0;
+    app->pane_count = 1;
+    app->focused_pane = 0;
+    app->panes[0] = (Pane) { .area = rect_init(0, 0, 1, 1) };
+    if (argc > 1 && checkPath(argv[1]) == 1) {
+        applicationNewBuffer(app, argv[1]);
+        editorChangeMode(app->editor, &app->ctx, EDITOR_MODE_OPEN);
+    } else if (argc > 1) {
+        applicationOpenBuffer(app, ".", argv[1]);
+    } else {
+        applicationNewBuffer(app, ".");
+    }
+
+    // Tick as often as the monitor refreshes
+    const GLFWvidmode *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    app->tick_interval = 1.0 / (mode && mode->refreshRate > 0 ? mode->refreshRate : DEFAULT_REFRESH_RATE);
+    app->next_tick_time = glfwGetTime();
+    schedulerInit(&app->scheduler);
+
+    // Hand the context over to the render thread
+    for (u32 i = 0; i < RENDER_THREAD_SLOTS; i++) {
+        for (u32 j = 0; j < MAX_PANES; j++) {
+            editorViewInit(&app->frames[i].views[j]);
+        }
+    }
+    app->last_render_time = glfwGetTime();
+    glfwMakeContextCurrent(NULL);
+    renderThreadStart(&app->render_thread, makeContextCurrent, renderFrame, app);
 }
 
 void applicationDestroy(Application *app) {
+    // Take the context back, GL objects are deleted on this thread
+    renderThreadCall(&app->render_thread, releaseContext, app);
+    renderThreadStop(&app->render_thread);
+    glfwMakeContextCurrent(app->window);
+    for (u32 i = 0; i < RENDER_THREAD_SLOTS; i++) {
+        for (u32 j = 0; j < MAX_PANES; j++) {
+            editorViewDestroy(&app->frames[i].views[j]);
+        }
+    }
+
+    profilerDestroy();
     rendererDestroy(&app->renderer);
-    editorDestroy(&app->editor);
+    jobsDestroy();
+    schedulerDestroy(&app->scheduler);
+    fileWatcherDestroy(&app->watcher);
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        editorDestroy(app->buffers[i]);
+        free(app->buffers[i]);
+    }
+    syntaxDestroyAll();
     configDestroy(&app->config);
 
     if (app->status_message) {
@@ -294,44 +417,339 @@ void applicationDestroy(Application *app) {
     glfwTerminate();
 }
 
-void applicationReload(Application *app) {
-    configDestroy(&app->config);
-    app->config = configInit();
-    loadConfigFromFile(&app->config, "./config/config.toml");
-    u32 font_id = rendererLoadFont(&app->renderer, app->config.font_path, app->config.font_size);
-    
-    // Save the current directory for the browser
-    char *cur_dir = (char *)malloc(strlen(app->editor.browser.cur_dir) + 1);
-    strcpy(cur_dir, app->editor.browser.cur_dir);
-    
-    // save the path to the current open file for the editor
-    char *cur_file_path = NULL;
-    if (app->editor.file_path) {
-        cur_file_path = (char*)malloc(strlen(app->editor.file_path) + 1);
-        strcpy(cur_file_path, app->editor.file_path);
+// Runs on the render thread, applies the reloaded config to the renderer
+static void reloadRenderer(void *arg) {
+    Application *app = (Application *)arg;
+    // The software rasterizer samples coverage, it has no SDF path
+    rendererSetBackend(&app->renderer, app->config.software_renderer ? RENDER_BACKEND_SOFTWARE : RENDER_BACKEND_GL);
+    app->renderer.font_format = app->config.sdf_fonts && !app->config.software_renderer ? GLYPH_ATLAS_SDF : GLYPH_ATLAS_BITMAP;
+    rendererSetLigatures(&app->renderer, app->config.ligatures);
+    u32 old_font_id = app->ctx.font_id;
+    u32 font_id = rendererLoadFont(&app->renderer, app->config.font_path, app->font_size);
+    if (font_id != old_font_id) {
+        rendererReleaseFont(&app->renderer, old_font_id);
     }
-    
-    editorDestroy(&app->editor);
-    rect editor_frame = rect_init(10, 0, INITIAL_SCREEN_WIDTH - 10, INITIAL_SCREEN_HEIGHT - 200);
+    applicationUpdateFontContext(app, font_id);
+}
 
-    app->ctx = (AppContext) {
-        .font_id = font_id,
-        .glyph_adv = app->renderer.glyph_adv,
-        .line_height = app->renderer.font_atlases[font_id].atlas_height,
-        .descender = app->renderer.descender,
-        .screen_width = app->renderer.screen_width,
-        .screen_height = app->renderer.screen_height
-    };
+// Fades to the colors of the theme file, if they changed
+static void reloadTheme(Application *app) {
+    ColorTheme theme = colorThemeInit();
+    app->theme_stamp = (FileStamp) { 0 };
+    if (app->config.theme_path) {
+        getFileStamp(app->config.theme_path, &app->theme_stamp);
+        colorThemeLoad(&theme, app->config.theme_path);
+    }
+    if (colorThemeEqual(&theme, &app->theme)) {
+        return;
+    }
+    app->theme = theme;
+    app->faded_theme = app->shown_theme;
+    app->theme_fade = THEME_FADE_TIME;
+}
 
-    editorInit(&app->editor, editor_frame, &app->ctx, cur_dir);
-    editorLoadConfig(&app->editor, &app->config);
-    app->theme = colorThemeInit();
-    if (app->config.theme_path)
-        colorThemeLoad(&app->theme, app->config.theme_path);
+bool applicationReload(Application *app) {
+    Config config = configInit();
+    if (!loadConfigFromFile(&config, CONFIG_PATH)) {
+        configDestroy(&config);
+        return false;
+    }
+    u32 changes = configDiff(&app->config, &config);
+    bool font_size_changed = config.font_size != app->config.font_size;
+    Config old = app->config;
+    app->config = config;
+
+    if (changes & CONFIG_CHANGED_THEME) {
+        if (old.theme_path) {
+            fileWatcherRemove(&app->watcher, old.theme_path);
+        }
+        if (app->config.theme_path) {
+            fileWatcherAdd(&app->watcher, app->config.theme_path);
+        }
+        reloadTheme(app);
+    }
+    configDestroy(&old);
+
+    // The atlas is only made again if the font, its size or its format
+    // changed. A zoomed font stays zoomed unless the size in the config did.
+    if (changes & CONFIG_CHANGED_RENDERER) {
+        if (font_size_changed) {
+            app->font_size = app->config.font_size;
+        }
+        renderThreadCall(&app->render_thread, reloadRenderer, app);
+    }
+
+    // Buffers keep their text and just pick up the new settings
+    if (changes & CONFIG_CHANGED_EDITOR) {
+        for (size_t i = 0; i < app->buffer_count; i++) {
+            editorLoadConfig(app->buffers[i], &app->config);
+        }
+    }
+    if (changes & CONFIG_CHANGED_KEYBINDS) {
+        bindKeys(app);
+    }
+    if ((changes & CONFIG_CHANGED_PROFILER) && profilerEnabled() != app->config.show_profiler) {
+        profilerToggle();
+    }
+    return true;
+}
+
+// Reads a syntax file again. Its tokens are stale, so the buffers of its
+// file type are lexed again.
+static void reloadSyntax(Application *app, FileType file_type) {
+    syntaxReload(file_type);
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        if (app->buffers[i]->lexer.file_type == file_type) {
+            editorRelex(app->buffers[i]);
+        }
+    }
+}
+
+// Applies a change on disk to what was read from the file. A file can be
+// more than one thing, like the config open in a buffer.
+static void fileChanged(void *user, const char *path) {
+    Application *app = (Application *)user;
+    if (strcmp(path, CONFIG_PATH) == 0) {
+        Command_reloadConfig(app);
+    }
 
-    if (cur_file_path) {
-        editorLoadFile(&app->editor, &app->ctx, cur_file_path);
+    if (app->config.theme_path && strcmp(path, app->config.theme_path) == 0) {
+        reloadTheme(app);
+        applicationSetStatusMessage(app, "Reloaded theme.", 2.0f);
     }
+
+    for (u32 i = 0; i < FILE_TYPE_UNKNOWN; i++) {
+        if (strcmp(path, syntaxFilePath((FileType)i)) == 0) {
+            reloadSyntax(app, (FileType)i);
+            applicationSetStatusMessage(app, "Reloaded syntax.", 2.0f);
+        }
+    }
+
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        Editor *ed = app->buffers[i];
+        if (!ed->file_path || strcmp(path, ed->file_path) != 0) {
+            continue;
+        }
+        if (!editorReloadFile(ed)) {
+            char msg[MAX_STATUS_MESSAGE];
+            snprintf(msg, sizeof(msg), "%s changed on disk, keeping the unsaved edits.", path);
+            applicationSetStatusMessage(app, msg, 3.0f);
+        }
+    }
+}
+
+Editor *applicationNewBuffer(Application *app, const char *cur_dir) {
+    if (app->buffer_count == MAX_BUFFERS) {
+        applicationSetStatusMessage(app, "Too many open buffers.", 2.0f);
+        return NULL;
+    }
+
+    Editor *ed = (Editor *)malloc(sizeof(Editor));
+    editorInit(ed, INIT_EDITOR_FRAME, &app->ctx, cur_dir);
+    editorLoadConfig(ed, &app->config);
+    app->buffers[app->buffer_count++] = ed;
+    applicationSwitchBuffer(app, app->buffer_count - 1);
+    return ed;
+}
+
+Editor *applicationOpenBuffer(Application *app, const char *cur_dir, const char *file_path) {
+    // Buffers keep canonical paths, "main.c" and "./main.c" are one file
+    char *path = getCanonicalPath(file_path);
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        const char *open_path = app->buffers[i]->file_path;
+        if (open_path && strcmp(open_path, path) == 0) {
+            free(path);
+            applicationSwitchBuffer(app, i);
+            return app->buffers[i];
+        }
+    }
+
+    Editor *ed = applicationNewBuffer(app, cur_dir);
+    if (ed) {
+        editorLoadFile(ed, &app->ctx, path);
+        fileWatcherAdd(&app->watcher, ed->file_path);
+    }
+    free(path);
+    return ed;
+}
+
+// Frames of the panes from their areas, the status line goes below them
+static void layoutPanes(Application *app) {
+    f32 status_line_height = app->ctx.line_height;
+    rect editor_area = rect_init(0, status_line_height, app->ctx.screen_width, app->ctx.screen_height - status_line_height);
+    for (u32 i = 0; i < app->pane_count; i++) {
+        Pane *pane = &app->panes[i];
+        rect frame = rect_init(
+            editor_area.x + pane->area.x * editor_area.w,
+            editor_area.y + pane->area.y * editor_area.h,
+            pane->area.w * editor_area.w,
+            pane->area.h * editor_area.h);
+        if (i == app->focused_pane) {
+            editorSetFrame(pane->editor, &app->ctx, frame);
+        } else {
+            pane->state.frame = frame;
+        }
+    }
+}
+
+static size_t bufferIndex(Application *app, Editor *ed) {
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        if (app->buffers[i] == ed) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void applicationSwitchBuffer(Application *app, size_t index) {
+    app->current_buffer = index;
+    app->editor = app->buffers[index];
+    app->panes[app->focused_pane].editor = app->editor;
+    resetAnimTime(&app->editor->cursor);
+    layoutPanes(app);
+}
+
+void applicationCloseBuffer(Application *app, size_t index) {
+    Editor *ed = app->buffers[index];
+    schedulerCancel(&app->scheduler, ed);
+    if (ed->file_path) {
+        fileWatcherRemove(&app->watcher, ed->file_path);
+    }
+
+    memmove(&app->buffers[index], &app->buffers[index + 1], (app->buffer_count - index - 1) * sizeof(Editor *));
+    app->buffer_count--;
+
+    // There's always a buffer to type in
+    if (app->buffer_count == 0) {
+        applicationNewBuffer(app, ".");
+    } else if (ed == app->editor) {
+        applicationSwitchBuffer(app, MIN(index, app->buffer_count - 1));
+    } else {
+        app->current_buffer = bufferIndex(app, app->editor);
+    }
+
+    // Other panes showing it get the buffer that took its place
+    for (u32 i = 0; i < app->pane_count; i++) {
+        if (app->panes[i].editor == ed) {
+            app->panes[i].editor = app->editor;
+            app->panes[i].state = editorSavePane(app->editor);
+        }
+    }
+    layoutPanes(app);
+
+    editorDestroy(ed);
+    free(ed);
+}
+
+void applicationSplitPane(Application *app, bool side_by_side) {
+    if (app->pane_count == MAX_PANES) {
+        applicationSetStatusMessage(app, "Too many panes.", 2.0f);
+        return;
+    }
+
+    // The new half goes right after the focused pane, to the right or below
+    Pane *pane = &app->panes[app->focused_pane];
+    Pane split = { .editor = pane->editor, .area = pane->area, .state = editorSavePane(pane->editor) };
+    if (side_by_side) {
+        pane->area.w *= 0.5f;
+        split.area.w = pane->area.w;
+        split.area.x = pane->area.x + pane->area.w;
+    } else {
+        pane->area.h *= 0.5f;
+        split.area.h = pane->area.h;
+        pane->area.y += pane->area.h;
+    }
+
+    u32 index = app->focused_pane + 1;
+    memmove(&app->panes[index + 1], &app->panes[index], (app->pane_count - index) * sizeof(Pane));
+    app->panes[index] = split;
+    app->pane_count++;
+    layoutPanes(app);
+}
+
+// Moves the focus without keeping the state of the pane that had it
+static void loadPane(Application *app, u32 index) {
+    // The browser and dialog stay with the pane they were opened in
+    if (app->editor->mode != EDITOR_MODE_NORMAL) {
+        editorChangeMode(app->editor, &app->ctx, EDITOR_MODE_NORMAL);
+    }
+
+    Pane *pane = &app->panes[index];
+    app->focused_pane = index;
+    app->editor = pane->editor;
+    app->current_buffer = bufferIndex(app, pane->editor);
+    editorLoadPane(app->editor, &app->ctx, &pane->state);
+}
+
+void applicationFocusPane(Application *app, u32 index) {
+    if (index == app->focused_pane) {
+        return;
+    }
+    app->panes[app->focused_pane].state = editorSavePane(app->editor);
+    loadPane(app, index);
+    layoutPanes(app);
+}
+
+// Panes on one side of the area that exactly cover that side of it. Since
+// panes are made by halving, one of the four sides always has them.
+static u32 panesAlongside(Application *app, rect a, u32 side, u32 *found) {
+    f32 covered = 0.0f;
+    u32 count = 0;
+    for (u32 i = 0; i < app->pane_count; i++) {
+        rect b = app->panes[i].area;
+        bool within_y = b.y >= a.y && b.y + b.h <= a.y + a.h;
+        bool within_x = b.x >= a.x && b.x + b.w <= a.x + a.w;
+        bool touches = false;
+        switch (side) {
+        case 0: touches = within_y && b.x + b.w == a.x; break; // left
+        case 1: touches = within_y && b.x == a.x + a.w; break; // right
+        case 2: touches = within_x && b.y + b.h == a.y; break; // below
+        case 3: touches = within_x && b.y == a.y + a.h; break; // above
+        }
+        if (touches) {
+            found[count++] = i;
+            covered += side < 2 ? b.h : b.w;
+        }
+    }
+    return covered == (side < 2 ? a.h : a.w) ? count : 0;
+}
+
+void applicationClosePane(Application *app, u32 index) {
+    if (app->pane_count == 1) {
+        return;
+    }
+
+    // The neighbors on one side grow over the closed pane
+    rect a = app->panes[index].area;
+    u32 found[MAX_PANES];
+    u32 count = 0;
+    u32 side = 0;
+    while (side < 4 && (count = panesAlongside(app, a, side, found)) == 0) {
+        side++;
+    }
+    if (count == 0) {
+        return;
+    }
+    for (u32 i = 0; i < count; i++) {
+        rect *b = &app->panes[found[i]].area;
+        switch (side) {
+        case 0: b->w += a.w; break;
+        case 1: b->x = a.x; b->w += a.w; break;
+        case 2: b->h += a.h; break;
+        case 3: b->y = a.y; b->h += a.h; break;
+        }
+    }
+
+    // Focus moves to one of them
+    if (index == app->focused_pane) {
+        loadPane(app, found[0]);
+    }
+    memmove(&app->panes[index], &app->panes[index + 1], (app->pane_count - index - 1) * sizeof(Pane));
+    app->pane_count--;
+    if (app->focused_pane > index) {
+        app->focused_pane--;
+    }
+    layoutPanes(app);
 }
 
 void applicationSetStatusMessage(Application *app, const char *msg, f32 t) {
@@ -339,41 +757,227 @@ void applicationSetStatusMessage(Application *app, const char *msg, f32 t) {
         free(app->status_message);
     }
 
-    app->status_message = (char *)malloc(strlen(msg) * sizeof(char));
+    app->status_message = (char *)malloc((strlen(msg) + 1) * sizeof(char));
     strcpy(app->status_message, msg);
     app->status_disp_time = t;
 }
 
+/* INPUT */
+
+// Inserts what was typed since the last flush. Anything that reads or moves
+// the cursor calls this first, so edits still happen in the order they were typed.
+static void flushTypedText(Application *app) {
+    if (app->typed_len + app->typed_closers_len == 0) {
+        return;
+    }
+    for (size_t i = 0; i < app->typed_closers_len; i++) {
+        app->typed_text[app->typed_len + i] = app->typed_closers[app->typed_closers_len - 1 - i];
+    }
+    editorInsertText(app->editor, app->typed_text, app->typed_len + app->typed_closers_len, app->typed_len);
+    app->typed_len = 0;
+    app->typed_closers_len = 0;
+}
+
+static void typeText(Application *app, const char *text, size_t len, char closer) {
+    if (app->typed_len + app->typed_closers_len + len + 1 > MAX_TYPED_TEXT) {
+        flushTypedText(app);
+    }
+    memcpy(app->typed_text + app->typed_len, text, len);
+    app->typed_len += len;
+    if (closer) {
+        app->typed_closers[app->typed_closers_len++] = closer;
+    }
+}
+
+static void processCharacter(Application *app, u32 codepoint) {
+    if (app->drop_char) {
+        app->drop_char = false;
+        return;
+    }
+
+    // TODO: keep track of the last character that the user entered,
+    // If they reflexively try to complete these pairs, we should ignore
+    // the second character
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        char encoded[4];
+        size_t len = utf8Encode(codepoint, encoded);
+        switch (codepoint) {
+        case '{':  typeText(app, encoded, len, '}');  break;
+        case '(':  typeText(app, encoded, len, ')');  break;
+        case '\'': typeText(app, encoded, len, '\''); break;
+        case '"':  typeText(app, encoded, len, '"');  break;
+        case '[':  typeText(app, encoded, len, ']');  break;
+        default:   typeText(app, encoded, len, 0);
+        }
+    } else if (app->editor->mode == EDITOR_MODE_SAVE && codepoint < 0x80) {
+        dialogInsertCharacter(&app->editor->sd, (char)codepoint);
+    }
+}
+
+static void processKey(Application *app, int key, int scancode, int action, int mods) {
+    if (action != GLFW_REPEAT && action != GLFW_PRESS) {
+        return;
+    }
+    // Holding the first key of a chord down
+    if (action == GLFW_REPEAT && keymapPending(&app->keymap)) {
+        return;
+    }
+
+    CommandFn command = NULL;
+    KeymapResult result = keymapPress(&app->keymap, app->editor->mode, key, mods, glfwGetTime(), &command);
+    app->drop_char = result == KEYMAP_CHORD;
+
+    if (result != KEYMAP_CHORD && app->editor->mode == EDITOR_MODE_NORMAL) {
+        applicationProcessEditorInput(app, key, scancode, action, mods);
+    }
+    if (command) {
+        flushTypedText(app);
+        command(app);
+    } else if (keymapPending(&app->keymap) && !isModifierKey(key)) {
+        char message[64];
+        keyStrokeToString((KeyStroke) { key, mods }, message, sizeof(message));
+        strncat(message, " was pressed, waiting for the next key", sizeof(message) - strlen(message) - 1);
+        applicationSetStatusMessage(app, message, (f32)CHORD_TIMEOUT);
+    } else if (result == KEYMAP_CHORD && !isModifierKey(key)) {
+        applicationSetStatusMessage(app, "That chord isn't bound.", 2.0f);
+    }
+}
+
+static void processMouseButton(Application *app, int button, int action, int mods, vec2 pos) {
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        flushTypedText(app);
+        app->mouse_held = true;
+
+        // Clicking a pane focuses it, positions are from the top of the window
+        vec2 screen_pos = vec2_init(pos.x, app->ctx.screen_height - pos.y);
+        for (u32 i = 0; i < app->pane_count; i++) {
+            rect frame = i == app->focused_pane ? app->editor->frame : app->panes[i].state.frame;
+            if (rect_contains_point(frame, screen_pos)) {
+                applicationFocusPane(app, i);
+                break;
+            }
+        }
+        moveCursorToMousePos(app->editor, &app->ctx, pos);
+
+        // Selection
+        if ((mods & GLFW_MOD_SHIFT) == GLFW_MOD_SHIFT)
+            editorMakeSelection(app->editor);
+        else
+            editorUnselectSelection(app->editor);
+    } else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
+        app->mouse_held = false;
+    }
+}
+
+void applicationProcessInput(Application *app) {
+    for (size_t i = 0; i < app->input_event_count; i++) {
+        InputEvent *event = &app->input_events[i];
+        switch (event->type) {
+        case INPUT_KEY:
+            processKey(app, event->key, 0, event->action, event->mods);
+            break;
+        case INPUT_CHAR:
+            processCharacter(app, event->codepoint);
+            break;
+        case INPUT_MOUSE_MOVE:
+            // Only the last of consecutive moves matters
+            if (i + 1 < app->input_event_count && app->input_events[i + 1].type == INPUT_MOUSE_MOVE) {
+                break;
+            }
+            if (app->mouse_held) {
+                flushTypedText(app);
+                moveCursorToMousePos(app->editor, &app->ctx, event->pos);
+                editorMakeSelection(app->editor);
+            }
+            break;
+        case INPUT_MOUSE_BUTTON:
+            processMouseButton(app, event->key, event->action, event->mods, event->pos);
+            break;
+        }
+    }
+    app->input_event_count = 0;
+    flushTypedText(app);
+}
+
+void applicationWaitEvents(Application *app) {
+    // Input wakes us right away, it doesn't wait for the next tick
+    f64 now = glfwGetTime();
+    if (app->next_tick_time > now) {
+        glfwWaitEventsTimeout(app->next_tick_time - now);
+    } else {
+        glfwPollEvents();
+    }
+
+    now = glfwGetTime();
+    if (now >= app->next_tick_time) {
+        app->next_tick_time = MAX(app->next_tick_time + app->tick_interval, now);
+    }
+}
+
+static bool lexTask(void *arg, f64 deadline) {
+    return editorLexStep((Editor *)arg, deadline);
+}
+
 void applicationUpdate(Application *app, f64 delta_time) {
-    glfwPollEvents();
-    editorUpdate(&app->editor, &app->ctx, delta_time);
+    bool idle = app->input_event_count == 0;
+    profilerBeginPhase(PROFILE_INPUT);
+    applicationProcessInput(app);
+    profilerEndPhase(PROFILE_INPUT);
+
+    profilerBeginPhase(PROFILE_UPDATE);
+    fileWatcherPoll(&app->watcher, fileChanged, app);
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        editorPollLoad(app->buffers[i]);
+    }
+    layoutPanes(app);
+    editorUpdate(app->editor, &app->ctx, delta_time);
+    profilerEndPhase(PROFILE_UPDATE);
+
+    // Buffers in the background finish lexing too, switching to them is free
+    for (size_t i = 0; i < app->buffer_count; i++) {
+        if (editorLexPending(app->buffers[i])) {
+            schedulerAdd(&app->scheduler, lexTask, app->buffers[i]);
+        }
+    }
+
+    // Without input to respond to, background work may take the whole tick
+    f64 budget = app->config.frame_budget_ms / 1000.0;
+    if (idle) {
+        budget = MAX(budget, app->next_tick_time - glfwGetTime() - SCHEDULER_SLICE);
+    }
+    profilerBeginPhase(PROFILE_TASKS);
+    schedulerRun(&app->scheduler, getTimeSeconds() + budget);
+    profilerEndPhase(PROFILE_TASKS);
 }
 
-void applicationRender(Application *app, f64 delta_time) {
-    rendererBegin(&app->renderer);
-        
-    // Render stuff goes here
-    renderEditor(&app->renderer, &app->editor, &app->ctx, delta_time, app->theme);
+void applicationPublishFrame(Application *app, f64 delta_time) {
+    if (app->theme_fade > 0.0f) {
+        app->theme_fade = MAX(app->theme_fade - (f32)delta_time, 0.0f);
+        app->shown_theme = colorThemeLerp(&app->faded_theme, &app->theme, 1.0f - app->theme_fade / THEME_FADE_TIME);
+    } else {
+        app->shown_theme = app->theme;
+    }
 
-    // Draw the status message
-    if (app->status_message && app->status_disp_time > 0.0f) {
-        vec2 status_pos = vec2_init(app->ctx.glyph_adv, 5.0);
-        renderText(&app->renderer, app->status_message, &status_pos, &app->renderer.font_atlases[app->ctx.font_id], app->theme.foreground);
-        app->status_disp_time -= (f32)delta_time;
+    Frame *frame = &app->frames[renderThreadBackSlot(&app->render_thread)];
+    for (u32 i = 0; i < app->pane_count; i++) {
+        Pane *pane = &app->panes[i];
+        bool focused = i == app->focused_pane;
+        editorViewUpdate(&frame->views[i], pane->editor, focused ? NULL : &pane->state, &app->ctx);
     }
+    frame->view_count = app->pane_count;
+    frame->focused_view = app->focused_pane;
+    frame->theme = app->shown_theme;
+    frame->show_fps = app->config.show_fps;
 
-    // Draw FPS counter
-    if (app->config.show_fps) {
-        f64 fps = 1.0f / delta_time;
-        char fps_str[200];
-        sprintf(fps_str, "FPS: %f", fps);
-        vec2 fps_pos = vec2_init(app->renderer.screen_width - (app->renderer.glyph_adv * 10.0), app->ctx.line_height * 2);
-        GlyphAtlas atlas = app->renderer.font_atlases[app->ctx.font_id];
-        renderText(&app->renderer, fps_str, &fps_pos, &atlas, COLOR_RED);
+    frame->status_message[0] = '\0';
+    if (app->status_message && app->status_disp_time > 0.0f) {
+        snprintf(frame->status_message, sizeof(frame->status_message), "%s", app->status_message);
+        app->status_disp_time -= (f32)delta_time;
     }
 
-    rendererEnd(&app->renderer);
-    glfwSwapBuffers(app->window);
+    profilerTakePhases(frame->phase_time);
+    frame->tasks_queued = schedulerQueueDepth(&app->scheduler);
+    renderThreadPublish(&app->render_thread);
 }
 
 void applicationProcessEditorInput (Application *app, int key, int scancode, int action , int mods) {
@@ -382,237 +986,298 @@ void applicationProcessEditorInput (Application *app, int key, int scancode, int
 
     // not sure what to do with these yet.
     if (key == GLFW_KEY_ENTER && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-        editorInsertCharacter(&app->editor, '\n', true);
+        typeText(app, "\n", 1, 0);
     } else if (key == GLFW_KEY_TAB && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
-        for (size_t i = 0; i< (size_t)app->editor.tab_stop; i++) {
-            editorInsertCharacter(&app->editor, ' ', true);
+        for (size_t i = 0; i< (size_t)app->editor->tab_stop; i++) {
+            typeText(app, " ", 1, 0);
         }
     }
 }
 
 void Command_moveRight(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveRight(&app->editor);
-        editorUnselectSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
-        dialogMoveCursorRight(&app->editor.sd);
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveRight(app->editor);
+        editorUnselectSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
+        dialogMoveCursorRight(&app->editor->sd);
     }
     
 }
 
 void Command_moveForwardWord(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveEndOfNextWord(&app->editor);
-        editorUnselectSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveEndOfNextWord(app->editor);
+        editorUnselectSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         // TODO   
     }
 }
 
 void Command_selectRight(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveRight(&app->editor);
-        editorMakeSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveRight(app->editor);
+        editorMakeSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         // TODO
     }
 }
 
 void Command_selectForwardWord(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveEndOfNextWord(&app->editor);
-        editorMakeSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveEndOfNextWord(app->editor);
+        editorMakeSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_moveLeft(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveLeft(&app->editor);
-        editorUnselectSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
-        dialogMoveCursorLeft(&app->editor.sd);
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveLeft(app->editor);
+        editorUnselectSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
+        dialogMoveCursorLeft(&app->editor->sd);
     }
 }
 
 void Command_moveBackwardWord(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveBegOfPrevWord(&app->editor);
-        editorUnselectSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveBegOfPrevWord(app->editor);
+        editorUnselectSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_selectLeft(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveLeft(&app->editor);
-        editorMakeSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveLeft(app->editor);
+        editorMakeSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_selectBackwardWord(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorMoveBegOfPrevWord(&app->editor);
-        editorMakeSelection(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorMoveBegOfPrevWord(app->editor);
+        editorMakeSelection(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         // TODO
     }
 }
 
 void Command_moveUp(Application *app) {
-    editorMoveUp(&app->editor);
-    editorUnselectSelection(&app->editor);
+    editorMoveUp(app->editor);
+    editorUnselectSelection(app->editor);
 }
 
 void Command_selectUp(Application *app) {
-    editorMoveUp(&app->editor);
-    editorMakeSelection(&app->editor);
+    editorMoveUp(app->editor);
+    editorMakeSelection(app->editor);
 }
 
 void Command_moveDown(Application *app) {
-    editorMoveDown(&app->editor);
+    editorMoveDown(app->editor);
 }
 
 void Command_selectDown(Application *app) {
-    editorMoveDown(&app->editor);
-    editorMakeSelection(&app->editor);
+    editorMoveDown(app->editor);
+    editorMakeSelection(app->editor);
 }
 
 void Command_deleteLeft(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        if (app->editor.cursor.selection_size != 0) {
-            editorDeleteSelection(&app->editor);
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        if (app->editor->cursor.selection_size != 0) {
+            editorDeleteSelection(app->editor);
         } else {
-            editorDeleteCharLeft(&app->editor);
+            editorDeleteCharLeft(app->editor);
         }
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
-        dialogDeleteCharLeft(&app->editor.sd);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
+        dialogDeleteCharLeft(&app->editor->sd);
     }
 }
 
 void Command_deleteWordLeft(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorDeleteWordLeft(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorDeleteWordLeft(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_deleteRight(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        if (app->editor.cursor.selection_size != 0) {
-            editorDeleteSelection(&app->editor);
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        if (app->editor->cursor.selection_size != 0) {
+            editorDeleteSelection(app->editor);
         } else {
-            editorDeleteCharRight(&app->editor);
+            editorDeleteCharRight(app->editor);
         }
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_deleteWordRight(Application *app) {
-    if (app->editor.mode == EDITOR_MODE_NORMAL) {
-        editorDeleteWordRight(&app->editor);
-    } else if (app->editor.mode == EDITOR_MODE_SAVE) {
+    if (app->editor->mode == EDITOR_MODE_NORMAL) {
+        editorDeleteWordRight(app->editor);
+    } else if (app->editor->mode == EDITOR_MODE_SAVE) {
         //TODO
     }
 }
 
 void Command_openBrowser(Application *app) {
-    editorChangeMode(&app->editor, &app->ctx, EDITOR_MODE_OPEN);
+    editorChangeMode(app->editor, &app->ctx, EDITOR_MODE_OPEN);
 }
 
 void Command_unselect(Application *app) {
-    editorUnselectSelection(&app->editor);
+    editorUnselectSelection(app->editor);
 }
 
 void Command_write(Application *app) {
-    if (!app->editor.file_path) {
+    if (!app->editor->file_path) {
         Command_openSaveDialog(app);
+    } else if (editorLoading(app->editor)) {
+        applicationSetStatusMessage(app, "Still loading, not saved.", 2.0f);
     } else {
-        editorWriteFile(&app->editor);
+        editorWriteFile(app->editor);
         applicationSetStatusMessage(app, "Saved to disk.", 2.0f);
     }
 }
 
 void Command_openSaveDialog(Application *app) {
-    editorChangeMode(&app->editor, &app->ctx, EDITOR_MODE_SAVE);
+    editorChangeMode(app->editor, &app->ctx, EDITOR_MODE_SAVE);
 }
 
 void Command_decrementSelection(Application *app) {
-    FileBrowser *browser = &app->editor.browser;
+    FileBrowser *browser = &app->editor->browser;
     decrementSelection(browser);
 }
 
 void Command_incrementSelection(Application *app) {
-    FileBrowser *browser = &app->editor.browser;
+    FileBrowser *browser = &app->editor->browser;
     incrementSelection(browser);
 }
 
 void Command_openSelection(Application *app) {
-    BrowserItem selection = getSelection(&app->editor.browser);
+    BrowserItem selection = getSelection(&app->editor->browser);
     if (selection.is_dir) {
         if (strcmp(selection.name_ext, "..") == 0) {
-            goUpDirectoryLevel(&app->editor.browser);
-            app->editor.browser.selection = 0;
-            getPaths(&app->editor.browser);
+            goUpDirectoryLevel(&app->editor->browser);
+            app->editor->browser.selection = 0;
+            getPaths(&app->editor->browser);
         } else {
-            enterDirectory(&app->editor.browser, selection.name_ext);
-            app->editor.browser.selection = 0;
-            getPaths(&app->editor.browser);
+            enterDirectory(&app->editor->browser, selection.name_ext);
+            app->editor->browser.selection = 0;
+            getPaths(&app->editor->browser);
         }
     } else {
-        char *cur_dir = (char *)malloc(sizeof(char) * strlen(app->editor.browser.cur_dir) + 1);
-        strcpy(cur_dir, app->editor.browser.cur_dir);
-        char *full_path = (char *)malloc(sizeof(char) * strlen(selection.full_path) + 1);
-        strcpy(full_path, selection.full_path);
-
-        editorDestroy(&app->editor);
-        editorInit(&app->editor, INIT_EDITOR_FRAME, &app->ctx, cur_dir);
-        editorLoadConfig(&app->editor, &app->config);
-        editorLoadFile(&app->editor, &app->ctx, full_path);
-        free(cur_dir);
+        Editor *browsing = app->editor;
+        editorChangeMode(browsing, &app->ctx, EDITOR_MODE_NORMAL);
+        applicationOpenBuffer(app, browsing->browser.cur_dir, selection.full_path);
     }
 }
 
+void Command_toggleProfiler(Application *app) {
+    UNUSED(app);
+    profilerToggle();
+}
+
 void Command_reloadConfig(Application *app) {
     LOG_INFO("Reloading Config...", "");
-    applicationReload(app);
+    if (!applicationReload(app)) {
+        applicationSetStatusMessage(app, "Config has errors, keeping the current one.", 3.0f);
+        return;
+    }
+
+    // The theme and syntax files are watched, but without inotify this is
+    // how they're reread. Only the ones that changed are, since a syntax
+    // relexes the buffers using it.
+    FileStamp theme_stamp = { 0 };
+    if (app->config.theme_path) {
+        getFileStamp(app->config.theme_path, &theme_stamp);
+    }
+    if (!fileStampEqual(theme_stamp, app->theme_stamp)) {
+        reloadTheme(app);
+    }
+    for (u32 i = 0; i < FILE_TYPE_UNKNOWN; i++) {
+        if (syntaxChanged((FileType)i)) {
+            reloadSyntax(app, (FileType)i);
+        }
+    }
     LOG_INFO("Config reloaded.", "");
     applicationSetStatusMessage(app, "Reloaded config.", 2.0f);
 }
 
 void Command_returnToEditor(Application *app) {
-    if (app->editor.mode != EDITOR_MODE_NORMAL) {
-        editorChangeMode(&app->editor, &app->ctx, EDITOR_MODE_NORMAL);
+    if (app->editor->mode != EDITOR_MODE_NORMAL) {
+        editorChangeMode(app->editor, &app->ctx, EDITOR_MODE_NORMAL);
     }
 }
 
 void Command_submitSaveDialog(Application *app) {
-    Editor *ed = &app->editor;
+    Editor *ed = app->editor;
+    if (editorLoading(ed)) {
+        editorChangeMode(ed, &app->ctx, EDITOR_MODE_NORMAL);
+        applicationSetStatusMessage(app, "Still loading, not saved.", 2.0f);
+        return;
+    }
 
-    if (ed->file_path == NULL) {
-        ed->file_path = (char *)malloc(getBufLength(ed->sd.buf) * sizeof(char));
-        strcpy(ed->file_path, getBufString(ed->sd.buf));
-    } else {
-        char *temp = realloc(ed->file_path, getBufLength(ed->sd.buf));
-        if (!temp)
-        ed->file_path = temp;
-        strcpy(ed->file_path, getBufString(ed->sd.buf));
+    // The editor owns its path
+    if (ed->file_path) {
+        fileWatcherRemove(&app->watcher, ed->file_path);
     }
+    free(ed->file_path);
+    char *typed_path = getBufString(ed->sd.buf);
+    ed->file_path = getCanonicalPath(typed_path);
+    free(typed_path);
+    fileWatcherAdd(&app->watcher, ed->file_path);
     editorChangeMode(ed, &app->ctx, EDITOR_MODE_NORMAL);
     char alert[1024];
-    editorWriteFile(&app->editor);
-    sprintf(alert, "Saved file \'%s\' to disk.", ed->file_path);
+    editorWriteFile(app->editor);
+    snprintf(alert, sizeof(alert), "Saved file \'%s\' to disk.", ed->file_path);
     applicationSetStatusMessage(app, alert, 2.0f);
 }
 
 void Command_openNewFile(Application *app) {
-    editorDestroy(&app->editor);
-    editorInit(&app->editor, INIT_EDITOR_FRAME, &app->ctx, ".");
-    editorLoadConfig(&app->editor, &app->config);
-}
\ No newline at end of file
+    applicationNewBuffer(app, app->editor->browser.cur_dir);
+}
+
+static void showBuffer(Application *app) {
+    char msg[MAX_STATUS_MESSAGE];
+    char *file_name = app->editor->file_path ? get_filename_from_path(app->editor->file_path) : NULL;
+    snprintf(msg, sizeof(msg), "Buffer %zu/%zu: %s", app->current_buffer + 1, app->buffer_count, file_name ? file_name : "[New File]");
+    free(file_name);
+    applicationSetStatusMessage(app, msg, 2.0f);
+}
+
+void Command_nextBuffer(Application *app) {
+    applicationSwitchBuffer(app, (app->current_buffer + 1) % app->buffer_count);
+    showBuffer(app);
+}
+
+void Command_previousBuffer(Application *app) {
+    applicationSwitchBuffer(app, (app->current_buffer + app->buffer_count - 1) % app->buffer_count);
+    showBuffer(app);
+}
+
+void Command_closeBuffer(Application *app) {
+    applicationCloseBuffer(app, app->current_buffer);
+    showBuffer(app);
+}
+
+void Command_splitHorizontal(Application *app) {
+    applicationSplitPane(app, false);
+}
+
+void Command_splitVertical(Application *app) {
+    applicationSplitPane(app, true);
+}
+
+void Command_nextPane(Application *app) {
+    applicationFocusPane(app, (app->focused_pane + 1) % app->pane_count);
+}
+
+void Command_closePane(Application *app) {
+    applicationClosePane(app, app->focused_pane);
+}
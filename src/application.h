@@ -5,62 +5,198 @@
 
 
 #include "renderer.h"
+#include "renderthread.h"
+#include "profiler.h"
 #include "font.h"
 #include "editor.h"
+#include "view.h"
+#include "scheduler.h"
+#include "watcher.h"
 #include "config.h"
 #include "keys.h"
+#include "keymap.h"
 #include "context.h"
 
 #define MAX_COMMANDS 100
 
+// Slots of the command name hash, a power of two well above MAX_COMMANDS
+#define COMMAND_SLOTS 256
+
+#define CONFIG_PATH "./config/config.toml"
+
+// Documents open at once
+#define MAX_BUFFERS 64
+
+// Bounds for ctrl + scroll zoom, in pixels
+#define MIN_FONT_SIZE 8
+#define MAX_FONT_SIZE 96
+
+// Seconds a reloaded theme takes to fade in
+#define THEME_FADE_TIME 0.3f
+
+// Input queued between frames before it is applied early (see applicationProcessInput)
+#define MAX_INPUT_EVENTS 256
+#define MAX_TYPED_TEXT 1024
+
+// Status messages longer than this are cut short when drawn
+#define MAX_STATUS_MESSAGE 256
+
+// Tick rate of the editor thread when the monitor's refresh rate is unknown
+#define DEFAULT_REFRESH_RATE 60
+
+typedef enum {
+    INPUT_KEY,
+    INPUT_CHAR,
+    INPUT_MOUSE_MOVE,
+    INPUT_MOUSE_BUTTON
+} InputEventType;
+
 typedef struct {
-    int key;
+    InputEventType type;
+    int key;     // key or mouse button
+    int action;
     int mods;
-    void (*command)();
-    CommandType type;
-} KeyBind;
+    u32 codepoint;
+    vec2 pos;    // cursor position of mouse events
+} InputEvent;
 
 typedef struct {
     char *name;
     void (*command)();
 } Command;
 
+// A part of the window showing one of the buffers. Panes are made by
+// halving one, so their areas are exact fractions of the editor area.
+typedef struct {
+    Editor *editor;
+    rect area;
+
+    // Cursor and scroll of panes without focus. The focused pane's are in
+    // its editor, swapped in and out as the focus moves.
+    EditorPane state;
+} Pane;
+
+// What the render thread draws, filled in by the editor thread every tick
+// (see applicationPublishFrame). One per slot of the render thread.
+typedef struct {
+    EditorView views[MAX_PANES]; // one per pane
+    u32 view_count;
+    u32 focused_view;
+    ColorTheme theme;
+    char status_message[MAX_STATUS_MESSAGE]; // empty when none is shown
+    bool show_fps;
+    f64 phase_time[PROFILE_PHASE_COUNT]; // editor thread phases of the tick
+    u32 tasks_queued; // background tasks left after the tick
+} Frame;
+
 typedef struct {
     // The window for this application - this lives for the entire program.
     GLFWwindow *window;
 
     // The renderer for this application - this lives for the entire program.
+    // After init only the render thread touches it, other GL work goes
+    // through renderThreadCall.
     Renderer renderer;
-    
-    Editor editor;
+    RenderThread render_thread;
+    Frame frames[RENDER_THREAD_SLOTS];
+    f64 last_render_time; // of the render thread, for the FPS counter
+
+    // The editor thread ticks at the refresh rate, and right away on input
+    f64 tick_interval;
+    f64 next_tick_time;
+
+    // Background work of the editor thread, run for config.frame_budget_ms
+    // every tick, or until the next tick when there was no input
+    Scheduler scheduler;
+
+    // Config, theme, syntax and document files, whatever changed on disk is
+    // applied on the next tick
+    FileWatcher watcher;
+
+    // Every open document keeps its own editor, so switching between them
+    // is just a pointer swap. Syntax tables and fonts are shared by all.
+    Editor *buffers[MAX_BUFFERS];
+    size_t buffer_count;
+    size_t current_buffer;
+    Editor *editor; // buffers[current_buffer], shown in the focused pane
+
+    Pane panes[MAX_PANES];
+    u32 pane_count;
+    u32 focused_pane;
     Config config;
     ColorTheme theme;
+    FileStamp theme_stamp; // of the theme file when it was read
+
+    // Theme being drawn. After a reload it fades from the previous one to
+    // theme, which only changes the renderer's palette, not its geometry.
+    ColorTheme shown_theme;
+    ColorTheme faded_theme;
+    f32 theme_fade; // seconds left of the fade
 
     char *status_message;
     f32 status_disp_time;
 
     bool mouse_held;
 
+    // The GLFW callbacks only queue input, it is applied once per frame
+    InputEvent input_events[MAX_INPUT_EVENTS];
+    size_t input_event_count;
+
+    // Text typed since the last edit command, inserted with a single
+    // editorInsertText. Closing brackets typed for us go after the cursor,
+    // innermost last.
+    char typed_text[MAX_TYPED_TEXT];
+    size_t typed_len;
+    char typed_closers[MAX_TYPED_TEXT];
+    size_t typed_closers_len;
+
+    // Current font size, starts at config.font_size and changes with zoom.
+    u32 font_size;
+
     Command commands[MAX_COMMANDS];
-    KeyBind keybinds[MAX_COMMANDS];
     size_t numCommands;
-    size_t numKeybinds;
+    u8 command_slots[COMMAND_SLOTS]; // index in commands plus one, 0 when empty
+
+    Keymap keymap;
+    bool drop_char; // the last key went to a chord, the character it types doesn't
 
     AppContext ctx;
 } Application;
 
 void applicationInit(Application *app, int argc, char **argv);
 void applicationDestroy(Application *app);
-void applicationReload(Application *app);
+// Reads the config again and applies only the settings that differ from the
+// active ones. Returns false, keeping the active config, if it can't be read.
+bool applicationReload(Application *app);
 void applicationSetStatusMessage(Application *app, const char *msg, f32 t);
 
+// Buffers. Opening a file that is already open switches to its buffer,
+// without touching the disk. Returns NULL when MAX_BUFFERS are open.
+Editor *applicationNewBuffer(Application *app, const char *cur_dir);
+Editor *applicationOpenBuffer(Application *app, const char *cur_dir, const char *file_path);
+void applicationSwitchBuffer(Application *app, size_t index);
+void applicationCloseBuffer(Application *app, size_t index);
+
+// Panes. A split halves the focused pane, both halves show its buffer.
+void applicationSplitPane(Application *app, bool side_by_side);
+void applicationFocusPane(Application *app, u32 index);
+void applicationClosePane(Application *app, u32 index);
+
+// Sleeps until there is input or the next tick is due, queueing the input.
+void applicationWaitEvents(Application *app);
 void applicationUpdate(Application *app, f64 delta_time);
-void applicationRender(Application *app, f64 delta_time);
 
+// Hands the render thread a frame of the current state to draw.
+void applicationPublishFrame(Application *app, f64 delta_time);
+
+// Applies the queued input in order. Runs of typed characters become one
+// insert and runs of mouse moves one hit test, so a burst costs one relex.
+void applicationProcessInput(Application *app);
 void applicationProcessEditorInput (Application *app, int key, int scancode, int action , int mods);
 
 void applicationRegisterCommand(Application *app, char *name, void (*command)());
-void applicationBindKey(Application *app, int key, int mods, const char *commandName, CommandType type);
+// Binds a key, or a chord of keys, to the command registered as commandName.
+void applicationBindKey(Application *app, const KeyStroke *keys, u32 key_count, const char *commandName, CommandType type);
 
 // TODO come up with naming convention for commands
 void Command_moveRight(Application *app);
@@ -97,8 +233,18 @@ void Command_incrementSelection(Application *app);
 void Command_openSelection(Application *app);
 
 void Command_reloadConfig(Application *app);
+void Command_toggleProfiler(Application *app);
 
 void Command_openSaveDialog(Application *app);
 void Command_submitSaveDialog(Application *app);
 
-void Command_openNewFile(Application *app);
\ No newline at end of file
+void Command_openNewFile(Application *app);
+
+void Command_nextBuffer(Application *app);
+void Command_previousBuffer(Application *app);
+void Command_closeBuffer(Application *app);
+
+void Command_splitHorizontal(Application *app);
+void Command_splitVertical(Application *app);
+void Command_nextPane(Application *app);
+void Command_closePane(Application *app);
\ No newline at end of file
@@ -0,0 +1,366 @@
+// Headless rendering benchmark. Renders a file through the real renderer into
+// an offscreen framebuffer on a surfaceless EGL context (Mesa llvmpipe works,
+// no display or GPU needed), drives the editor through a scripted scroll, type,
+// select and idle sequence, and prints per-frame timings and batch stats as JSON.
+//
+// usage: bench-render [file] [--frames N] [--width W] [--height H] [--sdf] [--software] [--ligatures] [--screenshot out.ppm]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "renderer.h"
+#include "editor.h"
+#include "config.h"
+
+#define BENCH_DEFAULT_FILE "./src/renderer.c"
+#define BENCH_DEFAULT_FRAMES 600
+#define BENCH_DELTA_TIME (1.0 / 60.0)
+
+typedef enum {
+    BENCH_SCROLL,
+    BENCH_TYPE,
+    BENCH_SELECT,
+    BENCH_IDLE,
+    BENCH_STAGE_COUNT
+} BenchStage;
+
+static const char *stage_names[BENCH_STAGE_COUNT] = { "scroll", "type", "select", "idle" };
+
+typedef struct {
+    f32 ms;
+    BenchStage stage;
+    RenderStats stats;
+} BenchFrame;
+
+typedef struct {
+    EGLDisplay display;
+    EGLContext context;
+    u32 fbo;
+    u32 color;
+} Headless;
+
+static void headlessInit(Headless *h, i32 width, i32 height) {
+    // Prefer the surfaceless platform, it needs no window system at all
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    h->display = EGL_NO_DISPLAY;
+    if (getPlatformDisplay) {
+        h->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (h->display == EGL_NO_DISPLAY) {
+        h->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (h->display == EGL_NO_DISPLAY || !eglInitialize(h->display, NULL, NULL)) {
+        LOG_ERROR("Could not initialize an EGL display", "");
+        exit(1);
+    }
+
+    // Surfaceless displays only expose pbuffer configs, the default asks for windows
+    EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(h->display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+        LOG_ERROR("No EGL config with desktop OpenGL", "");
+        exit(1);
+    }
+
+    EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    h->context = eglCreateContext(h->display, config, EGL_NO_CONTEXT, context_attribs);
+    if (h->context == EGL_NO_CONTEXT || !eglMakeCurrent(h->display, EGL_NO_SURFACE, EGL_NO_SURFACE, h->context)) {
+        LOG_ERROR("Could not create a surfaceless OpenGL 3.3 context", "");
+        exit(1);
+    }
+
+    // GLEW loads the entry points before it looks for GLX, so a missing X
+    // display is fine here
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+        LOG_ERROR("Could not initialize GLEW: %s", glewGetErrorString(err));
+        exit(1);
+    }
+
+    glGenRenderbuffers(1, &h->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, h->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &h->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, h->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, h->color);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOG_ERROR("Offscreen framebuffer is incomplete", "");
+        exit(1);
+    }
+}
+
+static void headlessDestroy(Headless *h) {
+    glDeleteFramebuffers(1, &h->fbo);
+    glDeleteRenderbuffers(1, &h->color);
+    eglMakeCurrent(h->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(h->display, h->context);
+    eglTerminate(h->display);
+}
+
+// Advances the scripted input for frame i of the given stage.
+static void benchStep(Editor *ed, AppContext *ctx, BenchStage stage, u32 i) {
+    static const char typed[] = "for (int i = 0; i < count; i++) { total += values[i]; }\n";
+    switch (stage) {
+        case BENCH_SCROLL:
+            // Scroll down for the first half of the stage and back up for the rest
+            scrollWithMouseWheel(ed, ctx, (i / 30) % 2 == 0 ? -1.0f : 1.0f);
+            break;
+        case BENCH_TYPE:
+            // A key a frame, inserted the way the app flushes a frame's typing
+            editorInsertText(ed, &typed[i % (sizeof(typed) - 1)], 1, 1);
+            break;
+        case BENCH_SELECT:
+            // Grow a selection down the file, then drop it and start again
+            if (i % 40 == 39) {
+                editorUnselectSelection(ed);
+            } else {
+                editorMoveDown(ed);
+                editorMakeSelection(ed);
+            }
+            break;
+        case BENCH_IDLE:
+            // Nothing happens but the cursor blinking
+            break;
+        default:
+            break;
+    }
+}
+
+// Writes the current framebuffer as a binary PPM, flipped so row 0 is the top.
+static void writeScreenshot(const char *path, i32 width, i32 height) {
+    u8 *pixels = (u8 *)malloc((size_t)width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        LOG_ERROR("Could not write screenshot %s", path);
+        free(pixels);
+        return;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", width, height);
+    for (i32 y = height - 1; y >= 0; y--) {
+        for (i32 x = 0; x < width; x++) {
+            fwrite(&pixels[((size_t)y * width + x) * 4], 1, 3, fp);
+        }
+    }
+    fclose(fp);
+    free(pixels);
+}
+
+// Prints s as a JSON string, quotes included.
+static void printJsonString(const char *s) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)s; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            printf("\\%c", *c);
+        } else if (*c < 0x20) {
+            printf("\\u%04x", *c);
+        } else {
+            putchar(*c);
+        }
+    }
+    putchar('"');
+}
+
+static int compareFloats(const void *a, const void *b) {
+    f32 fa = *(const f32 *)a;
+    f32 fb = *(const f32 *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// Prints the summary fields for one stage (or all frames when stage is -1).
+static void printTimings(const char *indent, BenchFrame *frames, u32 count, i32 stage, bool trailing_comma) {
+    f32 *sorted = (f32 *)malloc(MAX(count, 1) * sizeof(f32));
+    u32 n = 0;
+    RenderStats total = { 0 };
+    for (u32 i = 0; i < count; i++) {
+        if (stage >= 0 && frames[i].stage != (BenchStage)stage) {
+            continue;
+        }
+        sorted[n++] = frames[i].ms;
+        total.quads += frames[i].stats.quads;
+        total.draw_calls += frames[i].stats.draw_calls;
+        total.flushes += frames[i].stats.flushes;
+        total.bytes_uploaded += frames[i].stats.bytes_uploaded;
+        total.shaped_runs += frames[i].stats.shaped_runs;
+    }
+    qsort(sorted, n, sizeof(f32), compareFloats);
+
+    f64 sum = 0.0;
+    for (u32 i = 0; i < n; i++) {
+        sum += sorted[i];
+    }
+    f64 mean = n ? sum / n : 0.0;
+    f32 p50 = n ? sorted[n / 2] : 0.0f;
+    f32 p99 = n ? sorted[MIN(n - 1, (n * 99) / 100)] : 0.0f;
+    f32 max = n ? sorted[n - 1] : 0.0f;
+    free(sorted);
+
+    printf("%s\"frames\": %u,\n", indent, n);
+    printf("%s\"frame_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", indent, mean, p50, p99, max);
+    printf("%s\"per_frame\": { \"quads\": %.1f, \"draw_calls\": %.2f, \"flushes\": %.2f, \"bytes_uploaded\": %.1f, \"shaped_runs\": %.2f }%s\n", indent,
+        n ? (f64)total.quads / n : 0.0, n ? (f64)total.draw_calls / n : 0.0,
+        n ? (f64)total.flushes / n : 0.0, n ? (f64)total.bytes_uploaded / n : 0.0,
+        n ? (f64)total.shaped_runs / n : 0.0, trailing_comma ? "," : "");
+}
+
+int main(int argc, char **argv) {
+    const char *file_path = BENCH_DEFAULT_FILE;
+    u32 frame_count = BENCH_DEFAULT_FRAMES;
+    i32 width = INITIAL_SCREEN_WIDTH;
+    i32 height = INITIAL_SCREEN_HEIGHT;
+    bool sdf = false;
+    bool software = false;
+    bool ligatures = false;
+    const char *screenshot_path = NULL;
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_count = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sdf") == 0) {
+            sdf = true;
+        } else if (strcmp(argv[i], "--software") == 0) {
+            software = true;
+        } else if (strcmp(argv[i], "--ligatures") == 0) {
+            ligatures = true;
+        } else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) {
+            screenshot_path = argv[++i];
+        } else {
+            file_path = argv[i];
+        }
+    }
+    frame_count = MAX(frame_count, BENCH_STAGE_COUNT);
+
+    Headless headless;
+    headlessInit(&headless, width, height);
+
+    Config config = configInit();
+    loadConfigFromFile(&config, "./config/config.toml");
+    ColorTheme theme = colorThemeInit();
+    if (config.theme_path)
+        colorThemeLoad(&theme, config.theme_path);
+
+    // Renderer is large (it holds the vertex batch), keep it off the stack
+    Renderer *r = (Renderer *)malloc(sizeof(Renderer));
+    jobsInit(jobsDefaultThreads());
+    rendererInit(r, COLOR_BLACK);
+    rendererSetBackend(r, software ? RENDER_BACKEND_SOFTWARE : RENDER_BACKEND_GL);
+    r->font_format = sdf && !software ? GLYPH_ATLAS_SDF : GLYPH_ATLAS_BITMAP;
+    rendererSetLigatures(r, ligatures);
+    u32 font_id = rendererLoadFont(r, config.font_path, config.font_size);
+    rendererResizeWindow(r, width, height);
+
+    AppContext ctx = {
+        .font_id = font_id,
+        .glyph_adv = r->glyph_adv,
+        .line_height = r->font_atlases[font_id].line_height,
+        .descender = r->descender,
+        .screen_width = r->screen_width,
+        .screen_height = r->screen_height
+    };
+
+    Editor ed;
+    editorInit(&ed, rect_init(0, 0, width, height), &ctx, ".");
+    editorSetFrame(&ed, &ctx, rect_init(0, ctx.line_height, ctx.screen_width, ctx.screen_height - ctx.line_height));
+    editorLoadConfig(&ed, &config);
+    editorLoadFile(&ed, &ctx, file_path);
+
+    // All of the file is in before the first frame
+    while (editorLoading(&ed)) {
+        editorPollLoad(&ed);
+    }
+
+    // Drawn through a view like the editor's render thread, just on this one
+    EditorView view;
+    editorViewInit(&view);
+
+    BenchFrame *frames = (BenchFrame *)malloc(frame_count * sizeof(BenchFrame));
+    u32 stage_length = frame_count / BENCH_STAGE_COUNT;
+    for (u32 i = 0; i < frame_count; i++) {
+        BenchStage stage = (BenchStage)MIN(i / stage_length, BENCH_STAGE_COUNT - 1);
+        f64 start = getTimeSeconds();
+
+        benchStep(&ed, &ctx, stage, i - stage * stage_length);
+        editorUpdate(&ed, &ctx, BENCH_DELTA_TIME);
+
+        // Lexing is timed whole, not spread over frames like the editor does
+        while (!editorLexStep(&ed, INFINITY)) {}
+        editorViewUpdate(&view, &ed, NULL, &ctx);
+        rendererBegin(r);
+        renderEditor(r, &view, 1, 0, theme);
+        rendererEnd(r);
+
+        // Count the GPU's work too, there's no swap to wait on
+        glFinish();
+
+        frames[i].ms = (f32)((getTimeSeconds() - start) * 1000.0);
+        frames[i].stage = stage;
+        frames[i].stats = r->stats;
+    }
+
+    if (screenshot_path) {
+        writeScreenshot(screenshot_path, width, height);
+    }
+
+    const GLubyte *gl_renderer = glGetString(GL_RENDERER);
+    printf("{\n");
+    printf("  \"file\": ");
+    printJsonString(file_path);
+    printf(",\n  \"gl_renderer\": ");
+    printJsonString(gl_renderer ? (const char *)gl_renderer : "unknown");
+    printf(",\n");
+    printf("  \"width\": %d,\n", width);
+    printf("  \"height\": %d,\n", height);
+    printf("  \"backend\": \"%s\",\n", software ? "software" : "gl");
+    printf("  \"font_format\": \"%s\",\n", r->font_format == GLYPH_ATLAS_SDF ? "sdf" : "bitmap");
+    printf("  \"ligatures\": %s,\n", r->ligatures ? "true" : "false");
+    printTimings("  ", frames, frame_count, -1, true);
+    printf("  \"stages\": {\n");
+    for (u32 s = 0; s < BENCH_STAGE_COUNT; s++) {
+        printf("    \"%s\": {\n", stage_names[s]);
+        printTimings("      ", frames, frame_count, (i32)s, false);
+        printf("    }%s\n", s + 1 < BENCH_STAGE_COUNT ? "," : "");
+    }
+    printf("  },\n");
+    printf("  \"frame_log\": [\n");
+    for (u32 i = 0; i < frame_count; i++) {
+        printf("    { \"stage\": \"%s\", \"ms\": %.4f, \"quads\": %u, \"draw_calls\": %u, \"flushes\": %u, \"bytes_uploaded\": %llu, \"shaped_runs\": %u }%s\n",
+            stage_names[frames[i].stage], frames[i].ms, frames[i].stats.quads, frames[i].stats.draw_calls,
+            frames[i].stats.flushes, (unsigned long long)frames[i].stats.bytes_uploaded, frames[i].stats.shaped_runs,
+            i + 1 < frame_count ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+
+    free(frames);
+    editorViewDestroy(&view);
+    editorDestroy(&ed);
+    rendererDestroy(r);
+    free(r);
+    jobsDestroy();
+    configDestroy(&config);
+    headlessDestroy(&headless);
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include "browser.h"
 #include "util.h"
+#include "workers.h"
+#include "profiler.h"
 
 #define MAX_PATH_LEN 1024
 
@@ -10,6 +12,21 @@ static bool is_directory(const char *path) {
     return (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
 }
 
+// Entries checked by one job when scanning a directory.
+#define BROWSER_SCAN_CHUNK 64
+
+typedef struct {
+    BrowserItem *items;
+    size_t count;
+} ScanChunk;
+
+static void scanChunk(void *arg) {
+    ScanChunk *chunk = (ScanChunk *)arg;
+    for (size_t i = 0; i < chunk->count; i++) {
+        chunk->items[i].is_dir = is_directory(chunk->items[i].full_path);
+    }
+}
+
 static int compareItems (const void *a, const void *b) {
     BrowserItem *item_a = (BrowserItem *)a;
     BrowserItem *item_b = (BrowserItem *)b;
@@ -112,15 +129,11 @@ void getPaths(FileBrowser *fb) {
         // Build the full path for stat checking
         snprintf(full_path, MAX_PATH_LEN, "%s/%s", fb->cur_dir, entry->d_name);
 
-        // Determine if it's a directory
-        int is_dir = is_directory(full_path);
-
-        // Allocate and store the Item
+        // Allocate and store the Item, whether it's a directory is checked below
         BrowserItem item;
         browserItemInit(&item);
-        item.full_path = allocate_and_copy(full_path, is_dir); // Store the full path
-        item.name_ext = allocate_and_copy(entry->d_name, is_dir); // Store the name and extension
-        item.is_dir = is_dir; // Store if it's a directory
+        item.full_path = allocate_and_copy(full_path, 1); // Store the full path
+        item.name_ext = allocate_and_copy(entry->d_name, 1); // Store the name and extension
 
         // Reallocate memory if needed
         if (fb->num_paths >= fb->paths_capacity) {
@@ -141,6 +154,17 @@ void getPaths(FileBrowser *fb) {
     // Close the directory
     closedir(dir);
 
+    // Stat the entries in chunks spread over the workers, large directories
+    // (or slow file systems) would otherwise stall the editor
+    u32 chunk_count = (u32)((fb->num_paths + BROWSER_SCAN_CHUNK - 1) / BROWSER_SCAN_CHUNK);
+    ScanChunk *chunks = malloc(chunk_count * sizeof(ScanChunk));
+    for (u32 i = 0; i < chunk_count; i++) {
+        chunks[i].items = fb->items + (size_t)i * BROWSER_SCAN_CHUNK;
+        chunks[i].count = MIN(BROWSER_SCAN_CHUNK, fb->num_paths - (size_t)i * BROWSER_SCAN_CHUNK);
+    }
+    jobsRunBatch(scanChunk, chunks, sizeof(ScanChunk), chunk_count, PROFILE_JOB_SCAN);
+    free(chunks);
+
     // sort the paths
     qsort(fb->items, fb->num_paths, sizeof(BrowserItem), compareItems);
 }
@@ -9,6 +9,11 @@
 #define DEFAULT_THEME_PATH "./config/themes/spaceduck.toml"
 #define DEFAULT_FONT_SIZE 24
 #define DEFAULT_SHOW_FPS false 
+#define DEFAULT_SDF_FONTS false
+#define DEFAULT_SOFTWARE_RENDERER false
+#define DEFAULT_LIGATURES false
+#define DEFAULT_SHOW_PROFILER false
+#define DEFAULT_FRAME_BUDGET_MS 4.0
 
 /* DEFAULT EDITOR SETTINGS */
 #define DEFAULT_TAB_STOP 3
@@ -127,10 +132,30 @@ void colorThemeLoad(ColorTheme *theme, const char *path) {
     toml_free(theme_file);    
 }
 
+bool colorThemeEqual(const ColorTheme *a, const ColorTheme *b) {
+    return memcmp(a, b, sizeof(ColorTheme)) == 0;
+}
+
+ColorTheme colorThemeLerp(const ColorTheme *from, const ColorTheme *to, f32 t) {
+    ColorTheme theme;
+    const f32 *a = (const f32 *)from;
+    const f32 *b = (const f32 *)to;
+    f32 *out = (f32 *)&theme;
+    for (size_t i = 0; i < sizeof(ColorTheme) / sizeof(f32); i++) {
+        out[i] = lerp(a[i], b[i], t);
+    }
+    return theme;
+}
+
 Config configInit() {
     Config config;
     config.font_path = NULL;
     config.theme_path = NULL;
+    config.sdf_fonts = DEFAULT_SDF_FONTS;
+    config.software_renderer = DEFAULT_SOFTWARE_RENDERER;
+    config.ligatures = DEFAULT_LIGATURES;
+    config.show_profiler = DEFAULT_SHOW_PROFILER;
+    config.frame_budget_ms = DEFAULT_FRAME_BUDGET_MS;
     config.tab_stop = 3;
     config.cursor_speed = 3.5;
     config.numCommandConfigs = 0;
@@ -150,30 +175,82 @@ void configDestroy(Config *config) {
     }
 }
 
-void loadConfigFromFile(Config *config, const char* path) {
+// Keys of a command, either a key with its mods or a chord of keys pressed
+// one after another: chord = ["control+k", "control+c"]
+static bool loadCommandKeys(toml_table_t *command_table, CommandConfig *command_config) {
+    command_config->key_count = 0;
+
+    toml_array_t *chord = toml_array_in(command_table, "chord");
+    if (chord) {
+        int count = toml_array_nelem(chord);
+        if (count < 1 || count > MAX_CHORD_KEYS) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            toml_datum_t stroke = toml_string_at(chord, i);
+            if (!stroke.ok) {
+                return false;
+            }
+            bool known = getKeyStrokeFromString(stroke.u.s, &command_config->keys[i]);
+            free(stroke.u.s);
+            if (!known) {
+                return false;
+            }
+        }
+        command_config->key_count = (u32)count;
+        return true;
+    }
+
+    LOAD_TOML_STR(command_table, key);
+    if (!key.ok) {
+        return false;
+    }
+    KeyStroke *stroke = &command_config->keys[0];
+    stroke->key = getKeyFromString(key.u.s);
+    stroke->mods = 0;
+    free(key.u.s);
+
+    LOAD_TOML_STR_ARRAY(command_table, "mods", mods_array, mods_array_len, mods, mods_count);
+    for (size_t i = 0; i < mods_count; i++) {
+        stroke->mods |= getModFromString(mods[i]);
+        free(mods[i]);
+    }
+    free(mods);
+
+    command_config->key_count = 1;
+    return stroke->key != -1;
+}
+
+bool loadConfigFromFile(Config *config, const char* path) {
     FILE *fp;
     char errbuf[200];
 
     fp = fopen(path, "r");
+    if (!fp) {
+        LOG_ERROR("cannot open editor config file - %s", strerror(errno));
+        return false;
+    }
     
     toml_table_t *config_file = toml_parse_file(fp, errbuf, sizeof(errbuf));
     fclose(fp);
 
     if (!config_file) {
-        LOG_ERROR("cannot open editor config file - %c", strerror(errno));
-        return;
+        LOG_ERROR("cannot parse editor config file - %s", errbuf);
+        return false;
     }
 
     toml_table_t* general_table = toml_table_in(config_file, "general");
     if (!general_table) {
         LOG_ERROR("Config file missing [general]", "");
-        return;
+        toml_free(config_file);
+        return false;
     }
 
     toml_table_t* editor_table = toml_table_in(config_file, "editor");
     if (!editor_table) {
         LOG_ERROR("Config file missing [editor]", "");
-        return;
+        toml_free(config_file);
+        return false;
     }
 
     // Get data
@@ -181,6 +258,11 @@ void loadConfigFromFile(Config *config, const char* path) {
     LOAD_TOML_STR(general_table, theme);
     LOAD_TOML_INT(general_table, font_size);
     LOAD_TOML_BOOL(general_table, show_fps);
+    LOAD_TOML_BOOL(general_table, sdf_fonts);
+    LOAD_TOML_BOOL(general_table, software_renderer);
+    LOAD_TOML_BOOL(general_table, ligatures);
+    LOAD_TOML_BOOL(general_table, show_profiler);
+    LOAD_TOML_DOUBLE(general_table, frame_budget_ms);
 
     LOAD_TOML_INT(editor_table, tab_stop);
     LOAD_TOML_DOUBLE(editor_table, cursor_speed);
@@ -192,18 +274,24 @@ void loadConfigFromFile(Config *config, const char* path) {
     config->theme_path = theme.ok ? theme.u.s : DEFAULT_THEME_PATH;
     config->font_size = font_size.ok ? font_size.u.i : DEFAULT_FONT_SIZE;
     config->show_fps = show_fps.ok ? show_fps.u.b : DEFAULT_SHOW_FPS;
+    config->sdf_fonts = sdf_fonts.ok ? sdf_fonts.u.b : DEFAULT_SDF_FONTS;
+    config->software_renderer = software_renderer.ok ? software_renderer.u.b : DEFAULT_SOFTWARE_RENDERER;
+    config->ligatures = ligatures.ok ? ligatures.u.b : DEFAULT_LIGATURES;
+    config->show_profiler = show_profiler.ok ? show_profiler.u.b : DEFAULT_SHOW_PROFILER;
+    config->frame_budget_ms = frame_budget_ms.ok ? frame_budget_ms.u.d : DEFAULT_FRAME_BUDGET_MS;
 
     config->tab_stop = tab_stop.ok ? tab_stop.u.i : DEFAULT_TAB_STOP;
     config->cursor_speed = cursor_speed.ok ? cursor_speed.u.d : DEFAULT_CURSOR_SPEED;
     config->scroll_speed = scroll_speed.ok ? scroll_speed.u.i : DEFAULT_SCROLL_SPEED;
-    config->scroll_speed = scroll_speed.ok ? scroll_speed.u.i : DEFAULT_SCROLL_STOP_TOP;
+    config->scroll_stop_top = scroll_stop_top.ok ? scroll_stop_top.u.i : DEFAULT_SCROLL_STOP_TOP;
     config->scroll_stop_bottom = scroll_stop_bottom.ok ? scroll_stop_bottom.u.i : DEFAULT_SCROLL_STOP_BOTTOM;
 
     // Get Command Configs
     toml_table_t* keybinds_table = toml_table_in(config_file, "keybind");
     if (!keybinds_table) {
         LOG_ERROR("Config file missing [keybind]", "");
-        return;
+        toml_free(config_file);
+        return false;
     }
 
     // for each mode
@@ -218,49 +306,65 @@ void loadConfigFromFile(Config *config, const char* path) {
             if (!command) break;
             toml_table_t *command_table = toml_table_in(mode_keybind_table, command);
 
-            LOAD_TOML_STR(command_table, key);
-            LOAD_TOML_STR_ARRAY(command_table, "mods", mods_array, mods_array_len, mods, mods_count);
-
-            // get mods
-            int mod_bitmask = 0;
-            for (size_t k = 0; k < mods_count; k++) {
-                if (strcmp(mods[k], "alt") == 0) {
-                    mod_bitmask = mod_bitmask | GLFW_MOD_ALT;
-                } else if (strcmp(mods[k], "control") == 0) {
-                    mod_bitmask = mod_bitmask | GLFW_MOD_CONTROL;
-                } else if (strcmp(mods[k], "shift") == 0) {
-                    mod_bitmask = mod_bitmask | GLFW_MOD_SHIFT;
-                } else if (strcmp(mods[k], "super") == 0) {
-                    mod_bitmask = mod_bitmask | GLFW_MOD_SUPER;
-                }
+            CommandConfig *command_config = &config->commandConfigs[config->numCommandConfigs];
+            if (!loadCommandKeys(command_table, command_config)) {
+                LOG_WARN("Unknown key for %s, it isn't bound", command);
+                continue;
             }
-            int key_code = getKeyFromString(key.u.s);
-            config->commandConfigs[config->numCommandConfigs].key = key_code;
-            config->commandConfigs[config->numCommandConfigs].mods = mod_bitmask;
-            config->commandConfigs[config->numCommandConfigs].command_name = (char *)malloc(sizeof(char) * (strlen(command) + 1));
-            strcpy(config->commandConfigs[config->numCommandConfigs].command_name, command);
+            command_config->command_name = (char *)malloc(sizeof(char) * (strlen(command) + 1));
+            strcpy(command_config->command_name, command);
 
             if (strcmp(mode, "editor") == 0) {
-                config->commandConfigs[config->numCommandConfigs].mode = COMMAND_TYPE_EDITOR;
+                command_config->mode = COMMAND_TYPE_EDITOR;
             } else if (strcmp(mode, "browser") == 0){
-                config->commandConfigs[config->numCommandConfigs].mode = COMMAND_TYPE_BROWSER;
+                command_config->mode = COMMAND_TYPE_BROWSER;
             } else if (strcmp(mode, "global") == 0){
-                config->commandConfigs[config->numCommandConfigs].mode = COMMAND_TYPE_GLOBAL;
+                command_config->mode = COMMAND_TYPE_GLOBAL;
             } else {
-                config->commandConfigs[config->numCommandConfigs].mode = COMMAND_TYPE_SAVE_DIALOG;
+                command_config->mode = COMMAND_TYPE_SAVE_DIALOG;
             }
 
             config->numCommandConfigs++;
-
-            free(key.u.s);
-            for (size_t k = 0; k < mods_count; k++) {
-                if (mods[k]) {
-                    free(mods[k]);
-                }
-            }
-            free(mods);
         }
     }
 
     toml_free(config_file);
+    return true;
+}
+
+static bool stringsEqual(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+u32 configDiff(const Config *a, const Config *b) {
+    u32 changes = 0;
+    if (!stringsEqual(a->font_path, b->font_path) || a->font_size != b->font_size
+        || a->sdf_fonts != b->sdf_fonts || a->software_renderer != b->software_renderer
+        || a->ligatures != b->ligatures) {
+        changes |= CONFIG_CHANGED_RENDERER;
+    }
+    if (!stringsEqual(a->theme_path, b->theme_path)) {
+        changes |= CONFIG_CHANGED_THEME;
+    }
+    if (a->tab_stop != b->tab_stop || a->cursor_speed != b->cursor_speed || a->scroll_speed != b->scroll_speed) {
+        changes |= CONFIG_CHANGED_EDITOR;
+    }
+    if (a->show_profiler != b->show_profiler) {
+        changes |= CONFIG_CHANGED_PROFILER;
+    }
+
+    if (a->numCommandConfigs != b->numCommandConfigs) {
+        changes |= CONFIG_CHANGED_KEYBINDS;
+    } else {
+        for (size_t i = 0; i < a->numCommandConfigs; i++) {
+            const CommandConfig *x = &a->commandConfigs[i];
+            const CommandConfig *y = &b->commandConfigs[i];
+            if (x->key_count != y->key_count || memcmp(x->keys, y->keys, x->key_count * sizeof(KeyStroke)) != 0
+                || x->mode != y->mode || !stringsEqual(x->command_name, y->command_name)) {
+                changes |= CONFIG_CHANGED_KEYBINDS;
+                break;
+            }
+        }
+    }
+    return changes;
 }
@@ -70,6 +70,10 @@ typedef struct {
 
 ColorTheme colorThemeInit();
 void colorThemeLoad(ColorTheme *theme, const char *path);
+bool colorThemeEqual(const ColorTheme *a, const ColorTheme *b);
+
+// Blends every color of the two themes, t = 0 gives from and t = 1 gives to.
+ColorTheme colorThemeLerp(const ColorTheme *from, const ColorTheme *to, f32 t);
 
 
 typedef enum {
@@ -80,8 +84,8 @@ typedef enum {
 } CommandType;
 
 typedef struct {
-    int key;
-    int mods;
+    KeyStroke keys[MAX_CHORD_KEYS]; // more than one for a chord
+    u32 key_count;
     char *command_name;
     CommandType mode;
 } CommandConfig;
@@ -92,6 +96,11 @@ typedef struct {
     char *theme_path;
     i32 font_size;
     bool show_fps;
+    bool show_profiler;
+    bool sdf_fonts;
+    bool software_renderer;
+    bool ligatures;
+    f64 frame_budget_ms;
 
     // Editor
     i32 tab_stop;
@@ -104,6 +113,23 @@ typedef struct {
     size_t numCommandConfigs;
 } Config;
 
+// Parts of the config a reload has to apply again, see configDiff.
+typedef enum {
+    CONFIG_CHANGED_RENDERER = 1 << 0, // font, its size and format, backend, ligatures
+    CONFIG_CHANGED_THEME = 1 << 1,
+    CONFIG_CHANGED_EDITOR = 1 << 2,   // settings every editor keeps a copy of
+    CONFIG_CHANGED_KEYBINDS = 1 << 3,
+    CONFIG_CHANGED_PROFILER = 1 << 4
+} ConfigChange;
+
 Config configInit();
 void configDestroy(Config *config);
-void loadConfigFromFile(Config *config, const char* path);
\ No newline at end of file
+
+// Returns false if the file can't be read or parsed, config is then only
+// partly loaded.
+bool loadConfigFromFile(Config *config, const char* path);
+
+// ConfigChange flags of the fields that differ. Settings that are read where
+// they're used (show_fps, frame_budget_ms) need nothing applied, they're
+// left out.
+u32 configDiff(const Config *a, const Config *b);
\ No newline at end of file
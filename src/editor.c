@@ -1,5 +1,7 @@
 #include "editor.h"
+#include "profiler.h"
 #include <stdio.h>
+#include <string.h>
 
 Gutter gutterInit(vec2 screen_pos, f32 glyph_adv) {
     return (Gutter) {
@@ -20,8 +22,18 @@ static void calculateGutterWidth(Editor *ed, AppContext *ctx) {
 	ed->gutter.gutter_width = ctx->glyph_adv * gutter_padding;
 
     //update positions of everything
+    ed->text_pos = editorTextPos(ed, ctx, ed->frame);
+}
+
+vec2 editorTextPos(const Editor *ed, AppContext *ctx, rect frame) {
     f32 text_offset_x = ed->gutter.gutter_width + (ctx->glyph_adv * 3);
-    ed->text_pos = vec2_init(text_offset_x, ed->frame.y + ed->frame.h);
+    return vec2_init(frame.x + text_offset_x, frame.y + frame.h);
+}
+
+// Revisions are unique across editors, the renderer keys cached text on them
+static u64 nextRevision() {
+    static u64 revision = 0;
+    return ++revision;
 }
 
 void editorInit(Editor *ed, rect frame, AppContext *ctx, const char *cur_dir) {
@@ -36,8 +48,16 @@ void editorInit(Editor *ed, rect frame, AppContext *ctx, const char *cur_dir) {
     ed->scroll_mode = SCROLL_MODE_CURSOR;
     ed->line_count = 1;
     ed->file_path = NULL;
+    ed->loader = NULL;
+    ed->load_lexed = 0;
+    ed->reload_buf = NULL;
+    ed->reload_lines = 0;
+    ed->saved_hash = FNV_OFFSET_BASIS;
+    ed->saved_stamp = (FileStamp) { 0 };
     lexerInit(&ed->lexer);
     ed->dirty = true;
+    ed->revision = nextRevision();
+    ed->snapshot = NULL;
     ed->tab_stop = 4;
     ed->cursor_speed = 3.5;
     ed->scroll_speed = 1;
@@ -48,17 +68,40 @@ void editorInit(Editor *ed, rect frame, AppContext *ctx, const char *cur_dir) {
     fileBrowserInit(&ed->browser, vec2_init(frame.x, frame.h), cur_dir);
 }
 
+static void stopLoading(Editor *ed) {
+    if (ed->loader) {
+        fileLoaderDestroy(ed->loader);
+        free(ed->loader);
+        ed->loader = NULL;
+    }
+    if (ed->reload_buf) {
+        gapBufferDestroy(ed->reload_buf);
+        ed->reload_buf = NULL;
+    }
+}
+
+static u64 bufferHash(GapBuffer *buf) {
+    u64 hash = fnv1a(FNV_OFFSET_BASIS, buf->data, buf->gap_start);
+    return fnv1a(hash, buf->data + buf->gap_end, buf->end - buf->gap_end);
+}
+
 void editorDestroy(Editor *ed) {
+    stopLoading(ed);
+    if (ed->snapshot) {
+        textSnapshotRelease(ed->snapshot);
+        ed->snapshot = NULL;
+    }
     gapBufferDestroy(ed->buf);
     lexerDestroy(&ed->lexer);
     fileBrowserDestroy(&ed->browser);
+    free(ed->file_path);
+    ed->file_path = NULL;
 }
 
 void editorLoadConfig(Editor *ed, Config *config) {
     ed->tab_stop = config->tab_stop;
     ed->cursor_speed = config->cursor_speed;
     ed->scroll_speed = config->scroll_speed;
-    ed->dirty = true;
 }
 
 void editorChangeMode(Editor *ed, AppContext *ctx, EditorMode new_mode) {
@@ -154,8 +197,7 @@ void editorMoveUp(Editor *ed) {
         ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
         ed->goal_column = ed->cursor.disp_column;
     } else {
-        size_t len_prev_line = getBufLineLength(ed->buf, beg_prev_line);
-        ed->cursor.buffer_pos = beg_prev_line + MIN((size_t)ed->goal_column - 1, len_prev_line);
+        ed->cursor.buffer_pos = getBufCursorAtColumn(ed->buf, beg_prev_line, (size_t)ed->goal_column - 1);
         ed->cursor.disp_row--;
         ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
     }
@@ -178,8 +220,7 @@ void editorMoveDown(Editor *ed) {
         ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
         ed->goal_column = ed->cursor.disp_column;
     } else {
-        size_t len_next_line = getBufLineLength(ed->buf, beg_next_line);
-        ed->cursor.buffer_pos = beg_next_line + MIN((size_t)ed->goal_column - 1, len_next_line);
+        ed->cursor.buffer_pos = getBufCursorAtColumn(ed->buf, beg_next_line, (size_t)ed->goal_column - 1);
         ed->cursor.disp_row++;
         ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
     }
@@ -187,6 +228,10 @@ void editorMoveDown(Editor *ed) {
 }
 
 void editorInsertCharacter(Editor *ed, char character, bool move_cursor_forward) {
+    // Read-only until the file is loaded
+    if (editorLoading(ed)) {
+        return;
+    }
     if (ed->cursor.selection_size != 0) {
         editorDeleteSelection(ed);
     } else {
@@ -204,23 +249,62 @@ void editorInsertCharacter(Editor *ed, char character, bool move_cursor_forward)
     ed->dirty = true;
 }
 
+void editorInsertText(Editor *ed, const char *text, size_t len, size_t advance) {
+    if (len == 0 || editorLoading(ed)) {
+        return;
+    }
+    if (ed->cursor.selection_size != 0) {
+        editorDeleteSelection(ed);
+    } else {
+        editorUnselectSelection(ed);
+    }
+    ed->scroll_mode = SCROLL_MODE_CURSOR;
+    insertStringIntoBuf(ed->buf, ed->cursor.buffer_pos, text, len);
+
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '\n') {
+            ed->line_count++;
+            if (i < advance) {
+                ed->cursor.disp_row++;
+            }
+        }
+    }
+
+    ed->cursor.moved_last_frame = true;
+    ed->cursor.prev_buffer_pos = ed->cursor.buffer_pos;
+    ed->cursor.buffer_pos += advance;
+    ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
+    ed->cursor.pos_anim_time = 0.0f;
+    ed->goal_column = ed->cursor.disp_column;
+    ed->dirty = true;
+}
+
+// Removes the whole codepoint that ends at the cursor.
+static void removeCodepointBeforeCursor(Editor *ed) {
+    size_t prev = getPrevCharCursor(ed->buf, ed->cursor.buffer_pos);
+    for (size_t i = ed->cursor.buffer_pos; i > prev; i--) {
+        removeCharBeforeGap(ed->buf, i);
+    }
+    ed->cursor.prev_buffer_pos = ed->cursor.buffer_pos;
+    ed->cursor.buffer_pos = prev;
+}
+
 void editorDeleteCharLeft(Editor *ed) {
+    if (editorLoading(ed)) {
+        return;
+    }
     editorUnselectSelection(ed);
     ed->cursor.moved_last_frame = true;
     ed->scroll_mode = SCROLL_MODE_CURSOR;
     if (ed->cursor.buffer_pos != 0) {
         if (getBufChar(ed->buf, getPrevCharCursor(ed->buf, ed->cursor.buffer_pos)) != '\n') {
-            removeCharBeforeGap (ed->buf, ed->cursor.buffer_pos);
-            ed->cursor.prev_buffer_pos = ed->cursor.buffer_pos;
-            ed->cursor.buffer_pos = getPrevCharCursor(ed->buf, ed->cursor.buffer_pos);
+            removeCodepointBeforeCursor(ed);
             ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
             ed->goal_column = ed->cursor.disp_column;
             ed->cursor.pos_anim_time = 0.0f;
             ed->dirty = true;
         } else {
-            removeCharBeforeGap (ed->buf, ed->cursor.buffer_pos);
-            ed->cursor.prev_buffer_pos = ed->cursor.buffer_pos;
-            ed->cursor.buffer_pos = getPrevCharCursor(ed->buf, ed->cursor.buffer_pos);
+            removeCodepointBeforeCursor(ed);
             ed->cursor.disp_column = getBufColumn(ed->buf, ed->cursor.buffer_pos) + 1;
             ed->goal_column = ed->cursor.disp_column;
             ed->cursor.disp_row--;
@@ -232,6 +316,9 @@ void editorDeleteCharLeft(Editor *ed) {
 }
 
 void editorDeleteCharRight(Editor *ed) {
+    if (editorLoading(ed)) {
+        return;
+    }
     if (ed->mode != EDITOR_MODE_OPEN) {
         editorUnselectSelection(ed);
         ed->cursor.moved_last_frame = true;
@@ -239,10 +326,24 @@ void editorDeleteCharRight(Editor *ed) {
         if (removeCharAfterGap (ed->buf, ed->cursor.buffer_pos) == '\n') {
             ed->line_count = (ed->line_count - 1 < 1) ? 1 : ed->line_count - 1;
         }
+
+        // Drop the rest of a multi-byte sequence
+        while (ed->cursor.buffer_pos < getBufLength(ed->buf) && utf8IsContinuation(getBufChar(ed->buf, ed->cursor.buffer_pos))) {
+            removeCharAfterGap(ed->buf, ed->cursor.buffer_pos);
+        }
         ed->dirty = true;
     }
 }
 
+// Start lexing again after an edit, the steps are run by the caller
+static void restartLex(Editor *ed) {
+    if (ed->dirty) {
+        lexBegin(&ed->lexer, getBufString(ed->buf));
+        ed->dirty = false;
+        ed->revision = nextRevision();
+    }
+}
+
 void editorUpdate(Editor *ed, AppContext *ctx, f64 delta_time) {
     //Initial cursor position
     vec2 adj_cursor_pos = vec2_init(ed->text_pos.x, ed->text_pos.y - ctx->line_height - ctx->descender);
@@ -282,19 +383,156 @@ void editorUpdate(Editor *ed, AppContext *ctx, f64 delta_time) {
 
     ed->scroll_pos = vec2_lerp(ed->scroll_pos, ed->target_scroll_pos, (f32)delta_time  * 35.0f);
 
-    // Update frame
-    f32 STATUS_LINE_HEIGHT = ctx->line_height;
-    ed->frame = rect_init(0,0 + STATUS_LINE_HEIGHT, ctx->screen_width, ctx->screen_height - STATUS_LINE_HEIGHT);
-    ed->text_pos = vec2_init(ed->text_pos.x, 0 + ctx->screen_height);
     calculateGutterWidth(ed, ctx);
+    restartLex(ed);
+}
 
-    // Update the lexer
-    if (ed->dirty) {
-        char *data = getBufString(ed->buf);
-        lex(&ed->lexer, data);
-        free(data);
-        ed->dirty = false;
+bool editorLexStep(Editor *ed, f64 deadline) {
+    if (!lexPending(&ed->lexer)) {
+        return true;
+    }
+    profilerBeginPhase(PROFILE_LEX);
+    bool done = lexStep(&ed->lexer, deadline);
+    profilerEndPhase(PROFILE_LEX);
+
+    // The text didn't change, only its tokens, and those only once all are new
+    if (done) {
+        ed->revision = nextRevision();
+    }
+    return done;
+}
+
+void editorRelex(Editor *ed) {
+    ed->dirty = true;
+    restartLex(ed);
+}
+
+bool editorLexPending(const Editor *ed) {
+    return lexPending(&ed->lexer);
+}
+
+void textSnapshotRelease(TextSnapshot *snapshot) {
+    if (--snapshot->refs > 0) {
+        return;
+    }
+    free(snapshot->text);
+    free(snapshot->tokens);
+    free(snapshot->line_starts);
+    free(snapshot);
+}
+
+static void pushSnapshotToken(TextSnapshot *snapshot, size_t *capacity, TextToken token) {
+    if (token.length == 0) {
+        return;
+    }
+    if (snapshot->token_count == *capacity) {
+        *capacity *= 2;
+        snapshot->tokens = (TextToken *)realloc(snapshot->tokens, *capacity * sizeof(TextToken));
+    }
+    snapshot->tokens[snapshot->token_count++] = token;
+}
+
+// Adds the finished tokens overlapping [from, to) of the lexer's text, cut to
+// fit and moved by shift
+static void pushOldTokens(TextSnapshot *snapshot, size_t *capacity, const Lexer *lexer, size_t from, size_t to, i64 shift) {
+    size_t offset = 0;
+    for (size_t i = 0; i < lexer->token_count && offset < to; i++) {
+        size_t length = strlen(lexer->tokens[i].text);
+        size_t start = MAX(offset, from);
+        size_t end = MIN(offset + length, to);
+        if (start < end) {
+            pushSnapshotToken(snapshot, capacity, (TextToken) { (size_t)((i64)start + shift), end - start, lexer->tokens[i].type });
+        }
+        offset += length;
+    }
+}
+
+static void findLineStarts(TextSnapshot *snapshot) {
+    size_t capacity = 64;
+    snapshot->line_starts = (TextLineStart *)malloc(capacity * sizeof(TextLineStart));
+    snapshot->line_start_count = 0;
+
+    size_t line = 0;
+    size_t offset = 0;
+    bool line_start = true;
+    for (size_t i = 0; i <= snapshot->token_count; i++) {
+        if (line_start || i == snapshot->token_count) {
+            if (snapshot->line_start_count == capacity) {
+                capacity *= 2;
+                snapshot->line_starts = (TextLineStart *)realloc(snapshot->line_starts, capacity * sizeof(TextLineStart));
+            }
+            snapshot->line_starts[snapshot->line_start_count++] = (TextLineStart) { i, line, offset };
+        }
+        if (i == snapshot->token_count) {
+            break;
+        }
+
+        TextToken token = snapshot->tokens[i];
+        const char *text = snapshot->text + token.offset;
+        for (const char *c = memchr(text, '\n', token.length); c; c = memchr(c + 1, '\n', text + token.length - c - 1)) {
+            line++;
+        }
+        offset += token.length;
+        line_start = token.type == TOKEN_NEW_LINE;
+    }
+}
+
+TextSnapshot *editorTextSnapshot(Editor *ed) {
+    if (ed->snapshot && ed->snapshot->revision != ed->revision) {
+        textSnapshotRelease(ed->snapshot);
+        ed->snapshot = NULL;
+    }
+
+    if (!ed->snapshot) {
+        Lexer *lexer = &ed->lexer;
+        TextSnapshot *snapshot = (TextSnapshot *)malloc(sizeof(TextSnapshot));
+        size_t capacity = MAX(lexer->token_count + lexer->next_count, 16);
+        snapshot->tokens = (TextToken *)malloc(capacity * sizeof(TextToken));
+        snapshot->token_count = 0;
+
+        if (!lexer->source) {
+            pushOldTokens(snapshot, &capacity, lexer, 0, lexer->text_length, 0);
+            snapshot->length = lexer->text_length;
+            snapshot->text = (char *)malloc(snapshot->length + 1);
+            memcpy(snapshot->text, lexer->text ? lexer->text : "", snapshot->length);
+        } else {
+            // While lexing, the new tokens are used as far as they go, then
+            // the old ones where the text is unchanged, and a plain token
+            // per line for the edited text between
+            size_t lexed = 0;
+            for (size_t i = 0; i < lexer->next_count; i++) {
+                size_t length = strlen(lexer->next_tokens[i].text);
+                pushSnapshotToken(snapshot, &capacity, (TextToken) { lexed, length, lexer->next_tokens[i].type });
+                lexed += length;
+            }
+
+            size_t length = lexer->source_length;
+            i64 shift = (i64)length - (i64)lexer->text_length;
+            size_t edit_start = MAX(lexed, lexer->same_prefix);
+            size_t edit_end = MAX(edit_start, length - lexer->same_suffix);
+            pushOldTokens(snapshot, &capacity, lexer, lexed, edit_start, 0);
+            for (size_t start = edit_start; start < edit_end;) {
+                const char *newline = memchr(lexer->source + start, '\n', edit_end - start);
+                size_t end = newline ? (size_t)(newline - lexer->source) + 1 : edit_end;
+                pushSnapshotToken(snapshot, &capacity, (TextToken) { start, end - start, TOKEN_UNKNOWN });
+                start = end;
+            }
+            pushOldTokens(snapshot, &capacity, lexer, (size_t)((i64)edit_end - shift), lexer->text_length, shift);
+
+            snapshot->length = length;
+            snapshot->text = (char *)malloc(snapshot->length + 1);
+            memcpy(snapshot->text, lexer->source, snapshot->length);
+        }
+
+        snapshot->text[snapshot->length] = '\0';
+        findLineStarts(snapshot);
+        snapshot->revision = ed->revision;
+        snapshot->refs = 1;
+        ed->snapshot = snapshot;
     }
+
+    ed->snapshot->refs++;
+    return ed->snapshot;
 }
 
 void editorLoadFile(Editor *ed, AppContext *ctx, const char *file_path) {
@@ -307,29 +545,16 @@ void editorLoadFile(Editor *ed, AppContext *ctx, const char *file_path) {
     lexerUpdateFileType(&ed->lexer, ftype);
     free(file_name);
 
-     // If there's stuff in the editor already, we don't care for now just over write it
-    FILE *f = fopen(file_path, "r");
-    
-    if (f == NULL) {
+    // The text read is added to the end of the buffer, whatever's in it
+    // already stays
+    stopLoading(ed);
+    ed->load_lexed = 0;
+    getFileStamp(file_path, &ed->saved_stamp);
+    ed->loader = (FileLoader *)malloc(sizeof(FileLoader));
+    if (!fileLoaderStart(ed->loader, file_path, ed->tab_stop)) {
         LOG_INFO("No file named \'%s\', opening an empty file", file_path);
-    } else {
-        // Load the file into the editor
-        #define CHUNK 1024
-        char read_buf[CHUNK];
-        size_t nread;
-
-        while ((nread = fread(read_buf, 1, sizeof(read_buf), f)) > 0) {
-            for (size_t i = 0; i < nread; i++) {
-                if (read_buf[i] == '\t') {
-                    for (size_t i = 0; i < (size_t)ed->tab_stop; i++) {
-                        editorInsertCharacter(ed, ' ', true);
-                    }
-                } else {
-                    editorInsertCharacter(ed, read_buf[i], true);
-                }
-            }
-        }
-        fclose(f);
+        free(ed->loader);
+        ed->loader = NULL;
     }
 
     // move the cursor position back to the start of the file/ update some parameters
@@ -338,17 +563,193 @@ void editorLoadFile(Editor *ed, AppContext *ctx, const char *file_path) {
     ed->cursor.disp_row = 1;
     ed->cursor.disp_column = 1;
     ed->goal_column = -1;
-    ed->file_path = file_path;
+    if (ed->file_path != file_path) {
+        free(ed->file_path);
+        ed->file_path = (char *)malloc(strlen(file_path) + 1);
+        strcpy(ed->file_path, file_path);
+    }
     ed->dirty = true;
     calculateGutterWidth(ed, ctx);
 }
 
+bool editorReloadFile(Editor *ed) {
+    if (!ed->file_path) {
+        return true;
+    }
+
+    // Writing the file fires a change too, there's nothing new to read then
+    FileStamp stamp;
+    getFileStamp(ed->file_path, &stamp);
+    if (fileStampEqual(stamp, ed->saved_stamp)) {
+        return true;
+    }
+    ed->saved_stamp = stamp;
+
+    // A first load that was cut short starts over into an empty buffer
+    bool first_load = editorLoading(ed);
+    if (!first_load && bufferHash(ed->buf) != ed->saved_hash) {
+        return false;
+    }
+    stopLoading(ed);
+    if (first_load) {
+        gapBufferDestroy(ed->buf);
+        ed->buf = gapBufferInit(INITIAL_BUFFER_SIZE);
+        ed->line_count = 1;
+        ed->load_lexed = 0;
+        ed->dirty = true;
+    }
+
+    ed->loader = (FileLoader *)malloc(sizeof(FileLoader));
+    if (!fileLoaderStart(ed->loader, ed->file_path, ed->tab_stop)) {
+        LOG_INFO("Can't read %s again, keeping its text", ed->file_path);
+        free(ed->loader);
+        ed->loader = NULL;
+        return true;
+    }
+    if (!first_load) {
+        ed->reload_buf = gapBufferInit(INITIAL_BUFFER_SIZE);
+        ed->reload_lines = 0;
+    }
+    return true;
+}
+
+// Moves the cursor back into the text, on a codepoint, and works out its row
+// and column again
+static void placeCursor(Editor *ed) {
+    size_t length = getBufLength(ed->buf);
+    size_t pos = MIN(ed->cursor.buffer_pos, length);
+    while (pos > 0 && pos < length && utf8IsContinuation(getBufChar(ed->buf, pos))) {
+        pos--;
+    }
+    i64 anchor = (i64)pos - ed->cursor.selection_size;
+    if (anchor < 0 || anchor > (i64)length) {
+        ed->cursor.selection_size = 0;
+    }
+    ed->cursor.buffer_pos = pos;
+    ed->cursor.prev_buffer_pos = pos;
+
+    size_t row = 1;
+    for (size_t i = 0; i < pos; i++) {
+        if (getBufChar(ed->buf, i) == '\n') {
+            row++;
+        }
+    }
+    ed->cursor.disp_row = row;
+    ed->cursor.disp_column = getBufColumn(ed->buf, pos) + 1;
+}
+
+// Swaps in the reloaded text, unless it's what the buffer has already or the
+// buffer was edited while it was read. The edits are kept then and show as
+// unsaved against the file.
+static void finishReload(Editor *ed) {
+    GapBuffer *old = ed->buf;
+    u64 old_hash = bufferHash(old);
+    u64 hash = bufferHash(ed->reload_buf);
+    bool edited = old_hash != ed->saved_hash;
+    ed->saved_hash = hash;
+    if (edited) {
+        LOG_INFO("%s was edited while it was read again, keeping the edits", ed->file_path);
+        return;
+    }
+    if (getBufLength(ed->reload_buf) == getBufLength(old) && hash == old_hash) {
+        return;
+    }
+    ed->buf = ed->reload_buf;
+    ed->reload_buf = old;
+    ed->line_count = 1 + ed->reload_lines;
+    placeCursor(ed);
+    editorRelex(ed);
+}
+
+void editorPollLoad(Editor *ed) {
+    if (!ed->loader) {
+        return;
+    }
+
+    // Nothing before the end was edited while loading, so the cursors and
+    // panes looking at the text stay where they are
+    size_t length, lines;
+    char *text = fileLoaderTake(ed->loader, &length, &lines);
+    if (text && ed->reload_buf) {
+        insertStringIntoBuf(ed->reload_buf, getBufLength(ed->reload_buf), text, length);
+        ed->reload_lines += lines;
+    } else if (text) {
+        insertStringIntoBuf(ed->buf, getBufLength(ed->buf), text, length);
+        ed->line_count += lines;
+
+        // A relex copies and lexes the whole text, so it only shows more of
+        // it each time it doubled, which keeps the load O(n). Buffers in
+        // the background are lexed too, not just the one updated.
+        if (getBufLength(ed->buf) >= ed->load_lexed * 2) {
+            ed->load_lexed = getBufLength(ed->buf);
+            editorRelex(ed);
+        }
+    }
+    free(text);
+
+    if (fileLoaderDone(ed->loader)) {
+        if (ed->reload_buf) {
+            finishReload(ed);
+        } else {
+            if (getBufLength(ed->buf) != ed->load_lexed) {
+                editorRelex(ed);
+            }
+            ed->saved_hash = bufferHash(ed->buf);
+        }
+        stopLoading(ed);
+        LOG_INFO("Loaded %s", ed->file_path);
+    }
+}
+
+bool editorLoading(const Editor *ed) {
+    return ed->loader && !ed->reload_buf;
+}
+
+f32 editorLoadProgress(const Editor *ed) {
+    return ed->loader ? fileLoaderProgress(ed->loader) : 1.0f;
+}
+
+void editorSetFrame(Editor *ed, AppContext *ctx, rect frame) {
+    ed->frame = frame;
+    calculateGutterWidth(ed, ctx);
+}
+
+EditorPane editorSavePane(const Editor *ed) {
+    return (EditorPane) {
+        .cursor = ed->cursor,
+        .goal_column = ed->goal_column,
+        .frame = ed->frame,
+        .scroll_pos = ed->scroll_pos,
+        .target_scroll_pos = ed->target_scroll_pos,
+        .scroll_mode = ed->scroll_mode
+    };
+}
+
+void editorLoadPane(Editor *ed, AppContext *ctx, const EditorPane *pane) {
+    ed->cursor = pane->cursor;
+    ed->goal_column = pane->goal_column;
+    ed->scroll_pos = pane->scroll_pos;
+    ed->target_scroll_pos = pane->target_scroll_pos;
+    ed->scroll_mode = pane->scroll_mode;
+    placeCursor(ed);
+    resetAnimTime(&ed->cursor);
+    editorSetFrame(ed, ctx, pane->frame);
+}
+
 void editorWriteFile(Editor *ed) {
     if (!ed->file_path) {
         LOG_ERROR("Writing a blank file to disk is not supported!", "");
         return;
     }
 
+    // Only part of the file is in the buffer
+    if (editorLoading(ed)) {
+        LOG_ERROR("Can't write %s while it's still loading", ed->file_path);
+        return;
+    }
+    // What's written replaces whatever a reload is reading
+    stopLoading(ed);
+
     FILE *f = fopen(ed->file_path, "w");
     if (f == NULL) {
         LOG_ERROR("Couldn't open file with write access: ", ed->file_path);
@@ -361,6 +762,8 @@ void editorWriteFile(Editor *ed) {
         return;
     }
     fclose(f);
+    ed->saved_hash = bufferHash(ed->buf);
+    getFileStamp(ed->file_path, &ed->saved_stamp);
 
     LOG_INFO("Wrote to disk: %s", ed->file_path);
 }
@@ -432,6 +835,9 @@ void editorMoveBegOfPrevWord(Editor *ed) {
 }
 
 void editorDeleteWordLeft(Editor *ed) {
+    if (editorLoading(ed)) {
+        return;
+    }
     ed->scroll_mode = SCROLL_MODE_CURSOR;
     editorDeleteCharLeft(ed);
     char c = getBufChar(ed->buf, getPrevCharCursor(ed->buf, ed->cursor.buffer_pos));
@@ -458,6 +864,9 @@ void editorDeleteWordLeft(Editor *ed) {
 }
 
 void editorDeleteWordRight(Editor *ed) {
+    if (editorLoading(ed)) {
+        return;
+    }
     ed->scroll_mode = SCROLL_MODE_CURSOR;
     char c = getBufChar(ed->buf, ed->cursor.buffer_pos);
     
@@ -485,7 +894,9 @@ void editorDeleteWordRight(Editor *ed) {
 
 void moveCursorToMousePos(Editor *ed, AppContext *ctx, vec2 screen_pos) {
     ed->cursor.moved_last_frame = true;
-    i32 row = MAX((i32)((ed->scroll_pos.y + screen_pos.y) / ctx->line_height), 0);
+    // Mouse positions are from the top of the window, rows from the top of the frame
+    f32 frame_y = screen_pos.y - (ctx->screen_height - (ed->frame.y + ed->frame.h));
+    i32 row = MAX((i32)((ed->scroll_pos.y + frame_y) / ctx->line_height), 0);
     i32 col = MAX((i32)((screen_pos.x - ed->text_pos.x + (ctx->glyph_adv * 0.5)) / ctx->glyph_adv), 0);
 
     // clamp to maximum line
@@ -557,11 +968,9 @@ static void deleteSelectionLeft(Editor *ed) {
     if (ed->mode != EDITOR_MODE_OPEN) {
         ed->scroll_mode = SCROLL_MODE_CURSOR;
         ed->cursor.moved_last_frame = true;
-        size_t i = ed->cursor.buffer_pos;
         size_t selection_beg = ed->cursor.buffer_pos - ed->cursor.selection_size;
-        while (i > selection_beg) {
+        while (ed->cursor.buffer_pos > selection_beg) {
             editorDeleteCharLeft(ed);
-            i--;
         }
         editorUnselectSelection(ed);
     }
@@ -571,17 +980,19 @@ static void deleteSelectionRight(Editor *ed) {
     if (ed->mode != EDITOR_MODE_OPEN) {
         ed->scroll_mode = SCROLL_MODE_CURSOR;
         ed->cursor.moved_last_frame = true;
-        size_t i = ed->cursor.buffer_pos;
         size_t selection_end = ed->cursor.buffer_pos - ed->cursor.selection_size;
-        while (i < selection_end) {
+        size_t target_length = getBufLength(ed->buf) - (selection_end - ed->cursor.buffer_pos);
+        while (getBufLength(ed->buf) > target_length) {
             editorDeleteCharRight(ed);
-            i++;
         }
         editorUnselectSelection(ed);
     }
 }
 
 void editorDeleteSelection(Editor *ed) {
+    if (editorLoading(ed)) {
+        return;
+    }
     if (ed->cursor.selection_size > 0) {
         deleteSelectionLeft(ed);
     } else if (ed->cursor.selection_size < 0) {
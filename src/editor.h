@@ -8,6 +8,7 @@
 #include "cursor.h"
 #include "dialog.h"
 #include "context.h"
+#include "loader.h"
 
 #define CURSOR_SPEED 3.5
 #define INIT_EDITOR_FRAME rect_init(10, 0, INITIAL_SCREEN_WIDTH - 10, INITIAL_SCREEN_HEIGHT - 200)
@@ -31,6 +32,40 @@ typedef struct {
 
 Gutter gutterInit(vec2 screen_pos, f32 glyph_adv);
 
+// A token of a TextSnapshot, a slice of its text.
+typedef struct {
+    size_t offset; // also the token's buffer position
+    size_t length;
+    TokenType type;
+} TextToken;
+
+// Where a line starts in a TextSnapshot: the first token, or one after a new
+// line token. line counts the newlines before it.
+typedef struct {
+    size_t token;
+    size_t line;
+    size_t offset;
+} TextLineStart;
+
+// The text and tokens of one revision. Never changes once made, so the render
+// thread can draw it while the editor moves on to the next revision. Views of
+// the same revision share one, it's freed when the last reference goes.
+typedef struct {
+    char *text;
+    size_t length;
+    TextToken *tokens;
+    size_t token_count;
+
+    // The line starts in order and then the end, so the renderer can find
+    // the visible lines without walking the tokens above them
+    TextLineStart *line_starts;
+    size_t line_start_count;
+    u64 revision;
+    u32 refs; // only the editor thread takes and drops references
+} TextSnapshot;
+
+void textSnapshotRelease(TextSnapshot *snapshot);
+
 typedef struct {
     FileBrowser browser;
     Gutter gutter;
@@ -45,6 +80,8 @@ typedef struct {
     // Lexing stuff
     Lexer lexer;
     bool dirty;
+    u64 revision; // bumped on every edit and finished lex, tells the renderer the text changed
+    TextSnapshot *snapshot; // of the current revision, made on demand
 
     // Used to draw the editor
     rect frame;
@@ -55,7 +92,20 @@ typedef struct {
 
     // Stats to keep track of
     size_t line_count;
-    const char *file_path;
+    char *file_path; // owned, NULL for a new file
+
+    // Reads the file while it loads, NULL once it's all in the buffer. Until
+    // a first load is done the text can be looked at but not edited, a
+    // reload runs while editing goes on.
+    FileLoader *loader;
+    size_t load_lexed; // length of the text when a first load last relexed it
+
+    // A reload is read in here and swapped in whole, the old text stays on
+    // screen meanwhile
+    GapBuffer *reload_buf;
+    size_t reload_lines;
+    u64 saved_hash; // of the text as last read or written, to tell if it was edited
+    FileStamp saved_stamp; // of the file then, so the editor's own writes aren't reloaded
 
     // Configuration stuff
     i32 tab_stop;
@@ -66,15 +116,67 @@ typedef struct {
       
 } Editor;
 
+// Where one pane looks into an editor's text. Panes over the same editor each
+// have their own cursor, selection and scroll. The editor works with the
+// state of the focused pane, the others keep theirs in an EditorPane.
+typedef struct {
+    Cursor cursor;
+    i32 goal_column;
+    rect frame;
+    vec2 scroll_pos;
+    vec2 target_scroll_pos;
+    ScrollMode scroll_mode;
+} EditorPane;
+
 void editorInit(Editor *ed, rect frame, AppContext *ctx, const char *cur_dir);
 void editorDestroy(Editor *ed);
 void editorLoadConfig(Editor *ed, Config *config);
 void editorChangeMode(Editor *ed, AppContext *ctx, EditorMode new_mode);
 
+// Keeps a copy of file_path. The file is read in the background, the text
+// shows up as editorPollLoad adds it.
 void editorLoadFile(Editor *ed, AppContext *ctx, const char *file_path);
+
+// Reads the file again after it changed on disk. The cursor stays where it
+// was as far as the new text allows. Returns false, leaving the buffer
+// alone, when it has edits that weren't written. Nothing is reread if the
+// file is as the editor last read or wrote it, and a reread is dropped if
+// the text gets edited meanwhile.
+bool editorReloadFile(Editor *ed);
+
+// Adds the text read since the last poll to the buffer. Call every frame.
+void editorPollLoad(Editor *ed);
+// True during a first load, when the text is read only. Reloads don't count.
+bool editorLoading(const Editor *ed);
+f32 editorLoadProgress(const Editor *ed);
+
+// Places the editor's text on screen, set by the owner every frame.
+void editorSetFrame(Editor *ed, AppContext *ctx, rect frame);
+
+// Top left of the text drawn in frame, past the gutter.
+vec2 editorTextPos(const Editor *ed, AppContext *ctx, rect frame);
+
+EditorPane editorSavePane(const Editor *ed);
+
+// Makes the pane the one the editor works with. Its cursor is moved back
+// into the text, which may have been edited through another pane since.
+void editorLoadPane(Editor *ed, AppContext *ctx, const EditorPane *pane);
 void editorWriteFile(Editor *ed);
 void editorUpdate(Editor *ed, AppContext *ctx, f64 delta_time);
 
+// Edits restart lexing, which then runs in steps (see lexStep) so a large
+// file is highlighted over several frames. Until it's done the snapshot
+// holds the rest of the text unhighlighted.
+bool editorLexStep(Editor *ed, f64 deadline);
+
+// Lexes the text again from the start, after its syntax changed.
+void editorRelex(Editor *ed);
+bool editorLexPending(const Editor *ed);
+
+// A new reference to the snapshot of the current revision, made the first
+// time it's asked for. Drop it with textSnapshotRelease.
+TextSnapshot *editorTextSnapshot(Editor *ed);
+
 // Cursor Movements
 void editorMoveLeft(Editor *ed);
 void editorMoveRight(Editor *ed);
@@ -85,6 +187,10 @@ void editorMoveBegOfPrevWord(Editor *ed);
 
 // Buffer manipulation
 void editorInsertCharacter(Editor *ed, char character, bool move_cursor_forward);
+
+// Inserts text at the cursor (replacing the selection) and moves the cursor
+// advance bytes into it. A frame's worth of typing goes in with one call.
+void editorInsertText(Editor *ed, const char *text, size_t len, size_t advance);
 void editorDeleteCharLeft(Editor *ed);
 void editorDeleteCharRight(Editor *ed);
 void editorDeleteWordLeft(Editor *ed);
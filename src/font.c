@@ -1,84 +1,651 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include "util.h"
 #include "font.h"
+#include "workers.h"
+#include "profiler.h"
 
-void glyphAtlasInit(GlyphAtlas *atlas, FT_Face face, f32 *glyph_adv, f32 *descender) {
-    	//Creating a texture atlas
-	FT_GlyphSlot g = face->glyph;
-	u32 w = 0;
-	u32 h = 0;
+bool fontLibraryInit(FT_Library *library) {
+	if (FT_Init_FreeType(library)) {
+		return false;
+	}
+
+	// Wider spread than FreeType's default so SDF glyphs survive zooming out
+	FT_Int spread = GLYPH_SDF_SPREAD;
+	FT_Property_Set(*library, "sdf", "spread", &spread);
+	FT_Property_Set(*library, "bsdf", "spread", &spread);
+	return true;
+}
+
+static u32 hashCodepoint(u32 codepoint) {
+	return codepoint * 2654435761u;
+}
+
+static void uploadAtlas(GlyphAtlas *atlas) {
+	textureArraySetLayer(atlas->textures, atlas->layer, atlas->pixels, atlas->atlas_width, atlas->atlas_height);
+}
+
+// Uploads a sub-rectangle of the cpu mirror to the texture.
+static void uploadRegion(GlyphAtlas *atlas, u32 x, u32 y, u32 w, u32 h) {
+	textureArrayUploadRegion(atlas->textures, atlas->layer, x, y, w, h);
+}
+
+static void lookupInsert(GlyphAtlas *atlas, u32 pool_index) {
+	size_t mask = atlas->lookup_capacity - 1;
+	size_t slot = hashCodepoint(atlas->glyphs[pool_index].codepoint) & mask;
+	while (atlas->lookup[slot] != 0) {
+		slot = (slot + 1) & mask;
+	}
+	atlas->lookup[slot] = pool_index + 1;
+}
+
+static CachedGlyph *lookupFind(const GlyphAtlas *atlas, u32 codepoint) {
+	size_t mask = atlas->lookup_capacity - 1;
+	size_t slot = hashCodepoint(codepoint) & mask;
+	while (atlas->lookup[slot] != 0) {
+		CachedGlyph *glyph = &atlas->glyphs[atlas->lookup[slot] - 1];
+		if (glyph->codepoint == codepoint) {
+			return glyph;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+// Drops dead glyphs from the pool and rebuilds the hash table. Only happens
+// when the pool grows or a shelf gets evicted, so the O(n) cost is fine.
+static void rebuildLookup(GlyphAtlas *atlas) {
+	size_t alive = 0;
+	for (size_t i = 0; i < atlas->glyph_count; i++) {
+		if (atlas->glyphs[i].alive) {
+			atlas->glyphs[alive++] = atlas->glyphs[i];
+		}
+	}
+	atlas->glyph_count = alive;
+
+	while (atlas->lookup_capacity < atlas->glyph_capacity * 2) {
+		atlas->lookup_capacity *= 2;
+	}
+	free(atlas->lookup);
+	atlas->lookup = (u32 *)calloc(atlas->lookup_capacity, sizeof(u32));
+	for (size_t i = 0; i < atlas->glyph_count; i++) {
+		lookupInsert(atlas, i);
+	}
+}
+
+// Doubles the height or the width, the width first when a glyph min_width
+// wide doesn't fit across.
+static bool growAtlas(GlyphAtlas *atlas, u32 min_width) {
+	u32 new_w = atlas->atlas_width;
+	u32 new_h = atlas->atlas_height;
+	if (new_w < min_width) {
+		if (new_w * 2 > atlas->max_size) {
+			return false;
+		}
+		new_w *= 2;
+	} else if (new_h <= new_w && new_h * 2 <= atlas->max_size) {
+		new_h *= 2;
+	} else if (new_w * 2 <= atlas->max_size) {
+		new_w *= 2;
+	} else {
+		return false;
+	}
+
+	u8 *pixels = (u8 *)calloc((size_t)new_w * new_h, sizeof(u8));
+	for (u32 row = 0; row < atlas->atlas_height; row++) {
+		memcpy(pixels + (size_t)row * new_w, atlas->pixels + (size_t)row * atlas->atlas_width, atlas->atlas_width);
+	}
+	free(atlas->pixels);
+	atlas->pixels = pixels;
+	atlas->atlas_width = new_w;
+	atlas->atlas_height = new_h;
+	uploadAtlas(atlas);
+	return true;
+}
+
+static GlyphShelf *pushShelf(GlyphAtlas *atlas, u32 width, u32 height) {
+	if (width > atlas->atlas_width) {
+		return NULL;
+	}
+	u32 y = 0;
+	if (atlas->shelf_count > 0) {
+		GlyphShelf *last = &atlas->shelves[atlas->shelf_count - 1];
+		y = last->y + last->height;
+	}
+	if (y + height > atlas->atlas_height) {
+		return NULL;
+	}
+
+	if (atlas->shelf_count >= atlas->shelf_capacity) {
+		atlas->shelf_capacity *= 2;
+		atlas->shelves = (GlyphShelf *)realloc(atlas->shelves, atlas->shelf_capacity * sizeof(GlyphShelf));
+	}
+	atlas->shelves[atlas->shelf_count] = (GlyphShelf) { .y = y, .height = height, .x = 0, .last_used = atlas->frame, .pinned = false };
+	return &atlas->shelves[atlas->shelf_count++];
+}
+
+// Finds the shelf with the tightest height that still has room.
+static GlyphShelf *findShelf(GlyphAtlas *atlas, u32 w, u32 h) {
+	if (w > atlas->atlas_width) {
+		return NULL;
+	}
+	GlyphShelf *best = NULL;
+	for (size_t i = 0; i < atlas->shelf_count; i++) {
+		GlyphShelf *shelf = &atlas->shelves[i];
+		if (shelf->height < h || shelf->x + w > atlas->atlas_width) {
+			continue;
+		}
+		if (!best || shelf->height < best->height) {
+			best = shelf;
+		}
+	}
+
+	// Don't waste a tall shelf on a short glyph if we can open a new one
+	if (!best || best->height > h + h / 2) {
+		GlyphShelf *fresh = pushShelf(atlas, w, h);
+		if (fresh) {
+			return fresh;
+		}
+	}
+	return best;
+}
+
+// Evicts the least recently used shelf that can hold a glyph of height h.
+// Shelves touched this frame are skipped since queued quads still sample them.
+static bool evictShelf(GlyphAtlas *atlas, u32 h) {
+	GlyphShelf *victim = NULL;
+	for (size_t i = 0; i < atlas->shelf_count; i++) {
+		GlyphShelf *shelf = &atlas->shelves[i];
+		if (shelf->pinned || shelf->height < h || shelf->last_used >= atlas->frame) {
+			continue;
+		}
+		if (!victim || shelf->last_used < victim->last_used) {
+			victim = shelf;
+		}
+	}
+
+	if (!victim) {
+		return false;
+	}
+
+	u32 shelf_index = (u32)(victim - atlas->shelves);
+	for (size_t i = 0; i < atlas->glyph_count; i++) {
+		if (atlas->glyphs[i].shelf == shelf_index) {
+			atlas->glyphs[i].alive = false;
+		}
+	}
+	rebuildLookup(atlas);
+
+	for (u32 row = victim->y; row < victim->y + victim->height; row++) {
+		memset(atlas->pixels + (size_t)row * atlas->atlas_width, 0, victim->x);
+	}
+	uploadRegion(atlas, 0, victim->y, victim->x, victim->height);
+	victim->x = 0;
+	atlas->evictions++;
+	return true;
+}
+
+// Copies a w x h glyph bitmap into the atlas. Returns the index of the shelf
+// it landed in, or -1 if there is no room.
+static i32 packGlyph(GlyphAtlas *atlas, GlyphMetric *metric, const u8 *bitmap, u32 w, u32 h, i32 pitch) {
+	u32 padded_w = w + GLYPH_ATLAS_PADDING;
+	u32 padded_h = h + GLYPH_ATLAS_PADDING;
+
+	GlyphShelf *shelf = NULL;
+	while (!(shelf = findShelf(atlas, padded_w, padded_h))) {
+		if (growAtlas(atlas, padded_w)) {
+			continue;
+		}
+		// Evicting makes no room across, only down
+		if (padded_w > atlas->atlas_width || !evictShelf(atlas, padded_h)) {
+			return -1;
+		}
+	}
+
+	u32 x = shelf->x;
+	u32 y = shelf->y;
+	for (u32 row = 0; row < h; row++) {
+		memcpy(atlas->pixels + (size_t)(y + row) * atlas->atlas_width + x, bitmap + (i64)row * pitch, w);
+	}
+	uploadRegion(atlas, x, y, w, h);
+
+	shelf->x += padded_w;
+	shelf->last_used = atlas->frame;
+
+	metric->tx = (f32)x;
+	metric->ty = (f32)y;
+	return (i32)(shelf - atlas->shelves);
+}
+
+static FT_Error loadGlyphSlot(FT_Face face, u32 codepoint, FT_Int32 flags) {
+	if (codepoint & GLYPH_INDEX_FLAG) {
+		return FT_Load_Glyph(face, codepoint & ~GLYPH_INDEX_FLAG, flags);
+	}
+	return FT_Load_Char(face, codepoint, flags);
+}
+
+// Loads the codepoint into the face's glyph slot, rendered for the atlas format.
+static bool loadGlyph(FT_Face face, GlyphAtlasFormat format, u32 codepoint) {
+	if (format == GLYPH_ATLAS_SDF) {
+		if (loadGlyphSlot(face, codepoint, FT_LOAD_DEFAULT)) {
+			return false;
+		}
+		// Blank glyphs (spaces) only need their advance
+		FT_GlyphSlot g = face->glyph;
+		if (g->format == FT_GLYPH_FORMAT_OUTLINE && g->outline.n_points == 0) {
+			return true;
+		}
+		return FT_Render_Glyph(g, FT_RENDER_MODE_SDF) == 0;
+	}
+	return loadGlyphSlot(face, codepoint, FT_LOAD_RENDER) == 0;
+}
+
+static void fillMetric(GlyphMetric *metric, FT_GlyphSlot g) {
+	metric->ax = g->advance.x >> 6;
+	metric->ay = g->advance.y >> 6;
+	metric->bw = g->bitmap.width;
+	metric->bh = g->bitmap.rows;
+	metric->bl = g->bitmap_left;
+	metric->bt = g->bitmap_top;
+	metric->tx = 0;
+	metric->ty = 0;
+}
+
+// Baked atlases are cached on disk so startup (and config reloads) only need
+// a texture upload. A cache file holds the header, the font path, the pinned
+// shelves, the ASCII metrics and finally the atlas pixels.
+#define GLYPH_CACHE_MAGIC 0x4c544147u // "GATL"
+#define GLYPH_CACHE_VERSION 1
+
+typedef struct {
+	u32 magic;
+	u32 version;
+	u32 format;
+	u32 size_px;
+	u64 font_hash;
+	u32 path_length;
+	u32 atlas_width;
+	u32 atlas_height;
+	u32 shelf_count;
+	f32 line_height;
+	f32 glyph_adv;
+	f32 descender;
+} GlyphCacheHeader;
+
+// Hashes the contents of the font so an edited font never hits a stale cache.
+static bool hashFontFile(const char *path, u64 *hash) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+		return false;
+	}
+
+	u8 chunk[16384];
+	size_t read;
+	*hash = FNV_OFFSET_BASIS;
+	while ((read = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+		*hash = fnv1a(*hash, chunk, read);
+	}
+	fclose(fp);
+	return true;
+}
+
+// Returns the cache directory's <key>.atlas. The caller frees the result.
+static char *cacheFilePath(const char *font_path, u32 size_px, GlyphAtlasFormat format) {
+	u64 key = fnv1a(FNV_OFFSET_BASIS, font_path, strlen(font_path));
+	key = fnv1a(key, &size_px, sizeof(size_px));
+	key = fnv1a(key, &format, sizeof(format));
+
+	char file_name[32];
+	snprintf(file_name, sizeof(file_name), "%016llx.atlas", (unsigned long long)key);
+	return getCachePath(file_name);
+}
+
+static bool loadCache(GlyphAtlas *atlas, const char *cache_path, u64 font_hash) {
+	FILE *fp = fopen(cache_path, "rb");
+	if (!fp) {
+		return false;
+	}
+
+	GlyphCacheHeader header;
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1
+		&& header.magic == GLYPH_CACHE_MAGIC
+		&& header.version == GLYPH_CACHE_VERSION
+		&& header.format == (u32)atlas->format
+		&& header.size_px == atlas->size_px
+		&& header.font_hash == font_hash
+		&& header.path_length == strlen(atlas->font_path)
+		&& header.atlas_width <= atlas->max_size
+		&& header.atlas_height <= atlas->max_size
+		&& header.shelf_count > 0;
+
+	// Guard against hash collisions in the file name
+	if (ok) {
+		char *path = (char *)malloc(header.path_length + 1);
+		ok = fread(path, 1, header.path_length, fp) == header.path_length
+			&& memcmp(path, atlas->font_path, header.path_length) == 0;
+		free(path);
+	}
+
+	GlyphShelf *shelves = NULL;
+	u8 *pixels = NULL;
+	GlyphMetric ascii[GLYPH_ASCII_COUNT];
+	size_t pixel_count = 0;
+	if (ok) {
+		pixel_count = (size_t)header.atlas_width * header.atlas_height;
+		shelves = (GlyphShelf *)malloc(header.shelf_count * sizeof(GlyphShelf));
+		pixels = (u8 *)malloc(pixel_count);
+		ok = fread(shelves, sizeof(GlyphShelf), header.shelf_count, fp) == header.shelf_count
+			&& fread(ascii, sizeof(ascii), 1, fp) == 1
+			&& fread(pixels, 1, pixel_count, fp) == pixel_count;
+	}
+	fclose(fp);
+
+	if (!ok) {
+		free(shelves);
+		free(pixels);
+		return false;
+	}
+
+	free(atlas->pixels);
+	free(atlas->shelves);
+	atlas->pixels = pixels;
+	atlas->atlas_width = header.atlas_width;
+	atlas->atlas_height = header.atlas_height;
+	atlas->shelves = shelves;
+	atlas->shelf_count = header.shelf_count;
+	atlas->shelf_capacity = header.shelf_count;
+	for (size_t i = 0; i < atlas->shelf_count; i++) {
+		atlas->shelves[i].last_used = atlas->frame;
+	}
+	memcpy(atlas->ascii, ascii, sizeof(ascii));
+	atlas->base_line_height = header.line_height;
+	atlas->glyph_adv = header.glyph_adv;
+	atlas->descender = header.descender;
+	return true;
+}
+
+// Writes to a temporary file first so a crash never leaves a torn cache behind.
+static void saveCache(GlyphAtlas *atlas, const char *cache_path, u64 font_hash) {
+	size_t tmp_length = strlen(cache_path) + 5;
+	char *tmp_path = (char *)malloc(tmp_length);
+	snprintf(tmp_path, tmp_length, "%s.tmp", cache_path);
+
+	FILE *fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		LOG_DEBUG("Could not write glyph cache %s", tmp_path);
+		free(tmp_path);
+		return;
+	}
+
+	GlyphCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = GLYPH_CACHE_MAGIC;
+	header.version = GLYPH_CACHE_VERSION;
+	header.format = (u32)atlas->format;
+	header.size_px = atlas->size_px;
+	header.font_hash = font_hash;
+	header.path_length = (u32)strlen(atlas->font_path);
+	header.atlas_width = atlas->atlas_width;
+	header.atlas_height = atlas->atlas_height;
+	header.shelf_count = (u32)atlas->shelf_count;
+	header.line_height = atlas->base_line_height;
+	header.glyph_adv = atlas->glyph_adv;
+	header.descender = atlas->descender;
+
+	size_t pixel_count = (size_t)atlas->atlas_width * atlas->atlas_height;
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(atlas->font_path, 1, header.path_length, fp) == header.path_length
+		&& fwrite(atlas->shelves, sizeof(GlyphShelf), atlas->shelf_count, fp) == atlas->shelf_count
+		&& fwrite(atlas->ascii, sizeof(atlas->ascii), 1, fp) == 1
+		&& fwrite(atlas->pixels, 1, pixel_count, fp) == pixel_count;
+	ok = fclose(fp) == 0 && ok;
+
+	if (!ok || rename(tmp_path, cache_path) != 0) {
+		LOG_DEBUG("Could not write glyph cache %s", cache_path);
+		remove(tmp_path);
+	}
+	free(tmp_path);
+}
+
+// A range of ASCII rasterized by one job. FreeType faces can't be shared
+// between threads, so every job but the last opens the font on its own.
+typedef struct {
+	const char *font_path;
+	u32 size_px;
+	GlyphAtlasFormat format;
+	FT_Face face; // the atlas' face, or NULL to open one
+	u32 first;
+	u32 end;
+	bool failed;
+
+	bool loaded[GLYPH_ASCII_COUNT];
+	GlyphMetric metrics[GLYPH_ASCII_COUNT];
+	u8 *bitmaps[GLYPH_ASCII_COUNT]; // bw x bh, tightly packed
+} BakeJob;
+
+static void rasterizeGlyphs(BakeJob *job, FT_Face face) {
+	for (u32 i = job->first; i < job->end; i++) {
+		job->loaded[i] = loadGlyph(face, job->format, i);
+		if (!job->loaded[i]) {
+			continue;
+		}
+
+		FT_GlyphSlot g = face->glyph;
+		fillMetric(&job->metrics[i], g);
+		u32 w = g->bitmap.width;
+		u32 h = g->bitmap.rows;
+		job->bitmaps[i] = (u8 *)malloc((size_t)w * h + 1);
+		for (u32 row = 0; row < h; row++) {
+			memcpy(job->bitmaps[i] + (size_t)row * w, g->bitmap.buffer + (i64)row * g->bitmap.pitch, w);
+		}
+	}
+}
+
+static void bakeJob(void *arg) {
+	BakeJob *job = (BakeJob *)arg;
+	if (job->face) {
+		rasterizeGlyphs(job, job->face);
+		return;
+	}
+
+	FT_Library library;
+	FT_Face face;
+	if (!fontLibraryInit(&library)) {
+		job->failed = true;
+		return;
+	}
+	if (FT_New_Face(library, job->font_path, 0, &face) == 0) {
+		FT_Set_Pixel_Sizes(face, 0, job->size_px);
+		rasterizeGlyphs(job, face);
+		FT_Done_Face(face);
+	} else {
+		job->failed = true;
+	}
+	FT_Done_FreeType(library);
+}
+
+// Rasterizes printable ASCII into the atlas, measuring the font as we go.
+// Glyphs are rasterized in parallel but packed in order, so the atlas comes
+// out the same however many jobs ran.
+static void bakeAscii(GlyphAtlas *atlas) {
+	memset(atlas->ascii, 0, sizeof(atlas->ascii));
 	f32 top = 0;
+	f32 line_height = 0;
+	f32 adv = 0;
+
+	u32 job_count = MIN(jobsThreadCount() + 1, GLYPH_BAKE_JOBS_MAX);
+	BakeJob *jobs = (BakeJob *)calloc(job_count, sizeof(BakeJob));
+	for (u32 j = 0; j < job_count; j++) {
+		jobs[j].font_path = atlas->font_path;
+		jobs[j].size_px = atlas->size_px;
+		jobs[j].format = atlas->format;
+		jobs[j].face = j == job_count - 1 ? atlas->face : NULL;
+		jobs[j].first = 32 + (GLYPH_ASCII_COUNT - 32) * j / job_count;
+		jobs[j].end = 32 + (GLYPH_ASCII_COUNT - 32) * (j + 1) / job_count;
+	}
+	jobsRunBatch(bakeJob, jobs, sizeof(BakeJob), job_count, PROFILE_JOB_GLYPHS);
 
-	for (u8 i = 32; i < 128; i++) {
-		if (FT_Load_Char(face, i, FT_LOAD_RENDER)) {
-			LOG_ERROR("Loading character \'%c\' for atlas failed!", i);
-    		continue;
-		}
-
-		w += g->bitmap.width;
-		*glyph_adv = MAX(*glyph_adv, g->bitmap.width);
-		top = MAX(top, g->bitmap_top);
-		h = MAX(h, g->bitmap.rows);
-	}
-
-    atlas->atlas_width = w;
-    atlas->atlas_height = h;
-	*descender = atlas->atlas_height - top;
-	// for zero initializing the buffer
-	u8* blank_buffer = (u8*)malloc(sizeof(u8) * (size_t)w * (size_t)h);
-
-	// Make a blank texture the size needed for the atlas
-	glActiveTexture(GL_TEXTURE0);
-	glGenTextures(1, &(atlas->glyphs_texture));
-	glBindTexture(GL_TEXTURE_2D, atlas->glyphs_texture);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,
-		GL_RED,  // Single channel format for storing the alpha
-		w,
-		h,
-		0,
-		GL_RED,  // Using the red channel for alpha
-		GL_UNSIGNED_BYTE,
-		blank_buffer
-	);
-
-	free(blank_buffer);
-
-	// Add the glyphs to the atlas
-    int x = 0;
-    for (u8 i = 32; i < 128; ++i) {
-        if (FT_Load_Char(face, i, FT_LOAD_RENDER)) {
-			LOG_ERROR("Could not load glyph of a character with code %d", i);
-            continue;
-        }
-
-        atlas->metrics[i].ax = face->glyph->advance.x >> 6;
-        atlas->metrics[i].ay = face->glyph->advance.y >> 6;
-        atlas->metrics[i].bw = face->glyph->bitmap.width;
-        atlas->metrics[i].bh = face->glyph->bitmap.rows;
-        atlas->metrics[i].bl = face->glyph->bitmap_left;
-        atlas->metrics[i].bt = face->glyph->bitmap_top;
-        atlas->metrics[i].tx = (float) x / (float) atlas->atlas_width;
-
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexSubImage2D(
-            GL_TEXTURE_2D,
-            0,
-            x,
-            0,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-		);
-        x += face->glyph->bitmap.width;
-    }
-}
\ No newline at end of file
+	// SDF bitmaps carry the spread as padding on every side, which
+	// shouldn't count towards the measured size of the font
+	f32 pad = atlas->format == GLYPH_ATLAS_SDF ? GLYPH_SDF_SPREAD : 0;
+	for (u32 j = 0; j < job_count; j++) {
+		BakeJob *job = &jobs[j];
+		if (job->failed) {
+			// Couldn't open the font again, fall back to the atlas' face
+			job->face = atlas->face;
+			bakeJob(job);
+		}
+
+		for (u32 i = job->first; i < job->end; i++) {
+			if (!job->loaded[i]) {
+				LOG_ERROR("Could not load glyph of a character with code %d", i);
+				continue;
+			}
+
+			GlyphMetric *metric = &job->metrics[i];
+			if (metric->bw > 0 && metric->bh > 0) {
+				adv = MAX(adv, metric->bw - 2 * pad);
+				top = MAX(top, metric->bt - pad);
+				line_height = MAX(line_height, metric->bh - 2 * pad);
+			}
+
+			atlas->ascii[i] = *metric;
+			if (packGlyph(atlas, &atlas->ascii[i], job->bitmaps[i], (u32)metric->bw, (u32)metric->bh, (i32)metric->bw) < 0) {
+				LOG_ERROR("Glyph atlas is full, could not pack character with code %d", i);
+			}
+			free(job->bitmaps[i]);
+		}
+	}
+	free(jobs);
+
+	atlas->base_line_height = line_height;
+	atlas->glyph_adv = adv;
+	atlas->descender = line_height - top;
+}
+
+void glyphAtlasInit(GlyphAtlas *atlas, FT_Face face, GlyphAtlasFormat format, const char *font_path, u32 size_px, TextureArray *textures, f32 *glyph_adv, f32 *descender) {
+	atlas->face = face;
+	atlas->format = format;
+	atlas->font_path = (char *)malloc(strlen(font_path) + 1);
+	strcpy(atlas->font_path, font_path);
+	atlas->size_px = size_px;
+	atlas->scale = 1.0f;
+	atlas->frame = 1;
+	atlas->evictions = 0;
+
+	i32 layer = textureArrayAcquire(textures);
+	if (layer < 0) {
+		LOG_ERROR("No texture array layer left for font %s", font_path);
+		exit(1);
+	}
+	atlas->textures = textures;
+	atlas->layer = (u32)layer;
+	atlas->max_size = MIN(textures->max_size, GLYPH_ATLAS_MAX_SIZE);
+	atlas->atlas_width = GLYPH_ATLAS_INITIAL_SIZE;
+	atlas->atlas_height = GLYPH_ATLAS_INITIAL_SIZE;
+	atlas->pixels = (u8 *)calloc((size_t)atlas->atlas_width * atlas->atlas_height, sizeof(u8));
+
+	atlas->shelf_count = 0;
+	atlas->shelf_capacity = 16;
+	atlas->shelves = (GlyphShelf *)malloc(atlas->shelf_capacity * sizeof(GlyphShelf));
+
+	atlas->glyph_count = 0;
+	atlas->glyph_capacity = 64;
+	atlas->glyphs = (CachedGlyph *)malloc(atlas->glyph_capacity * sizeof(CachedGlyph));
+	atlas->lookup_capacity = 128;
+	atlas->lookup = (u32 *)calloc(atlas->lookup_capacity, sizeof(u32));
+
+	// Bake ASCII up front, or pull the baked result off disk
+	u64 font_hash = 0;
+	bool hashed = hashFontFile(font_path, &font_hash);
+	char *cache_path = hashed ? cacheFilePath(font_path, size_px, format) : NULL;
+	if (cache_path && loadCache(atlas, cache_path, font_hash)) {
+		uploadAtlas(atlas);
+	} else {
+		uploadAtlas(atlas);
+		bakeAscii(atlas);
+
+		// ASCII lives for the lifetime of the atlas
+		for (size_t i = 0; i < atlas->shelf_count; i++) {
+			atlas->shelves[i].pinned = true;
+		}
+		if (cache_path) {
+			saveCache(atlas, cache_path, font_hash);
+		}
+	}
+	free(cache_path);
+
+	atlas->line_height = atlas->base_line_height;
+	atlas->replacement = atlas->ascii['?'];
+	*glyph_adv = atlas->glyph_adv;
+	*descender = atlas->descender;
+}
+
+void glyphAtlasDestroy(GlyphAtlas *atlas) {
+	textureArrayRelease(atlas->textures, atlas->layer);
+	FT_Done_Face(atlas->face);
+	free(atlas->font_path);
+	free(atlas->pixels);
+	free(atlas->shelves);
+	free(atlas->glyphs);
+	free(atlas->lookup);
+}
+
+void glyphAtlasNextFrame(GlyphAtlas *atlas) {
+	atlas->frame++;
+}
+
+void glyphAtlasSetScale(GlyphAtlas *atlas, f32 scale) {
+	atlas->scale = scale;
+	atlas->line_height = atlas->base_line_height * scale;
+}
+
+GlyphMetric glyphAtlasGetGlyph(GlyphAtlas *atlas, u32 codepoint) {
+	if (codepoint < GLYPH_ASCII_COUNT) {
+		return codepoint < 32 ? atlas->replacement : atlas->ascii[codepoint];
+	}
+
+	CachedGlyph *cached = lookupFind(atlas, codepoint);
+	if (cached) {
+		if (cached->shelf < atlas->shelf_count) {
+			atlas->shelves[cached->shelf].last_used = atlas->frame;
+		}
+		return cached->metric;
+	}
+
+	bool missing = !(codepoint & GLYPH_INDEX_FLAG) && FT_Get_Char_Index(atlas->face, codepoint) == 0;
+	if (missing || !loadGlyph(atlas->face, atlas->format, codepoint)) {
+		return atlas->replacement;
+	}
+
+	CachedGlyph glyph = { .codepoint = codepoint, .shelf = UINT32_MAX, .alive = true };
+	FT_GlyphSlot g = atlas->face->glyph;
+	fillMetric(&glyph.metric, g);
+	if (glyph.metric.bw > 0 && glyph.metric.bh > 0) {
+		i32 shelf = packGlyph(atlas, &glyph.metric, g->bitmap.buffer, g->bitmap.width, g->bitmap.rows, g->bitmap.pitch);
+		if (shelf < 0) {
+			return atlas->replacement;
+		}
+		glyph.shelf = (u32)shelf;
+	}
+
+	if (atlas->glyph_count >= atlas->glyph_capacity) {
+		atlas->glyph_capacity *= 2;
+		atlas->glyphs = (CachedGlyph *)realloc(atlas->glyphs, atlas->glyph_capacity * sizeof(CachedGlyph));
+		rebuildLookup(atlas);
+	}
+	atlas->glyphs[atlas->glyph_count] = glyph;
+	lookupInsert(atlas, atlas->glyph_count);
+	atlas->glyph_count++;
+	return glyph.metric;
+}
+
+GlyphMetric glyphAtlasPeekGlyph(const GlyphAtlas *atlas, u32 codepoint) {
+	if (codepoint < GLYPH_ASCII_COUNT) {
+		return codepoint < 32 ? atlas->replacement : atlas->ascii[codepoint];
+	}
+	CachedGlyph *cached = lookupFind(atlas, codepoint);
+	return cached ? cached->metric : atlas->replacement;
+}
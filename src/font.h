@@ -3,6 +3,10 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+
+#include "util.h"
+#include "texarray.h"
 
 typedef struct {
     f32 ax; // advance.x
@@ -14,16 +18,124 @@ typedef struct {
     f32 bl; // bitmap_left;
     f32 bt; // bitmap_top;
 
-    f32 tx; // x offset of glyph in texture coordinates
+    f32 tx; // x offset of glyph in the atlas (texels)
+    f32 ty; // y offset of glyph in the atlas (texels)
 } GlyphMetric;
 
-#define GLYPH_METRICS_CAPACITY 128
+typedef enum {
+    GLYPH_ATLAS_BITMAP, // coverage bitmaps rasterized at the drawn size
+    GLYPH_ATLAS_SDF     // signed distance fields rasterized once and scaled
+} GlyphAtlasFormat;
+
+// SDF atlases are always rasterized at this size regardless of the font size.
+#define GLYPH_SDF_BASE_SIZE 48
+
+// Distance (in pixels at GLYPH_SDF_BASE_SIZE) encoded around each SDF glyph.
+#define GLYPH_SDF_SPREAD 8
+
+// Jobs ASCII is rasterized in when baking an atlas. Each opens its own face.
+#define GLYPH_BAKE_JOBS_MAX 4
+
+// Font atlases a renderer (and the shaper) can hold at once.
+#define MAX_FONT_ATLASES 8
+
+// Set on a glyph index (of the face) passed where a codepoint is expected.
+// Shaping picks glyphs no codepoint maps to, like ligatures.
+#define GLYPH_INDEX_FLAG 0x80000000u
+
+// ASCII glyphs are baked up front and never evicted from the atlas.
+#define GLYPH_ASCII_COUNT 128
+
+#define GLYPH_ATLAS_INITIAL_SIZE 256
+#define GLYPH_ATLAS_MAX_SIZE TEXTURE_ARRAY_MAX_SIZE
+
+// Gap between packed glyphs so linear filtering doesn't bleed neighbours in.
+#define GLYPH_ATLAS_PADDING 1
+
+// A horizontal strip of the atlas. Glyphs are packed left to right into the
+// shelf with the closest height, and whole shelves are evicted (least recently
+// used first) once the atlas can't grow any further.
+typedef struct {
+    u32 y;
+    u32 height;
+    u32 x;
+    u64 last_used;
+    bool pinned;
+} GlyphShelf;
+
+typedef struct {
+    u32 codepoint;
+    u32 shelf;
+    bool alive;
+    GlyphMetric metric;
+} CachedGlyph;
 
 typedef struct {
+    FT_Face face;
+    GlyphAtlasFormat format;
+    char *font_path;
+    u32 size_px; // size the glyphs were rasterized at
+
+    // Atlas dimensions. The atlas occupies the top left of its layer in the
+    // shared texture array. UVs handed to the renderer are in texels so the
+    // atlas (or the array) can grow without invalidating quads already in the batch.
     FT_UInt atlas_width;
     FT_UInt atlas_height;
-    GLuint glyphs_texture;
-    GlyphMetric metrics[GLYPH_METRICS_CAPACITY];
+    u32 max_size;
+    TextureArray *textures;
+    u32 layer;
+
+    // CPU side mirror of the texture, needed to re-upload when growing.
+    u8 *pixels;
+
+    // Drawn size / rasterized size. Always 1 for bitmap atlases.
+    f32 scale;
+
+    // Height of the tallest ASCII glyph; used as the editor line height.
+    // Scaled by the current scale, unlike the metrics below.
+    f32 line_height;
+    f32 base_line_height;
+    f32 glyph_adv;
+    f32 descender;
+
+    GlyphShelf *shelves;
+    size_t shelf_count;
+    size_t shelf_capacity;
+
+    // Pool of glyphs rasterized on demand, indexed through an open addressed
+    // hash table (codepoint -> pool index + 1, 0 is empty).
+    CachedGlyph *glyphs;
+    size_t glyph_count;
+    size_t glyph_capacity;
+    u32 *lookup;
+    size_t lookup_capacity;
+
+    GlyphMetric ascii[GLYPH_ASCII_COUNT];
+    GlyphMetric replacement;
+
+    // Bumped once per frame by the renderer to drive LRU eviction.
+    u64 frame;
+
+    // Bumped when a shelf is evicted. Geometry kept across frames (see
+    // RenderLayer) has to be rebuilt since its glyphs may be gone.
+    u64 evictions;
 } GlyphAtlas;
 
-void glyphAtlasInit(GlyphAtlas *atlas, FT_Face face, f32 *glyph_adv, f32 *descender);
\ No newline at end of file
+// Starts FreeType with the properties every atlas expects (the SDF spread).
+bool fontLibraryInit(FT_Library *library);
+
+// Bakes printable ASCII into a fresh atlas. The baked atlas is cached on disk,
+// keyed by font path, font file hash, pixel size and format, so later loads
+// of the same font only upload the cached bitmap.
+void glyphAtlasInit(GlyphAtlas *atlas, FT_Face face, GlyphAtlasFormat format, const char *font_path, u32 size_px, TextureArray *textures, f32 *glyph_adv, f32 *descender);
+void glyphAtlasDestroy(GlyphAtlas *atlas);
+void glyphAtlasNextFrame(GlyphAtlas *atlas);
+void glyphAtlasSetScale(GlyphAtlas *atlas, f32 scale);
+
+// Returns the metrics for the given codepoint (or GLYPH_INDEX_FLAG glyph),
+// rasterizing it into the atlas the first time it is seen. Metrics are unscaled.
+GlyphMetric glyphAtlasGetGlyph(GlyphAtlas *atlas, u32 codepoint);
+
+// Returns the metrics of a glyph already in the atlas, or the replacement glyph.
+// Never modifies the atlas, so several threads may peek while nobody gets glyphs.
+GlyphMetric glyphAtlasPeekGlyph(const GlyphAtlas *atlas, u32 codepoint);
@@ -81,6 +81,15 @@ void insertCharIntoBuf (GapBuffer *buf, size_t cursor, char c) {
     shiftGap(buf, cursor);
 }
 
+// One gap move and copy for the whole string, the gap is left after it.
+void insertStringIntoBuf (GapBuffer *buf, size_t cursor, const char *s, size_t len) {
+    assertCursorInvariants(buf, cursor);
+    resizeGap(buf, len);
+    shiftGap(buf, cursor);
+    memcpy(buf->data + buf->gap_start, s, len);
+    buf->gap_start += len;
+}
+
 void removeCharBeforeGap (GapBuffer *buf, size_t cursor) {
     if (cursor > 0) {
         shiftGap(buf, cursor);
@@ -120,22 +129,27 @@ void outputBufferString (GapBuffer *buf, size_t cursor) {
     free(temp);
 }
 
+// Cursors step over whole UTF-8 sequences, never landing on a continuation byte.
 size_t getNextCharCursor(GapBuffer *buf, size_t cursor) {
     assertCursorInvariants(buf, cursor);
-    if (cursor < getBufLength(buf)) {
-        return cursor + 1;
-    } else {
-        return cursor;
+    size_t length = getBufLength(buf);
+    if (cursor < length) {
+        cursor++;
+        while (cursor < length && utf8IsContinuation(getBufChar(buf, cursor))) {
+            cursor++;
+        }
     }
+    return cursor;
 }
 
 size_t getPrevCharCursor(GapBuffer *buf, size_t cursor) {
-    UNUSED(buf);
     if (cursor > 0) {
-        return cursor - 1;
-    } else {
-        return cursor;
+        cursor--;
+        while (cursor > 0 && utf8IsContinuation(getBufChar(buf, cursor))) {
+            cursor--;
+        }
     }
+    return cursor;
 }
 
 size_t getBeginningOfLineCursor(GapBuffer *buf, size_t cursor) {
@@ -173,12 +187,33 @@ size_t getBeginningOfPrevLineCursor(GapBuffer *buf, size_t cursor) {
     return getBeginningOfLineCursor(buf, getPrevCharCursor(buf, getBeginningOfLineCursor(buf, cursor)));
 }
 
+static size_t countCodepoints(GapBuffer *buf, size_t beg, size_t end) {
+    size_t count = 0;
+    for (size_t i = beg; i < end; i++) {
+        if (!utf8IsContinuation(getBufChar(buf, i))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Columns and line lengths are counted in codepoints, not bytes.
 size_t getBufColumn(GapBuffer *buf, size_t cursor) {
-    return cursor - getBeginningOfLineCursor(buf, cursor);
+    return countCodepoints(buf, getBeginningOfLineCursor(buf, cursor), cursor);
 }
 
 size_t getBufLineLength(GapBuffer* buf, size_t cursor) {
     size_t end = getEndOfLineCursor(buf, cursor);
     size_t beg = getBeginningOfLineCursor(buf, cursor);
-	return end - beg;
+	return countCodepoints(buf, beg, end);
+}
+
+size_t getBufCursorAtColumn(GapBuffer *buf, size_t line_beg, size_t column) {
+    size_t end = getEndOfLineCursor(buf, line_beg);
+    size_t cursor = line_beg;
+    while (column > 0 && cursor < end) {
+        cursor = getNextCharCursor(buf, cursor);
+        column--;
+    }
+    return cursor;
 }
\ No newline at end of file
@@ -20,6 +20,7 @@ char getBufChar(GapBuffer *buf, size_t cursor);
 void shiftGap (GapBuffer *buf, size_t cursor);
 void resizeGap(GapBuffer *buf, size_t required_space);
 void insertCharIntoBuf (GapBuffer *buf, size_t cursor, char c);
+void insertStringIntoBuf (GapBuffer *buf, size_t cursor, const char *s, size_t len);
 void removeCharBeforeGap (GapBuffer *buf, size_t cursor);
 char removeCharAfterGap (GapBuffer *buf, size_t cursor);
 char *getBufString (GapBuffer *buf);
@@ -33,4 +34,7 @@ size_t getBeginningOfNextLineCursor(GapBuffer *buf, size_t cursor);
 size_t getEndOfPrevLineCursor(GapBuffer *buf, size_t cursor);
 size_t getBeginningOfPrevLineCursor(GapBuffer *buf, size_t cursor);
 size_t getBufColumn(GapBuffer *buf, size_t cursor);
-size_t getBufLineLength(GapBuffer* buf, size_t cursor);
\ No newline at end of file
+size_t getBufLineLength(GapBuffer* buf, size_t cursor);
+
+// Cursor at the given (0 based) column of the line starting at line_beg, clamped to the line end.
+size_t getBufCursorAtColumn(GapBuffer *buf, size_t line_beg, size_t column);
\ No newline at end of file
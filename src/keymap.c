@@ -0,0 +1,152 @@
+#include <string.h>
+#include "keymap.h"
+
+static bool isCommandForMode(EditorMode mode, CommandType command_type) {
+    if (command_type == COMMAND_TYPE_GLOBAL)
+        return true;
+
+    switch (mode) {
+        case EDITOR_MODE_SAVE:
+            return (command_type == COMMAND_TYPE_SAVE_DIALOG);
+        case EDITOR_MODE_NORMAL:
+            return (command_type == COMMAND_TYPE_EDITOR);
+        case EDITOR_MODE_OPEN:
+            return (command_type == COMMAND_TYPE_BROWSER);
+        default:
+            return false;
+    }
+}
+
+static bool strokeInRange(KeyStroke stroke) {
+    return stroke.key >= 0 && stroke.key < KEYMAP_KEYS;
+}
+
+static u32 edgeSlot(u16 parent, KeyStroke stroke) {
+    u64 hash = fnv1a(FNV_OFFSET_BASIS, &parent, sizeof(parent));
+    hash = fnv1a(hash, &stroke, sizeof(stroke));
+    return (u32)hash & (KEYMAP_EDGE_SLOTS - 1);
+}
+
+// Slot of the edge, or the empty slot it would go in
+static KeymapEdge *findEdge(Keymap *km, u16 parent, KeyStroke stroke) {
+    u32 slot = edgeSlot(parent, stroke);
+    for (;;) {
+        KeymapEdge *edge = &km->edges[slot];
+        if (edge->child == 0 || (edge->parent == parent && edge->stroke.key == stroke.key && edge->stroke.mods == stroke.mods)) {
+            return edge;
+        }
+        slot = (slot + 1) & (KEYMAP_EDGE_SLOTS - 1);
+    }
+}
+
+static u16 newNode(Keymap *km) {
+    km->nodes[km->node_count] = (KeymapNode) { NULL, 0 };
+    return (u16)km->node_count++;
+}
+
+static bool bindInMode(Keymap *km, EditorMode mode, const KeyStroke *keys, u32 key_count, CommandFn command) {
+    u16 *root = &km->roots[mode][keys[0].mods][keys[0].key];
+    if (*root == 0) {
+        *root = newNode(km);
+    }
+
+    u16 node = *root;
+    for (u32 i = 1; i < key_count; i++) {
+        if (km->nodes[node].command) {
+            return false;
+        }
+        KeymapEdge *edge = findEdge(km, node, keys[i]);
+        if (edge->child == 0) {
+            *edge = (KeymapEdge) { node, newNode(km), keys[i] };
+            km->nodes[node].children++;
+        }
+        node = edge->child;
+    }
+
+    if (km->nodes[node].command || km->nodes[node].children > 0) {
+        return false;
+    }
+    km->nodes[node].command = command;
+    return true;
+}
+
+void keymapClear(Keymap *km) {
+    memset(km->roots, 0, sizeof(km->roots));
+    memset(km->edges, 0, sizeof(km->edges));
+    km->node_count = 1;
+    km->pending = 0;
+    km->pending_time = 0.0;
+}
+
+bool keymapBind(Keymap *km, const KeyStroke *keys, u32 key_count, CommandFn command, CommandType type) {
+    if (key_count == 0 || key_count > MAX_CHORD_KEYS) {
+        return false;
+    }
+
+    KeyStroke strokes[MAX_CHORD_KEYS];
+    for (u32 i = 0; i < key_count; i++) {
+        strokes[i] = (KeyStroke) { keys[i].key, keys[i].mods & (KEYMAP_MODS - 1) };
+        if (!strokeInRange(strokes[i])) {
+            return false;
+        }
+    }
+
+    bool bound = false;
+    for (u32 mode = 0; mode < KEYMAP_MODES; mode++) {
+        if (!isCommandForMode((EditorMode)mode, type)) {
+            continue;
+        }
+        if (km->node_count + key_count > MAX_KEYMAP_NODES) {
+            LOG_WARN("Too many keys bound, some keybinds are left out", "");
+            return bound;
+        }
+        bound |= bindInMode(km, (EditorMode)mode, strokes, key_count, command);
+    }
+    return bound;
+}
+
+KeymapResult keymapPress(Keymap *km, EditorMode mode, int key, int mods, f64 time, CommandFn *command) {
+    *command = NULL;
+    KeyStroke stroke = { key, mods & (KEYMAP_MODS - 1) };
+
+    if (km->pending && time - km->pending_time > CHORD_TIMEOUT) {
+        km->pending = 0;
+    }
+
+    u16 node = 0;
+    if (km->pending) {
+        // Pressing control again for control+k control+c
+        if (isModifierKey(key)) {
+            return KEYMAP_CHORD;
+        }
+        // A key that doesn't go on the chord ends it without doing anything
+        node = strokeInRange(stroke) ? findEdge(km, km->pending, stroke)->child : 0;
+        km->pending = 0;
+        if (node == 0) {
+            return KEYMAP_CHORD;
+        }
+    } else {
+        if (!strokeInRange(stroke) || (u32)mode >= KEYMAP_MODES) {
+            return KEYMAP_UNBOUND;
+        }
+        node = km->roots[mode][stroke.mods][stroke.key];
+        if (node == 0) {
+            return KEYMAP_UNBOUND;
+        }
+        if (km->nodes[node].command) {
+            *command = km->nodes[node].command;
+            return KEYMAP_COMMAND;
+        }
+    }
+
+    *command = km->nodes[node].command;
+    if (*command == NULL) {
+        km->pending = node;
+        km->pending_time = time;
+    }
+    return KEYMAP_CHORD;
+}
+
+bool keymapPending(const Keymap *km) {
+    return km->pending != 0;
+}
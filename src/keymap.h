@@ -0,0 +1,66 @@
+#pragma once
+#include "util.h"
+#include "keys.h"
+#include "config.h"
+#include "editor.h"
+
+// Editor modes with a table of their own, see EditorMode
+#define KEYMAP_MODES 3
+#define KEYMAP_KEYS (GLFW_KEY_LAST + 1)
+#define KEYMAP_MODS 16 // shift, control, alt and super
+
+// Nodes of the chord trie, a key bound in every mode takes one per mode
+#define MAX_KEYMAP_NODES 1024
+#define KEYMAP_EDGE_SLOTS (MAX_KEYMAP_NODES * 2) // power of two
+
+// Seconds a chord waits for its next key
+#define CHORD_TIMEOUT 1.5
+
+typedef void (*CommandFn)();
+
+typedef struct {
+    CommandFn command; // NULL while keys have to follow
+    u32 children;
+} KeymapNode;
+
+// Key following a node of a chord. Empty when child is 0.
+typedef struct {
+    u16 parent;
+    u16 child;
+    KeyStroke stroke;
+} KeymapEdge;
+
+typedef enum {
+    KEYMAP_UNBOUND, // not bound, input as usual
+    KEYMAP_COMMAND, // ran a command bound to the key alone
+    KEYMAP_CHORD    // part of a chord, the command is set if it was the last key
+} KeymapResult;
+
+// The keybinds compiled for lookup. The first key of each binding indexes
+// a table per mode directly, the keys after it of a chord are found through
+// a hash of (node, key, mods), so a key press costs the same however many
+// keys are bound. Nodes are numbered from 1, 0 means unbound.
+typedef struct {
+    u16 roots[KEYMAP_MODES][KEYMAP_MODS][KEYMAP_KEYS];
+    KeymapNode nodes[MAX_KEYMAP_NODES];
+    u32 node_count;
+    KeymapEdge edges[KEYMAP_EDGE_SLOTS];
+
+    // Chord waiting for its next key
+    u16 pending;
+    f64 pending_time;
+} Keymap;
+
+void keymapClear(Keymap *km);
+
+// Binds keys (more than one for a chord) in every mode of type. Like the
+// config reads, the first binding of a key wins: keys already bound, or
+// starting with a shorter binding, are left as they are. Returns false if
+// they weren't bound in any mode.
+bool keymapBind(Keymap *km, const KeyStroke *keys, u32 key_count, CommandFn command, CommandType type);
+
+// Looks up a key pressed at time (seconds), in mode. Modifier keys alone
+// don't break a chord.
+KeymapResult keymapPress(Keymap *km, EditorMode mode, int key, int mods, f64 time, CommandFn *command);
+
+bool keymapPending(const Keymap *km);
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include "keys.h"
 
 // Is there a better way of doing this?
@@ -131,3 +132,74 @@ int getKeyFromString (const char *keyName) {
     }
     return -1;
 }
+
+const char *getStringFromKey(int key) {
+    for (size_t i = 0; i < sizeof(keyMappings) / sizeof(KeyMapping); i++) {
+        if (keyMappings[i].key == key) {
+            return keyMappings[i].name;
+        }
+    }
+    return NULL;
+}
+
+bool isModifierKey(int key) {
+    return key >= GLFW_KEY_LEFT_SHIFT && key <= GLFW_KEY_RIGHT_SUPER;
+}
+
+static const KeyMapping modMappings[] = {
+    {"control", GLFW_MOD_CONTROL},
+    {"shift", GLFW_MOD_SHIFT},
+    {"alt", GLFW_MOD_ALT},
+    {"super", GLFW_MOD_SUPER}
+};
+
+int getModFromString(const char *modName) {
+    for (size_t i = 0; i < sizeof(modMappings) / sizeof(KeyMapping); i++) {
+        if (strcmp(modMappings[i].name, modName) == 0) {
+            return modMappings[i].key;
+        }
+    }
+    return 0;
+}
+
+bool getKeyStrokeFromString(const char *stroke, KeyStroke *out) {
+    out->mods = 0;
+
+    // Every part up to the last '+' is a mod
+    const char *part = stroke;
+    const char *plus;
+    while ((plus = strchr(part, '+')) != NULL) {
+        char mod[16];
+        size_t length = (size_t)(plus - part);
+        if (length >= sizeof(mod)) {
+            return false;
+        }
+        memcpy(mod, part, length);
+        mod[length] = '\0';
+
+        int bit = getModFromString(mod);
+        if (bit == 0) {
+            return false;
+        }
+        out->mods |= bit;
+        part = plus + 1;
+    }
+
+    out->key = getKeyFromString(part);
+    return out->key != -1;
+}
+
+void keyStrokeToString(KeyStroke stroke, char *out, size_t size) {
+    size_t length = 0;
+    out[0] = '\0';
+    for (size_t i = 0; i < sizeof(modMappings) / sizeof(KeyMapping); i++) {
+        if ((stroke.mods & modMappings[i].key) && length < size) {
+            length += snprintf(out + length, size - length, "%s+", modMappings[i].name);
+        }
+    }
+
+    const char *name = getStringFromKey(stroke.key);
+    if (length < size) {
+        snprintf(out + length, size - length, "%s", name ? name : "?");
+    }
+}
@@ -1,12 +1,37 @@
 #pragma once
 #include <string.h>
 #include <GLFW/glfw3.h>
+#include "util.h"
+
+// Most keys a chord takes, like control+k control+c.
+#define MAX_CHORD_KEYS 4
 
 typedef struct {
     const char *name;
     int key;
 } KeyMapping;
 
+// A key pressed together with its mods (GLFW_MOD_* bits).
+typedef struct {
+    int key;
+    int mods;
+} KeyStroke;
+
 // Gets the GLFW keycode from the given key name string. Returns -1 if not found.
 int getKeyFromString (const char *keyName);
 
+// Name of a GLFW keycode, NULL if it has none.
+const char *getStringFromKey(int key);
+
+// Shift, control, alt or super, either side.
+bool isModifierKey(int key);
+
+// Gets the GLFW_MOD_* bit of a mod name ("control", "shift", ...). Returns 0 if not found.
+int getModFromString(const char *modName);
+
+// Parses a key with its mods in front, like "control+shift+k". Returns false
+// if a name isn't known.
+bool getKeyStrokeFromString(const char *stroke, KeyStroke *out);
+
+// Writes a stroke the way getKeyStrokeFromString reads it.
+void keyStrokeToString(KeyStroke stroke, char *out, size_t size);
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <math.h>
 #include "lexer.h"
 
 // Highlighting files (hardcoded for now)
@@ -7,9 +8,13 @@
 #define TOML_HIGHLIGHTING_FILE "./config/syntaxes/toml.toml"
 #define PYTHON_HIGHLIGHTING_FILE "./config/syntaxes/python.toml"
 
-static int is_keyword(Lexer *lexer, const char *word) {
-    for (size_t i = 0; i < lexer->keywords_count; i++) {
-        char *keyword = lexer->keywords[i];
+// Loaded syntaxes by file type, and the one of files without highlighting
+static Syntax *syntaxes[FILE_TYPE_UNKNOWN];
+static Syntax no_syntax;
+
+static int is_keyword(const Syntax *syntax, const char *word) {
+    for (size_t i = 0; i < syntax->keywords_count; i++) {
+        char *keyword = syntax->keywords[i];
         if (strcmp(word, keyword) == 0) {
             return 1;
         }
@@ -17,9 +22,9 @@ static int is_keyword(Lexer *lexer, const char *word) {
     return 0;
 }
 
-static int is_secondary_keyword(Lexer *lexer, const char *word) {
-    for (size_t i = 0; i < lexer->secondary_keywords_count; i++) {
-        char *sec_keyword = lexer->secondary_keywords[i];
+static int is_secondary_keyword(const Syntax *syntax, const char *word) {
+    for (size_t i = 0; i < syntax->secondary_keywords_count; i++) {
+        char *sec_keyword = syntax->secondary_keywords[i];
         if (strcmp(word, sec_keyword) == 0) {
             return 1;
         }
@@ -27,9 +32,9 @@ static int is_secondary_keyword(Lexer *lexer, const char *word) {
     return 0;
 }
 
-static int is_preproc_directive(Lexer *lexer, const char *word) {
-    for (size_t i = 0; i < lexer->preproc_directives_count; i++) {
-        char *preprocessor = lexer->preproc_directives[i];
+static int is_preproc_directive(const Syntax *syntax, const char *word) {
+    for (size_t i = 0; i < syntax->preproc_directives_count; i++) {
+        char *preprocessor = syntax->preproc_directives[i];
         if (strcmp(word, preprocessor) == 0) {
             return 1;
         }
@@ -37,9 +42,9 @@ static int is_preproc_directive(Lexer *lexer, const char *word) {
     return 0;
 }
 
-static int is_symbol(Lexer *lexer, char character) {
-    for (size_t i = 0; i < lexer->symbols_count; i++) {
-        char *symbol = lexer->symbols[i];
+static int is_symbol(const Syntax *syntax, char character) {
+    for (size_t i = 0; i < syntax->symbols_count; i++) {
+        char *symbol = syntax->symbols[i];
         if (symbol && character == symbol[0]) {
             return 1;
         }
@@ -63,9 +68,9 @@ static int isOctalNumber(char source) {
     return 0;
 }
 
-static int is_built_in_type(Lexer *lexer, const char *word) {
-    for (size_t i = 0; i < lexer->built_in_types_count; i++) {
-        char *built_in_type = lexer->built_in_types[i];
+static int is_built_in_type(const Syntax *syntax, const char *word) {
+    for (size_t i = 0; i < syntax->built_in_types_count; i++) {
+        char *built_in_type = syntax->built_in_types[i];
         if (strcmp(word, built_in_type) == 0) {
             return 1;
         }
@@ -131,119 +136,78 @@ void tokenPushChar(Token *token, char c) {
 void lexerInit(Lexer* lexer) {
     lexer->tokens = NULL;
     lexer->token_count = 0;
-    lexer->capacity = 10;
+    lexer->capacity = 0;
+    lexer->text = NULL;
+    lexer->text_length = 0;
     lexer->file_type = FILE_TYPE_UNKNOWN;
-        // sizes of data buffers
-    lexer->keywords_count = 0;
-    lexer->symbols_count = 0;
-    lexer->built_in_types_count = 0;
-    lexer->preproc_directives_count = 0;
-    lexer->secondary_keywords_count = 0;
-
-    // data buffers
-    lexer->keywords = NULL;
-    lexer->symbols = NULL;
-    lexer->built_in_types = NULL;
-    lexer->preproc_directives = NULL;
-    lexer->secondary_keywords = NULL;
-
-    // Comment stuff
-    lexer->comment_single_prefix.u.s = NULL;
-    lexer->comment_single_prefix.u.ts = NULL;
-    lexer->comment_multi_begin.u.s = NULL;
-    lexer->comment_multi_begin.u.ts = NULL;
-    lexer->comment_multi_end.u.s = NULL;
-    lexer->comment_multi_end.u.ts = NULL;
-
-    lexer->id_heuristics = false;
+    lexer->syntax = &no_syntax;
+
+    lexer->source = NULL;
+    lexer->source_length = 0;
+    lexer->position = 0;
+    lexer->pending = createToken();
+    lexer->next_tokens = NULL;
+    lexer->next_count = 0;
+    lexer->next_capacity = 10;
+    lexer->same_prefix = 0;
+    lexer->same_suffix = 0;
+}
+
+static void destroyTokens(Token *tokens, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        tokenDestroy(&tokens[i]);
+    }
 }
 
 void lexerDestroy(Lexer *lexer) {
     if (lexer->tokens) {
-        for (size_t i = 0; i < lexer->token_count; i++) {
-            tokenDestroy(&lexer->tokens[i]);
-        }
+        destroyTokens(lexer->tokens, lexer->token_count);
         free(lexer->tokens);
     }
-        
-    if (lexer->keywords) {
-        for (size_t i = 0; i< lexer->keywords_count; i++) {
-            free(lexer->keywords[i]);
-        }
-        free(lexer->keywords);
-    }
-    
-    if (lexer->symbols) {
-        for (size_t i = 0; i< lexer->symbols_count; i++) {
-            free(lexer->symbols[i]);
-        }
-        free(lexer->symbols);
-    }
-
-    if (lexer->built_in_types) {
-        for (size_t i = 0; i< lexer->built_in_types_count; i++) {
-            free(lexer->built_in_types[i]);
-        }
-        free(lexer->built_in_types);
+    if (lexer->next_tokens) {
+        destroyTokens(lexer->next_tokens, lexer->next_count);
+        free(lexer->next_tokens);
     }
 
-    if (lexer->secondary_keywords) {
-        for (size_t i = 0; i< lexer->secondary_keywords_count; i++) {
-            free(lexer->secondary_keywords[i]);
-        }
-        free(lexer->secondary_keywords);
-    }
-
-    if (lexer->preproc_directives) {
-        for (size_t i = 0; i< lexer->preproc_directives_count; i++) {
-            free(lexer->preproc_directives[i]);
-        }
-        free(lexer->preproc_directives);
-    }
-
-    if (lexer->comment_single_prefix.u.s)
-        free(lexer->comment_single_prefix.u.s);
-
-    if (lexer->comment_multi_begin.u.s)
-        free(lexer->comment_multi_begin.u.s);
-
-    if (lexer->comment_multi_end.u.s)
-        free(lexer->comment_multi_end.u.s);
-}
-
-void lexerClearTokens(Lexer *lexer) {
-    if (lexer->tokens) {
-        for (size_t i = 0; i < lexer->token_count; i++) {
-            tokenDestroy(&lexer->tokens[i]);
-        }
-    }
+    if (lexer->source)
+        free(lexer->source);
+    if (lexer->text)
+        free(lexer->text);
+    tokenDestroy(&lexer->pending);
 }
 
-static void loadHighlightingInfo (Lexer *lexer, FileType file_type) {
-    FILE *fp;
-    char errbuf[200];
-
+const char *syntaxFilePath(FileType file_type) {
     switch (file_type)
     {
     case FILE_TYPE_C:
-        fp = fopen(C_HIGHLIGHTING_FILE, "r");
-        break;
+        return C_HIGHLIGHTING_FILE;
 
     case FILE_TYPE_MAKEFILE:
-        fp = fopen(MAKEFILE_HIGHLIGHTING_FILE, "r");
-        break;
+        return MAKEFILE_HIGHLIGHTING_FILE;
 
     case FILE_TYPE_TOML:
-        fp = fopen(TOML_HIGHLIGHTING_FILE, "r");
-        break;
+        return TOML_HIGHLIGHTING_FILE;
 
     case FILE_TYPE_PYTHON:
-        fp = fopen(PYTHON_HIGHLIGHTING_FILE, "r");
-        break;
+        return PYTHON_HIGHLIGHTING_FILE;
     
     default:
+        return NULL;
+    }
+}
+
+static void syntaxLoad(Syntax *syntax, FileType file_type) {
+    char errbuf[200];
+    const char *path = syntaxFilePath(file_type);
+    if (!path) {
+        return;
+    }
+
+    getFileStamp(path, &syntax->stamp);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        LOG_ERROR("cannot open highlighting file %s", path);
         return;
-        break;
     }
 
     toml_table_t *hl_conf = toml_parse_file(fp, errbuf, sizeof(errbuf));
@@ -271,50 +235,126 @@ static void loadHighlightingInfo (Lexer *lexer, FileType file_type) {
     LOAD_TOML_STR_ARRAY(hl_table, "secondary_keywords", secondary_keywords_array, secondary_keywords_array_len, secondary_keywords, secondary_keywords_count);
     LOAD_TOML_BOOL(hl_table, identifier_heuristics);
 
-    lexer->comment_single_prefix = comment_single_prefix;  
-    lexer->comment_multi_begin = comment_multi_begin;   
-    lexer->comment_multi_end = comment_multi_end;
-    lexer->keywords_count = keywords_count;
-    lexer->keywords = keywords;
-    lexer->symbols_count = symbols_count;
-    lexer->symbols = symbols;
-    lexer->built_in_types_count = built_in_types_count;
-    lexer->built_in_types = built_in_types;
-    lexer->preproc_directives_count = preproc_directives_count;
-    lexer->preproc_directives = preproc_directives;
-    lexer->secondary_keywords_count = secondary_keywords_count;
-    lexer->secondary_keywords = secondary_keywords;
-    lexer->id_heuristics = identifier_heuristics.u.b;
-
-    lexer->file_type = file_type;
+    syntax->comment_single_prefix = comment_single_prefix;  
+    syntax->comment_multi_begin = comment_multi_begin;   
+    syntax->comment_multi_end = comment_multi_end;
+    syntax->keywords_count = keywords_count;
+    syntax->keywords = keywords;
+    syntax->symbols_count = symbols_count;
+    syntax->symbols = symbols;
+    syntax->built_in_types_count = built_in_types_count;
+    syntax->built_in_types = built_in_types;
+    syntax->preproc_directives_count = preproc_directives_count;
+    syntax->preproc_directives = preproc_directives;
+    syntax->secondary_keywords_count = secondary_keywords_count;
+    syntax->secondary_keywords = secondary_keywords;
+    syntax->id_heuristics = identifier_heuristics.u.b;
 
     toml_free(hl_conf);
 }
 
+static void syntaxFree(Syntax *syntax) {
+    if (syntax->keywords) {
+        for (size_t i = 0; i< syntax->keywords_count; i++) {
+            free(syntax->keywords[i]);
+        }
+        free(syntax->keywords);
+    }
+    
+    if (syntax->symbols) {
+        for (size_t i = 0; i< syntax->symbols_count; i++) {
+            free(syntax->symbols[i]);
+        }
+        free(syntax->symbols);
+    }
+
+    if (syntax->built_in_types) {
+        for (size_t i = 0; i< syntax->built_in_types_count; i++) {
+            free(syntax->built_in_types[i]);
+        }
+        free(syntax->built_in_types);
+    }
+
+    if (syntax->secondary_keywords) {
+        for (size_t i = 0; i< syntax->secondary_keywords_count; i++) {
+            free(syntax->secondary_keywords[i]);
+        }
+        free(syntax->secondary_keywords);
+    }
+
+    if (syntax->preproc_directives) {
+        for (size_t i = 0; i< syntax->preproc_directives_count; i++) {
+            free(syntax->preproc_directives[i]);
+        }
+        free(syntax->preproc_directives);
+    }
+
+    if (syntax->comment_single_prefix.u.s)
+        free(syntax->comment_single_prefix.u.s);
+
+    if (syntax->comment_multi_begin.u.s)
+        free(syntax->comment_multi_begin.u.s);
+
+    if (syntax->comment_multi_end.u.s)
+        free(syntax->comment_multi_end.u.s);
+}
+
+const Syntax *syntaxGet(FileType file_type) {
+    if (file_type >= FILE_TYPE_UNKNOWN) {
+        return &no_syntax;
+    }
+    if (!syntaxes[file_type]) {
+        syntaxes[file_type] = (Syntax *)calloc(1, sizeof(Syntax));
+        syntaxLoad(syntaxes[file_type], file_type);
+    }
+    return syntaxes[file_type];
+}
+
+void syntaxReload(FileType file_type) {
+    if (file_type < FILE_TYPE_UNKNOWN && syntaxes[file_type]) {
+        syntaxFree(syntaxes[file_type]);
+        memset(syntaxes[file_type], 0, sizeof(Syntax));
+        syntaxLoad(syntaxes[file_type], file_type);
+    }
+}
+
+bool syntaxChanged(FileType file_type) {
+    if (file_type >= FILE_TYPE_UNKNOWN || !syntaxes[file_type]) {
+        return false;
+    }
+    FileStamp stamp;
+    getFileStamp(syntaxFilePath(file_type), &stamp);
+    return !fileStampEqual(stamp, syntaxes[file_type]->stamp);
+}
+
+void syntaxDestroyAll() {
+    for (u32 i = 0; i < FILE_TYPE_UNKNOWN; i++) {
+        if (syntaxes[i]) {
+            syntaxFree(syntaxes[i]);
+            free(syntaxes[i]);
+            syntaxes[i] = NULL;
+        }
+    }
+}
+
 static void pushToken(Lexer *lexer, Token token) {
     if (!token.text || strlen(token.text) == 0) {
         return;
     }
-    if (!lexer->tokens) {
-        lexer->tokens = (Token *)malloc(lexer->capacity * sizeof(Token));
+    if (!lexer->next_tokens) {
+        lexer->next_tokens = (Token *)malloc(lexer->next_capacity * sizeof(Token));
     }
-    if (lexer->token_count >= lexer->capacity) {
-        lexer->capacity *= 2;
-        lexer->tokens = (Token *)realloc(lexer->tokens, lexer->capacity * sizeof(Token));
+    if (lexer->next_count >= lexer->next_capacity) {
+        lexer->next_capacity *= 2;
+        lexer->next_tokens = (Token *)realloc(lexer->next_tokens, lexer->next_capacity * sizeof(Token));
     }
-    lexer->tokens[lexer->token_count] = token;
-    lexer->token_count++;
+    lexer->next_tokens[lexer->next_count] = token;
+    lexer->next_count++;
 }
 
 void lexerUpdateFileType(Lexer *lexer, FileType file_type) {
     lexer->file_type = file_type;
-
-    lexerDestroy(lexer);
-    lexerInit(lexer);
-
-    if (file_type != FILE_TYPE_UNKNOWN) {
-        loadHighlightingInfo(lexer, file_type);
-    }
+    lexer->syntax = syntaxGet(file_type);
 }
 
 static void refreshToken(Lexer *lexer, Token *curToken, TokenType new_type) {
@@ -325,7 +365,56 @@ static void refreshToken(Lexer *lexer, Token *curToken, TokenType new_type) {
 }
 
 void lex (Lexer *lexer, const char *source) {
-    size_t length = strlen(source);
+    char *copy = (char *)malloc(strlen(source) + 1);
+    strcpy(copy, source);
+    lexBegin(lexer, copy);
+    lexStep(lexer, INFINITY);
+}
+
+void lexBegin(Lexer *lexer, char *source) {
+    if (lexer->source) {
+        free(lexer->source);
+    }
+    tokenDestroy(&lexer->pending);
+    lexer->pending = createToken();
+    destroyTokens(lexer->next_tokens, lexer->next_count);
+    lexer->next_count = 0;
+
+    lexer->source = source;
+    lexer->source_length = strlen(source);
+    lexer->position = 0;
+
+    // An edit leaves the text around it as it was
+    const char *text = lexer->text ? lexer->text : "";
+    size_t common = MIN(lexer->text_length, lexer->source_length);
+    size_t prefix = 0;
+    while (prefix < common && text[prefix] == source[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < common - prefix && text[lexer->text_length - 1 - suffix] == source[lexer->source_length - 1 - suffix]) {
+        suffix++;
+    }
+    lexer->same_prefix = prefix;
+    lexer->same_suffix = suffix;
+}
+
+bool lexPending(const Lexer *lexer) {
+    return lexer->source != NULL;
+}
+
+bool lexStep (Lexer *lexer, f64 deadline) {
+    if (!lexer->source) {
+        return true;
+    }
+
+    // Picks up where the last step stopped
+    const char *source = lexer->source;
+    size_t length = lexer->source_length;
+    size_t i = lexer->position;
+    Token curToken = lexer->pending;
+    const Syntax *syntax = lexer->syntax;
+    u32 steps = 0;
     bool preprocessor = false;
 
     switch (lexer->file_type) {
@@ -337,15 +426,14 @@ void lex (Lexer *lexer, const char *source) {
         break;
     }
 
-    if (lexer->tokens) {
-        lexerClearTokens(lexer);
-    }
-    lexer->token_count = 0;
-    
     if (lexer->file_type == FILE_TYPE_UNKNOWN) {
         // If we don't know what file type it is, don't do anything.
-        Token curToken = createToken();
-        for (size_t i = 0; i < length; i++) {
+        for (; i < length; i++) {
+            if (++steps % LEX_STEPS_PER_CHECK == 0 && getTimeSeconds() >= deadline) {
+                lexer->position = i;
+                lexer->pending = curToken;
+                return false;
+            }
             tokenPushChar(&curToken, source[i]);
 
             // If we encounter a newline, start a new token.
@@ -359,15 +447,16 @@ void lex (Lexer *lexer, const char *source) {
                 refreshToken(lexer, &curToken, TOKEN_UNKNOWN);
             }
         }
-        if (curToken.text) {
-            pushToken(lexer, curToken);
-        }
     } else {
-        size_t i = 0;
-        Token curToken = createToken();
         while (i < length) {
+            if (++steps % LEX_STEPS_PER_CHECK == 0 && getTimeSeconds() >= deadline) {
+                lexer->position = i;
+                lexer->pending = curToken;
+                return false;
+            }
+
             // Handle single-line comments
-            if (lexer->comment_single_prefix.ok && strncmp(&source[i], lexer->comment_single_prefix.u.s, strlen(lexer->comment_single_prefix.u.s)) == 0) {
+            if (syntax->comment_single_prefix.ok && strncmp(&source[i], syntax->comment_single_prefix.u.s, strlen(syntax->comment_single_prefix.u.s)) == 0) {
                 refreshToken(lexer, &curToken, TOKEN_COMMENT_SINGLE);
 
                 while (i < length && source[i] != '\n') {
@@ -379,11 +468,11 @@ void lex (Lexer *lexer, const char *source) {
                 curToken = createToken();
             } 
             // Handle multiline comments
-            else if (lexer->comment_multi_begin.ok && strncmp(&source[i], lexer->comment_multi_begin.u.s, strlen(lexer->comment_multi_begin.u.s)) == 0) {
+            else if (syntax->comment_multi_begin.ok && strncmp(&source[i], syntax->comment_multi_begin.u.s, strlen(syntax->comment_multi_begin.u.s)) == 0) {
                 refreshToken(lexer, &curToken, TOKEN_COMMENT_MULTI);
 
                 // Add the characters in the multiline comment.
-                while (i < length && strncmp(&source[i], lexer->comment_multi_end.u.s, strlen(lexer->comment_multi_end.u.s)) != 0) {
+                while (i < length && strncmp(&source[i], syntax->comment_multi_end.u.s, strlen(syntax->comment_multi_end.u.s)) != 0) {
                     tokenPushChar(&curToken, source[i]);
 
                     // If we encounter a newline, start a new token.
@@ -399,7 +488,7 @@ void lex (Lexer *lexer, const char *source) {
                     i++;
                 }
                 
-                if (strncmp(&source[i], lexer->comment_multi_end.u.s, strlen(lexer->comment_multi_end.u.s)) == 0) {
+                if (strncmp(&source[i], syntax->comment_multi_end.u.s, strlen(syntax->comment_multi_end.u.s)) == 0) {
                     tokenPushChar(&curToken, source[i]);
                     tokenPushChar(&curToken, source[i+1]);
                     i+=2;
@@ -598,7 +687,7 @@ void lex (Lexer *lexer, const char *source) {
                     i++;
                 }
 
-                if (is_preproc_directive(lexer, curToken.text)) {
+                if (is_preproc_directive(syntax, curToken.text)) {
                     curToken.type = TOKEN_PREPROCESSOR_DIRECTIVE;
                     pushToken(lexer, curToken);
                     curToken = createToken();
@@ -609,7 +698,7 @@ void lex (Lexer *lexer, const char *source) {
                 }
             }
             // Handle symbols
-            else if (is_symbol(lexer, source[i])) {
+            else if (is_symbol(syntax, source[i])) {
                 if (curToken.type != TOKEN_SYMBOL && curToken.text) {
                     pushToken(lexer, curToken);
                     curToken = createToken();
@@ -639,10 +728,10 @@ void lex (Lexer *lexer, const char *source) {
                     curToken.type = TOKEN_WHITESPACE;
                     pushToken(lexer, curToken);
                     curToken = createToken();
-                } else if (!is_symbol(lexer, source[i]) && !isspace(source[i]) && source[i] != ',' && source[i] != '.' && source[i] != ';'){
+                } else if (!is_symbol(syntax, source[i]) && !isspace(source[i]) && source[i] != ',' && source[i] != '.' && source[i] != ';'){
                     refreshToken(lexer, &curToken, TOKEN_IDENTIFER);
                     size_t start = i;
-                    while (i < length && !is_symbol(lexer, source[i]) && !isspace(source[i]) && source[i] != ',' && source[i] != '.' && source[i] != ';') {
+                    while (i < length && !is_symbol(syntax, source[i]) && !isspace(source[i]) && source[i] != ',' && source[i] != '.' && source[i] != ';') {
                         tokenPushChar(&curToken, source[i]);
                         if (ispunct(source[i]) && source[i] != '_') {
                             i++;
@@ -651,23 +740,23 @@ void lex (Lexer *lexer, const char *source) {
                         i++;
                     }
 
-                    if (is_keyword(lexer, curToken.text)) {
+                    if (is_keyword(syntax, curToken.text)) {
                         curToken.type = TOKEN_KEYWORD;
                         pushToken(lexer, curToken);
                         curToken = createToken();
-                    } else if (is_secondary_keyword(lexer, curToken.text)) {
+                    } else if (is_secondary_keyword(syntax, curToken.text)) {
                         curToken.type = TOKEN_SECONDARY_KEYWORD;
                         pushToken(lexer, curToken);
                         curToken = createToken();
-                    } else if (is_built_in_type(lexer, curToken.text)) {
+                    } else if (is_built_in_type(syntax, curToken.text)) {
                         curToken.type = TOKEN_BUILT_IN_TYPE;
                         pushToken(lexer, curToken);
                         curToken = createToken();
-                    } else if (lexer->id_heuristics && is_function_name(source, start, i - start)) {
+                    } else if (syntax->id_heuristics && is_function_name(source, start, i - start)) {
                         curToken.type = TOKEN_FUNCTION_NAME;
                         pushToken(lexer, curToken);
                         curToken = createToken();
-                    } else if (lexer->id_heuristics && is_type(source, start, i-start)) {
+                    } else if (syntax->id_heuristics && is_type(source, start, i-start)) {
                         curToken.type = TOKEN_TYPE_NAME;
                         pushToken(lexer, curToken);
                         curToken = createToken();
@@ -686,8 +775,28 @@ void lex (Lexer *lexer, const char *source) {
                 }
             }
         }
-        if (curToken.text) {
-            pushToken(lexer, curToken);
-        }
     }
+    if (curToken.text) {
+        pushToken(lexer, curToken);
+    }
+
+    // The new tokens replace the old ones, the old arrays are kept for the next lex
+    destroyTokens(lexer->tokens, lexer->token_count);
+    Token *tokens = lexer->tokens;
+    size_t capacity = lexer->capacity;
+    lexer->tokens = lexer->next_tokens;
+    lexer->token_count = lexer->next_count;
+    lexer->capacity = lexer->next_capacity;
+    lexer->next_tokens = tokens;
+    lexer->next_count = 0;
+    lexer->next_capacity = MAX(capacity, 10);
+
+    free(lexer->text);
+    lexer->text = lexer->source;
+    lexer->text_length = lexer->source_length;
+    lexer->source = NULL;
+    lexer->source_length = 0;
+    lexer->position = 0;
+    lexer->pending = createToken();
+    return true;
 }
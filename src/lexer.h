@@ -41,14 +41,9 @@ Token createToken();
 void tokenDestroy(Token * token);
 void tokenPushChar(Token *token, char c);
 
+// Highlighting rules of a file type, read from its syntax file. Loaded the
+// first time a file of that type is opened and shared by all of its lexers.
 typedef struct {
-    Token *tokens;
-    size_t token_count;
-    size_t capacity;
-
-    // The file type association for this lexer
-    FileType file_type;
-
     // sizes of data buffers
     size_t keywords_count;
     size_t symbols_count;
@@ -70,11 +65,68 @@ typedef struct {
 
     //Other lexer settings
     bool id_heuristics;
+
+    FileStamp stamp; // of the file when it was read
+} Syntax;
+
+// Never NULL, file types without a syntax file get an empty syntax.
+const Syntax *syntaxGet(FileType file_type);
+
+// File the syntax of a file type is read from, NULL if it has none.
+const char *syntaxFilePath(FileType file_type);
+
+// Reads the syntax file again. Syntaxes are reloaded in place, so lexers
+// keep their pointers, but their tokens are stale until they lex again.
+// A syntax that wasn't loaded yet is left for syntaxGet.
+void syntaxReload(FileType file_type);
+// True if the file of a loaded syntax changed since it was read.
+bool syntaxChanged(FileType file_type);
+void syntaxDestroyAll();
+
+typedef struct {
+    // Tokens of text, the last source lexed to the end. Their texts put
+    // together are text.
+    Token *tokens;
+    size_t token_count;
+    size_t capacity;
+    char *text;
+    size_t text_length;
+
+    // The file type association for this lexer
+    FileType file_type;
+    const Syntax *syntax;
+
+    // Source being lexed by lexStep, NULL when done. Its tokens go into
+    // next_tokens and replace tokens once the source is lexed to the end, so
+    // the old ones can be shown meanwhile. They cover the source up to
+    // position, minus the text of the pending token.
+    char *source;
+    size_t source_length;
+    size_t position;
+    Token pending;
+    Token *next_tokens;
+    size_t next_count;
+    size_t next_capacity;
+
+    // Bytes source has in common with text at its start and at its end,
+    // the old tokens still fit those
+    size_t same_prefix;
+    size_t same_suffix;
 } Lexer;
 
+// Source positions lexStep goes through between looking at the clock.
+#define LEX_STEPS_PER_CHECK 256
+
 void lexerInit(Lexer *lexer);
 void lexerDestroy(Lexer *lexer);
-void lexerClearTokens(Lexer *lexer);
 void lexerUpdateFileType(Lexer *lexer, FileType file_type);
 
 void lex(Lexer *lexer, const char *source);
+
+// Lexing split over several calls, for sources too large to lex in a frame.
+// lexBegin takes ownership of source, lexStep lexes until the deadline
+// (getTimeSeconds) passed and returns true once done. The old tokens stay
+// until then.
+void lexBegin(Lexer *lexer, char *source);
+bool lexStep(Lexer *lexer, f64 deadline);
+bool lexPending(const Lexer *lexer);
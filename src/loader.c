@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+#include "loader.h"
+
+// Hands text over to the editor thread. Called by the reader only.
+static void appendText(FileLoader *l, const char *text, size_t length, size_t bytes_read) {
+    size_t lines = 0;
+    for (const char *c = text; (c = memchr(c, '\n', text + length - c)); c++) {
+        lines++;
+    }
+
+    pthread_mutex_lock(&l->lock);
+    if (l->length + length > l->capacity) {
+        l->capacity = MAX(l->length + length, l->capacity * 2);
+        l->text = (char *)realloc(l->text, l->capacity);
+    }
+    memcpy(l->text + l->length, text, length);
+    l->length += length;
+    l->lines += lines;
+    l->bytes_read = bytes_read;
+    pthread_mutex_unlock(&l->lock);
+}
+
+static void *fileLoaderMain(void *arg) {
+    FileLoader *l = (FileLoader *)arg;
+    char *read_buf = (char *)malloc(FILE_LOAD_CHUNK);
+
+    // Read text with its tabs expanded, the part after its last line is
+    // kept for the next chunk
+    size_t capacity = FILE_LOAD_CHUNK * 2;
+    char *text = (char *)malloc(capacity);
+    size_t length = 0;
+    size_t bytes_read = 0;
+
+    size_t nread;
+    while (!atomic_load(&l->cancel) && (nread = fread(read_buf, 1, FILE_LOAD_CHUNK, l->file)) > 0) {
+        bytes_read += nread;
+        for (size_t i = 0; i < nread; i++) {
+            if (length + (size_t)l->tab_stop + 1 > capacity) {
+                capacity *= 2;
+                text = (char *)realloc(text, capacity);
+            }
+            if (read_buf[i] == '\t') {
+                memset(text + length, ' ', l->tab_stop);
+                length += l->tab_stop;
+            } else {
+                text[length++] = read_buf[i];
+            }
+        }
+
+        size_t cut = length;
+        while (cut > 0 && text[cut - 1] != '\n') {
+            cut--;
+        }
+        if (cut == 0 && length >= FILE_LOAD_CHUNK) {
+            cut = length - 1;
+            while (cut > 0 && utf8IsContinuation(text[cut])) {
+                cut--;
+            }
+        }
+        if (cut > 0) {
+            appendText(l, text, cut, bytes_read);
+            memmove(text, text + cut, length - cut);
+            length -= cut;
+        }
+    }
+
+    if (ferror(l->file)) {
+        LOG_ERROR("Couldn't read the whole file, it was cut short", "");
+    }
+    if (length > 0) {
+        appendText(l, text, length, bytes_read);
+    }
+    free(text);
+    free(read_buf);
+
+    pthread_mutex_lock(&l->lock);
+    l->done = true;
+    pthread_mutex_unlock(&l->lock);
+    return NULL;
+}
+
+bool fileLoaderStart(FileLoader *l, const char *file_path, i32 tab_stop) {
+    l->file = fopen(file_path, "r");
+    if (l->file == NULL) {
+        return false;
+    }
+
+    fseek(l->file, 0, SEEK_END);
+    long size = ftell(l->file);
+    fseek(l->file, 0, SEEK_SET);
+    l->file_size = size > 0 ? (size_t)size : 0;
+    l->tab_stop = tab_stop;
+    atomic_init(&l->cancel, false);
+
+    pthread_mutex_init(&l->lock, NULL);
+    l->text = NULL;
+    l->length = 0;
+    l->capacity = 0;
+    l->lines = 0;
+    l->bytes_read = 0;
+    l->done = false;
+
+    if (pthread_create(&l->thread, NULL, fileLoaderMain, l) != 0) {
+        LOG_ERROR("Failed to start the file loader thread.", "");
+        exit(1);
+    }
+    return true;
+}
+
+void fileLoaderDestroy(FileLoader *l) {
+    atomic_store(&l->cancel, true);
+    pthread_join(l->thread, NULL);
+    pthread_mutex_destroy(&l->lock);
+    fclose(l->file);
+    free(l->text);
+    l->text = NULL;
+}
+
+char *fileLoaderTake(FileLoader *l, size_t *length, size_t *lines) {
+    pthread_mutex_lock(&l->lock);
+    char *text = l->length > 0 ? l->text : NULL;
+    *length = l->length;
+    *lines = l->lines;
+    if (text) {
+        l->text = NULL;
+        l->length = 0;
+        l->capacity = 0;
+        l->lines = 0;
+    }
+    pthread_mutex_unlock(&l->lock);
+    return text;
+}
+
+bool fileLoaderDone(FileLoader *l) {
+    pthread_mutex_lock(&l->lock);
+    bool done = l->done && l->length == 0;
+    pthread_mutex_unlock(&l->lock);
+    return done;
+}
+
+f32 fileLoaderProgress(FileLoader *l) {
+    pthread_mutex_lock(&l->lock);
+    f32 progress = l->file_size > 0 ? (f32)l->bytes_read / (f32)l->file_size : 1.0f;
+    pthread_mutex_unlock(&l->lock);
+    return MIN(progress, 1.0f);
+}
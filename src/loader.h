@@ -0,0 +1,45 @@
+#pragma once
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "util.h"
+
+// Bytes the loader reads from the file at a time.
+#define FILE_LOAD_CHUNK (256 * 1024)
+
+// Reads a file on a thread of its own, so a large file shows up as it comes
+// in instead of freezing the editor until all of it is there. The text is
+// handed over in whole lines (only a line longer than a chunk is cut, on a
+// codepoint), with tabs already expanded.
+typedef struct {
+    pthread_t thread;
+    FILE *file;
+    size_t file_size;
+    i32 tab_stop;
+    atomic_bool cancel;
+
+    // Shared with the reader
+    pthread_mutex_t lock;
+    char *text; // read but not taken yet
+    size_t length;
+    size_t capacity;
+    size_t lines;      // newlines in text
+    size_t bytes_read; // of the file
+    bool done;         // the reader finished, text may still be waiting
+} FileLoader;
+
+// Opens the file and starts reading it. Returns false if it can't be opened.
+bool fileLoaderStart(FileLoader *l, const char *file_path, i32 tab_stop);
+
+// Stops reading if it hasn't finished yet.
+void fileLoaderDestroy(FileLoader *l);
+
+// Text read since the last take and the newlines in it, NULL when nothing
+// new came in. Free it when done.
+char *fileLoaderTake(FileLoader *l, size_t *length, size_t *lines);
+
+// True once the whole file was read and taken.
+bool fileLoaderDone(FileLoader *l);
+
+// Part of the file read so far, from 0 to 1.
+f32 fileLoaderProgress(FileLoader *l);
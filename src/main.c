@@ -13,14 +13,18 @@ int main (int argc, char **argv) {
     Application app;
     applicationInit(&app, argc, argv);
 
+    // Frames are drawn on the render thread, this one only handles input
+    // and updates the editor
     f64 last_frame_time = 0.0f;
     while (!glfwWindowShouldClose(app.window)) {
+        applicationWaitEvents(&app);
+
         f64 cur_fame_time = (f64)glfwGetTime();
         f64 delta_time = cur_fame_time - last_frame_time;
         last_frame_time = cur_fame_time;
 
         applicationUpdate(&app, delta_time);
-        applicationRender(&app, delta_time);
+        applicationPublishFrame(&app, delta_time);
     }
     applicationDestroy(&app);
     return 0;
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "profiler.h"
+#include "workers.h"
+
+static Profiler profiler;
+static _Thread_local ProfilerPhases phases;
+
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    "input",
+    "update",
+    "tasks",
+    "lex",
+    "build",
+    "upload",
+    "swap",
+};
+
+static const char *job_names[PROFILE_JOB_COUNT] = {
+    "text",
+    "glyphs",
+    "scan",
+};
+
+static void profilerJobTimed(u32 tag, f64 seconds) {
+    if (!profilerEnabled() || tag >= PROFILE_JOB_COUNT) {
+        return;
+    }
+    atomic_fetch_add(&profiler.job_ns[tag], (unsigned long long)(seconds * 1e9));
+    atomic_fetch_add(&profiler.job_count[tag], 1);
+}
+
+static int compareFloats(const void *a, const void *b) {
+    f32 fa = *(const f32 *)a;
+    f32 fb = *(const f32 *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+void profilerInit(bool enabled) {
+    memset(&profiler, 0, sizeof(profiler));
+    atomic_init(&profiler.enabled, enabled);
+    for (u32 i = 0; i < PROFILE_JOB_COUNT; i++) {
+        atomic_init(&profiler.job_ns[i], 0);
+        atomic_init(&profiler.job_count[i], 0);
+    }
+    jobsSetTimingHook(profilerJobTimed);
+    glGenQueries(PROFILER_GPU_QUERIES, profiler.gpu_queries);
+}
+
+void profilerDestroy() {
+    jobsSetTimingHook(NULL);
+    glDeleteQueries(PROFILER_GPU_QUERIES, profiler.gpu_queries);
+}
+
+void profilerToggle() {
+    atomic_store(&profiler.enabled, !atomic_load(&profiler.enabled));
+}
+
+bool profilerEnabled() {
+    return atomic_load(&profiler.enabled);
+}
+
+void profilerBeginFrame() {
+    profiler.frame_start = getTimeSeconds();
+    phases.depth = 0;
+    for (u32 i = 0; i < PROFILE_PHASE_COUNT; i++) {
+        phases.phase_time[i] = 0.0;
+    }
+}
+
+void profilerEndFrame(RenderStats stats) {
+    f64 now = getTimeSeconds();
+    profiler.frame_times[profiler.frame_index] = (f32)((now - profiler.frame_start) * 1000.0);
+    profiler.frame_index = (profiler.frame_index + 1) % PROFILER_HISTORY;
+    profiler.frame_count = MIN(profiler.frame_count + 1, PROFILER_HISTORY);
+
+    memcpy(profiler.last_phase_time, phases.phase_time, sizeof(phases.phase_time));
+    for (u32 i = 0; i < PROFILE_JOB_COUNT; i++) {
+        profiler.last_job_time[i] = (f64)atomic_exchange(&profiler.job_ns[i], 0) / 1e9;
+        profiler.last_job_count[i] = atomic_exchange(&profiler.job_count[i], 0);
+    }
+    profiler.last_stats = stats;
+}
+
+void profilerBeginPhase(ProfilePhase phase) {
+    if (!profilerEnabled() || phases.depth >= PROFILE_PHASE_COUNT) {
+        return;
+    }
+
+    f64 now = getTimeSeconds();
+    if (phases.depth > 0) {
+        phases.phase_time[phases.stack[phases.depth - 1]] += now - phases.phase_start;
+    }
+    phases.stack[phases.depth++] = phase;
+    phases.phase_start = now;
+}
+
+void profilerEndPhase(ProfilePhase phase) {
+    if (!profilerEnabled() || phases.depth == 0 || phases.stack[phases.depth - 1] != phase) {
+        return;
+    }
+
+    // Resume the parent phase
+    f64 now = getTimeSeconds();
+    phases.phase_time[phase] += now - phases.phase_start;
+    phases.depth--;
+    phases.phase_start = now;
+}
+
+void profilerTakePhases(f64 times[PROFILE_PHASE_COUNT]) {
+    memcpy(times, phases.phase_time, sizeof(phases.phase_time));
+    memset(phases.phase_time, 0, sizeof(phases.phase_time));
+}
+
+void profilerAddPhases(const f64 times[PROFILE_PHASE_COUNT]) {
+    for (u32 i = 0; i < PROFILE_PHASE_COUNT; i++) {
+        phases.phase_time[i] += times[i];
+    }
+}
+
+void profilerSetQueuedTasks(u32 count) {
+    profiler.queued_tasks = count;
+}
+
+void profilerBeginGpu() {
+    if (!profilerEnabled()) {
+        return;
+    }
+
+    // Collect the oldest query before reusing it. It was issued
+    // PROFILER_GPU_QUERIES frames ago so the result is usually ready.
+    u32 index = profiler.gpu_index;
+    if (profiler.gpu_pending[index]) {
+        GLint available = 0;
+        glGetQueryObjectiv(profiler.gpu_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(profiler.gpu_queries[index], GL_QUERY_RESULT, &elapsed);
+            profiler.gpu_time = (f64)elapsed / 1000000.0;
+        }
+        profiler.gpu_pending[index] = false;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, profiler.gpu_queries[index]);
+}
+
+void profilerEndGpu() {
+    if (!profilerEnabled()) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    profiler.gpu_pending[profiler.gpu_index] = true;
+    profiler.gpu_index = (profiler.gpu_index + 1) % PROFILER_GPU_QUERIES;
+}
+
+void profilerRender(Renderer *r, GlyphAtlas *atlas, f32 line_height) {
+    if (!profilerEnabled()) {
+        return;
+    }
+
+    // Percentiles over the rolling history
+    f32 sorted[PROFILER_HISTORY];
+    u32 count = profiler.frame_count;
+    memcpy(sorted, profiler.frame_times, count * sizeof(f32));
+    qsort(sorted, count, sizeof(f32), compareFloats);
+    f32 p50 = count ? sorted[count / 2] : 0.0f;
+    f32 p99 = count ? sorted[MIN(count - 1, (count * 99) / 100)] : 0.0f;
+
+    u32 buckets[PROFILER_BUCKETS] = { 0 };
+    u32 max_bucket = 1;
+    for (u32 i = 0; i < count; i++) {
+        u32 bucket = MIN((u32)sorted[i], PROFILER_BUCKETS - 1);
+        buckets[bucket]++;
+        max_bucket = MAX(max_bucket, buckets[bucket]);
+    }
+
+    char lines[PROFILE_PHASE_COUNT + PROFILE_JOB_COUNT + 5][64];
+    u32 line_count = 0;
+    snprintf(lines[line_count++], 64, "frame p50 %5.2fms p99 %5.2fms", p50, p99);
+    snprintf(lines[line_count++], 64, "gpu       %5.2fms", profiler.gpu_time);
+    for (u32 i = 0; i < PROFILE_PHASE_COUNT; i++) {
+        snprintf(lines[line_count++], 64, "%-9s %5.2fms", phase_names[i], profiler.last_phase_time[i] * 1000.0);
+    }
+    for (u32 i = 0; i < PROFILE_JOB_COUNT; i++) {
+        snprintf(lines[line_count++], 64, "job %-6s%5.2fms x%u", job_names[i], profiler.last_job_time[i] * 1000.0, profiler.last_job_count[i]);
+    }
+    RenderStats stats = profiler.last_stats;
+    snprintf(lines[line_count++], 64, "quads %u draws %u flushes %u", stats.quads, stats.draw_calls, stats.flushes);
+    snprintf(lines[line_count++], 64, "uploaded %.1fKB", (f64)stats.bytes_uploaded / 1024.0);
+    snprintf(lines[line_count++], 64, "queued tasks %u", profiler.queued_tasks);
+
+    f32 margin = r->glyph_adv;
+    f32 width = r->glyph_adv * 32;
+    f32 graph_height = line_height * 3;
+    f32 height = line_height * line_count + graph_height + margin * 3;
+    f32 x = r->screen_width - width - margin;
+    f32 top = r->screen_height - margin;
+
+    renderQuad(r, rect_init(x - margin, top - height + margin, width + margin * 2, height), color_from_hex(0x000000C0));
+
+    for (u32 i = 0; i < line_count; i++) {
+        vec2 pos = vec2_init(x, top - line_height * (i + 1) + r->descender);
+        renderText(r, lines[i], &pos, atlas, COLOR_WHITE);
+    }
+
+    // Frame time histogram, green under 60fps budget, yellow under 30fps
+    f32 graph_y = top - line_height * line_count - margin - graph_height;
+    f32 bar_width = width / PROFILER_BUCKETS;
+    for (u32 i = 0; i < PROFILER_BUCKETS; i++) {
+        if (buckets[i] == 0) {
+            continue;
+        }
+        Color color = i < 16 ? COLOR_GREEN : (i < 33 ? COLOR_YELLOW : COLOR_RED);
+        f32 bar_height = graph_height * buckets[i] / max_bucket;
+        renderQuad(r, rect_init(x + i * bar_width, graph_y, bar_width - 1, bar_height), color);
+    }
+}
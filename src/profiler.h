@@ -0,0 +1,97 @@
+#pragma once
+#include <stdatomic.h>
+#include "util.h"
+#include "renderer.h"
+
+// Number of frames kept for the frame time histogram and percentiles.
+#define PROFILER_HISTORY 240
+
+// Frame time histogram buckets, 1ms each. The last bucket holds everything slower.
+#define PROFILER_BUCKETS 34
+
+// GPU timer queries are read back a few frames late so we never stall on them.
+#define PROFILER_GPU_QUERIES 4
+
+typedef enum {
+    PROFILE_INPUT,
+    PROFILE_UPDATE,
+    PROFILE_TASKS,
+    PROFILE_LEX,
+    PROFILE_BUILD,
+    PROFILE_UPLOAD,
+    PROFILE_SWAP,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+// Tags of the jobs the profiler attributes time to, see jobsSetTimingHook.
+// Job time is summed over every thread that ran the jobs.
+typedef enum {
+    PROFILE_JOB_TEXT,   // building the text layer
+    PROFILE_JOB_GLYPHS, // rasterizing glyphs into an atlas
+    PROFILE_JOB_SCAN,   // reading directories for the file browser
+    PROFILE_JOB_COUNT
+} ProfileJob;
+
+// Phases nest (lex runs inside tasks, upload inside build). Starting a
+// phase pauses its parent, so every phase time is exclusive. Every thread
+// times its own phases.
+typedef struct {
+    ProfilePhase stack[PROFILE_PHASE_COUNT];
+    u32 depth;
+    f64 phase_start;
+    f64 phase_time[PROFILE_PHASE_COUNT];
+} ProfilerPhases;
+
+typedef struct {
+    atomic_bool enabled;
+
+    f64 frame_start;
+
+    // Results of the last finished frame, these are what get drawn.
+    f64 last_phase_time[PROFILE_PHASE_COUNT];
+    f64 last_job_time[PROFILE_JOB_COUNT];
+    u32 last_job_count[PROFILE_JOB_COUNT];
+
+    // Job times of the running frame, added to from any thread
+    atomic_ullong job_ns[PROFILE_JOB_COUNT];
+    atomic_uint job_count[PROFILE_JOB_COUNT];
+    RenderStats last_stats;
+    u32 queued_tasks;
+    f64 gpu_time;
+
+    f32 frame_times[PROFILER_HISTORY];
+    u32 frame_index;
+    u32 frame_count;
+
+    u32 gpu_queries[PROFILER_GPU_QUERIES];
+    bool gpu_pending[PROFILER_GPU_QUERIES];
+    u32 gpu_index;
+} Profiler;
+
+// The profiler is a global so deeply nested code (the lexer, the renderer's
+// flush) can be timed without threading it through every call. Frames are
+// timed on the render thread, the editor thread's phases reach it with the
+// frame they went into (see profilerTakePhases).
+void profilerInit(bool enabled);
+void profilerDestroy();
+void profilerToggle();
+bool profilerEnabled();
+
+void profilerBeginFrame();
+void profilerEndFrame(RenderStats stats);
+void profilerBeginPhase(ProfilePhase phase);
+
+// Moves the phase times this thread gathered since the last take into times.
+void profilerTakePhases(f64 times[PROFILE_PHASE_COUNT]);
+
+// Counts phase times taken on another thread towards this thread's frame.
+void profilerAddPhases(const f64 times[PROFILE_PHASE_COUNT]);
+void profilerEndPhase(ProfilePhase phase);
+
+// Background tasks still queued on the editor thread, see Scheduler.
+void profilerSetQueuedTasks(u32 count);
+void profilerBeginGpu();
+void profilerEndGpu();
+
+// Draws the overlay in the top right corner of the screen.
+void profilerRender(Renderer *r, GlyphAtlas *atlas, f32 line_height);
@@ -3,6 +3,8 @@
 #include <string.h>
 #include <GL/glew.h>
 #include "renderer.h"
+#include "profiler.h"
+#include "shader.h"
 #include "lexer.h"
 #include "browser.h"
 
@@ -21,6 +23,37 @@ static void glLogCall() {
 	}
 }
 
+static void setupShaderUniforms(Renderer *r, u32 program) {
+	glUseProgram(program);
+	u32 proj_loc = glGetUniformLocation(program, "u_proj");
+	// the member a here is the underlying array. mat4 is defined as so:
+	//    typedef struct mat4 { f32 a[4*4]; } mat4;
+	// Arrays implicitly become pointers, so this works nicely
+	glUniformMatrix4fv(proj_loc, 1, GL_FALSE, r->projection.a);
+	
+	glUniform1i(glGetUniformLocation(program, "u_atlas"), 0);
+
+	u32 palette_index = glGetUniformBlockIndex(program, "Palette");
+	if (palette_index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, palette_index, PALETTE_BINDING);
+	}
+}
+
+// Describes Render_Vertex to the bound vertex array, reading from the bound buffer.
+static void setupVertexAttributes() {
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, color));
+	glEnableVertexAttribArray(1);
+	
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, u));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, layer));
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(4, 1, GL_UNSIGNED_BYTE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, palette));
+	glEnableVertexAttribArray(4);
+}
+
 void rendererInit(Renderer* r, Color clear_color) {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -32,19 +65,10 @@ void rendererInit(Renderer* r, Color clear_color) {
 	glGenBuffers(1, &r->vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
 	glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(Render_Vertex), NULL, GL_DYNAMIC_DRAW);
-	
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, pos));
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, color));
-	glEnableVertexAttribArray(1);
-	
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, uv));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Render_Vertex), (void*) offsetof(Render_Vertex, tex_index));
-	glEnableVertexAttribArray(3);
+	setupVertexAttributes();
 
 	/* Index Buffer stuff */
-	u32 indices[MAX_INDICES];
+	u32 *indices = (u32 *)malloc(MAX_INDICES * sizeof(u32));
 	u32 offset = 0;
 	for (size_t i = 0; i < MAX_INDICES; i += 6) {
 		indices[i + 0] = 0 + offset;
@@ -60,128 +84,442 @@ void rendererInit(Renderer* r, Color clear_color) {
 
 	glGenBuffers(1, &r->ibo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r->ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_INDICES * sizeof(u32), indices, GL_STATIC_DRAW);
+	free(indices);
 	
 	r->projection = mat4_ortho(0, INITIAL_SCREEN_WIDTH, INITIAL_SCREEN_HEIGHT, 0, -0.01, 1.0);
 	r->screen_width = INITIAL_SCREEN_WIDTH;
 	r->screen_height = INITIAL_SCREEN_HEIGHT;
-	
-	r->shader = glCreateProgram();
-    u32 vert_module = glCreateShader(GL_VERTEX_SHADER);
-    u32 frag_module = glCreateShader(GL_FRAGMENT_SHADER);
-	
-    // TODO: hot reload shaders
-	i8 *vert_code = readFile("./shaders/glyph.vert");
-    GLint vert_src_length = (GLint)strlen(vert_code);
-	glShaderSource(vert_module, 1, (const GLchar *const *)&vert_code, &vert_src_length);
-	free(vert_code);
-	
-	i8 *frag_code = readFile("./shaders/glyph.frag");
-    GLint frag_src_length = (GLint)strlen(frag_code);
-	glShaderSource(frag_module, 1, (const GLchar *const *)&frag_code, &frag_src_length);
-	
-	glCompileShader(vert_module);
-	glCompileShader(frag_module);
-	free(frag_code);
-
-    GLchar* vert_info;
-    GLchar* frag_info;
-    GLchar* prog_info;
-	
-	i32 error;
-	glGetShaderiv(vert_module, GL_COMPILE_STATUS, &error);
-	if (error == GL_FALSE) {
-		printf("Vertex Shader Compilation failed!");
-		i32 length = 0;
-		glGetShaderiv(vert_module, GL_INFO_LOG_LENGTH, &length);
-		
-		vert_info = (GLchar *)malloc(length * sizeof(GLchar));
-		glGetShaderInfoLog(vert_module, length * sizeof(GLchar), NULL, vert_info);
-		printf("%s", vert_info);
-	}
-	
-	glGetShaderiv(frag_module, GL_COMPILE_STATUS, &error);
-	if (error == GL_FALSE) {
-		printf("Fragment Shader Compilation failed!");
-		i32 length = 0;
-		glGetShaderiv(frag_module, GL_INFO_LOG_LENGTH, &length);
-		
-		frag_info = (GLchar *)malloc(length * sizeof(GLchar));
-		glGetShaderInfoLog(frag_module, length * sizeof(GLchar), NULL, frag_info);
-		printf("%s", frag_info);
-	}
-	
-	glAttachShader(r->shader, vert_module);
-	glAttachShader(r->shader, frag_module);
-	
-	glLinkProgram(r->shader);
-	glGetProgramiv(r->shader, GL_LINK_STATUS, &error);
-	if (error == GL_FALSE) {
-		printf("Program Linking Failed:\n");
-		i32 length = 0;
-		glGetProgramiv(r->shader, GL_INFO_LOG_LENGTH, &length);
-		
-		prog_info = (GLchar *)malloc(length * sizeof(GLchar));
-		glGetProgramInfoLog(r->shader, length, NULL, prog_info);
-		printf("%s", prog_info);
+	r->cull = rect_init(0, 0, r->screen_width, r->screen_height);
+	r->recording = NULL;
+	for (u32 i = 0; i < MAX_PANES; i++) {
+		r->text_layers[i] = (RenderLayer) { 0 };
 	}
+	r->ligatures = false;
+	shaperInit(&r->shaper);
+	r->backend = RENDER_BACKEND_GL;
+	r->soft = (SoftRenderer) { 0 };
+	r->status_cache = (RenderCache) { 0 };
+	r->dialog_cache = (RenderCache) { 0 };
 	
-	glDetachShader(r->shader, vert_module);
-	glDetachShader(r->shader, frag_module);
-	glDeleteShader(vert_module);
-	glDeleteShader(frag_module);
-	
-	glUseProgram(r->shader);
-	u32 proj_loc = glGetUniformLocation(r->shader, "u_proj");
-	// the member a here is the underlying array. mat4 is defined as so:
-	//    typedef struct mat4 { f32 a[4*4]; } mat4;
-	// Arrays implicitly become pointers, so this works nicely
-	glUniformMatrix4fv(proj_loc, 1, GL_FALSE, r->projection.a);
-	
-	
-	u32 tex_loc = glGetUniformLocation(r->shader, "u_tex");
-	i32 textures[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
-	glUniform1iv(tex_loc, 8, textures);
+	r->shader = shaderProgramCreate("glyph", shader_glyph_vert, shader_glyph_frag);
+	r->sdf_shader = shaderProgramCreate("glyph_sdf", shader_glyph_vert, shader_glyph_sdf_frag);
+	r->composite_shader = shaderProgramCreate("composite", shader_glyph_vert, shader_composite_frag);
+	setupShaderUniforms(r, r->shader);
+	setupShaderUniforms(r, r->sdf_shader);
+	setupShaderUniforms(r, r->composite_shader);
+
+	// Theme colors, indexed by the palette of retained vertices
+	glGenBuffers(1, &r->palette_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, r->palette_ubo);
+	memset(&r->theme, 0, sizeof(r->theme));
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(r->theme), &r->theme, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, PALETTE_BINDING, r->palette_ubo);
+	glUniform1i(glGetUniformLocation(r->composite_shader, "u_image"), 1);
+
+	glUseProgram(r->sdf_shader);
+	glUniform1f(glGetUniformLocation(r->sdf_shader, "u_sdf_spread"), (f32)GLYPH_SDF_SPREAD);
+	glUniform1f(glGetUniformLocation(r->sdf_shader, "u_sdf_scale"), 1.0f);
+	r->font_format = GLYPH_ATLAS_BITMAP;
 
-	
     r->clear_color = clear_color;
     glClearColor(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
 
 	// Initaliaze Freetype
-	if (FT_Init_FreeType(&r->ft)) {
+	if (!fontLibraryInit(&r->ft)) {
 		printf("ERROR: Couldn't louad freetype library\n");
 		exit(1);
 	}
+
 	r->font_atlas_count = 0;
 	r->glyph_adv = 0;
+	r->font_generation = 0;
+
+	// Untextured quads sample a small white block in a layer of their own
+	static u8 white[4 * 4];
+	memset(white, 255, sizeof(white));
+	textureArrayInit(&r->textures, GLYPH_ATLAS_INITIAL_SIZE);
+	r->white_layer = (u32)textureArrayAcquire(&r->textures);
+	textureArraySetLayer(&r->textures, r->white_layer, white, 4, 4);
 }
 
 void rendererDestroy(Renderer* r) {
+	for (u32 i = 0; i < r->font_atlas_count; i++) {
+		rendererReleaseFont(r, i);
+	}
+	for (u32 i = 0; i < MAX_PANES; i++) {
+		rendererDestroyLayer(&r->text_layers[i]);
+	}
+	rendererDestroyCache(&r->status_cache);
+	rendererDestroyCache(&r->dialog_cache);
+	if (r->soft.pixels) {
+		softRendererDestroy(&r->soft);
+	}
+	shaperDestroy(&r->shaper);
+	glDeleteBuffers(1, &r->palette_ubo);
 	glDeleteBuffers(1, &r->vbo);
+	glDeleteBuffers(1, &r->ibo);
 	glDeleteVertexArrays(1, &r->vao);
 	glDeleteProgram(r->shader);
+	glDeleteProgram(r->sdf_shader);
+	glDeleteProgram(r->composite_shader);
+	textureArrayDestroy(&r->textures);
 	FT_Done_FreeType(r->ft);
 }
 
 void rendererBegin(Renderer* r) {
-	glClear(GL_COLOR_BUFFER_BIT);
+	// The software backend covers the whole screen when presenting
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		softRendererBegin(&r->soft);
+	} else {
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
 	r->vert_count = 0;
-	r->texture_count = 0;
 	r->indices_count = 0;
+	r->stats = (RenderStats) { 0 };
+
+	for (u32 i = 0; i < r->font_atlas_count; i++) {
+		if (r->font_atlases[i].face) {
+			glyphAtlasNextFrame(&r->font_atlases[i]);
+		}
+	}
 }
 
+static void drawTexture(Renderer* r, u32 texture, rect area);
+
 void rendererEnd(Renderer* r) {
-	
-	for (u32 i = 0; i < r->texture_count; i++) {
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, r->textures[i]);
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		r->stats.bytes_uploaded += softRendererEnd(&r->soft, &r->textures, r->white_layer, r->clear_color);
+		profilerBeginPhase(PROFILE_UPLOAD);
+		drawTexture(r, r->soft.texture, rect_init(0, 0, r->soft.width, r->soft.height));
+		profilerEndPhase(PROFILE_UPLOAD);
+		return;
 	}
 	
-	glUseProgram(r->shader);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, r->textures.texture);
+	
+	profilerBeginPhase(PROFILE_UPLOAD);
+	glUseProgram(r->font_format == GLYPH_ATLAS_SDF ? r->sdf_shader : r->shader);
 	glBindVertexArray(r->vao);
 	glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, r->vert_count * sizeof(Render_Vertex), r->vertices);
 	glDrawElements(GL_TRIANGLES, r->indices_count, GL_UNSIGNED_INT, NULL);
+	profilerEndPhase(PROFILE_UPLOAD);
+
+	r->stats.draw_calls++;
+	r->stats.bytes_uploaded += r->vert_count * sizeof(Render_Vertex);
+}
+
+// Passes a projection to all the shaders
+static void setProjection(Renderer* r, mat4 projection) {
+	u32 programs[3] = { r->shader, r->sdf_shader, r->composite_shader };
+	for (u32 i = 0; i < 3; i++) {
+		glUseProgram(programs[i]);
+		u32 proj_loc = glGetUniformLocation(programs[i], "u_proj");
+		glUniformMatrix4fv(proj_loc, 1, GL_FALSE, projection.a);
+	}
+}
+
+static i16 packCoord(f32 v) {
+	v = roundf(v);
+	return (i16)(v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v));
+}
+
+static u8 packUnorm8(f32 v) {
+	v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	return (u8)(v * 255.0f + 0.5f);
+}
+
+static void packVertex(Render_Vertex *v, vec2 pos, Color color, vec2 uv, u32 layer) {
+	v->x = packCoord(pos.x);
+	v->y = packCoord(pos.y);
+	v->u = (u16)(uv.x + 0.5f);
+	v->v = (u16)(uv.y + 0.5f);
+	v->color[0] = packUnorm8(color.r);
+	v->color[1] = packUnorm8(color.g);
+	v->color[2] = packUnorm8(color.b);
+	v->color[3] = packUnorm8(color.a);
+	v->layer = (u8)layer;
+	v->palette = 0;
+}
+
+// The vertices pushQuad packed for one quad, as a quad for the CPU rasterizer.
+// Palette colors are resolved against theme like the vertex shader does.
+static SoftQuad softQuadFromVertices(const Render_Vertex *v, const ColorTheme *theme, i32 dx, i32 dy) {
+	// v[0] and v[2] are opposite corners
+	const Render_Vertex *lx = v[0].x <= v[2].x ? &v[0] : &v[2];
+	const Render_Vertex *hx = v[0].x <= v[2].x ? &v[2] : &v[0];
+	const Render_Vertex *ly = v[0].y <= v[2].y ? &v[0] : &v[2];
+	const Render_Vertex *hy = v[0].y <= v[2].y ? &v[2] : &v[0];
+
+	SoftQuad q = { 0 };
+	q.x0 = lx->x + dx;
+	q.x1 = hx->x + dx;
+	q.u0 = lx->u;
+	q.u1 = hx->u;
+	q.y0 = ly->y + dy;
+	q.y1 = hy->y + dy;
+	q.v0 = ly->v;
+	q.v1 = hy->v;
+	memcpy(q.color, v[0].color, sizeof(q.color));
+	if (v[0].palette) {
+		const f32 *color = &((const Color *)theme)[v[0].palette - 1].r;
+		for (u32 i = 0; i < 4; i++) {
+			q.color[i] = packUnorm8(color[i] * v[0].color[i] / 255.0f);
+		}
+	}
+	q.layer = v[0].layer;
+	return q;
+}
+
+// Draws what has been batched so far and starts an empty batch.
+static void flushBatch(Renderer* r) {
+	if (r->vert_count == 0) {
+		return;
+	}
+	rendererEnd(r);
+	r->vert_count = 0;
+	r->indices_count = 0;
+}
+
+bool rendererBeginLayer(Renderer* r, RenderLayer *layer, u64 key, rect area, vec2 translation, vec2 target) {
+	// Whole pixels only, so text lands on the same pixel grid as the batch
+	translation = vec2_init(roundf(translation.x), roundf(translation.y));
+	target = vec2_init(roundf(target.x), roundf(target.y));
+	vec2 offset = vec2_sub(translation, layer->origin);
+	if (layer->valid && layer->key == key && offset.x == 0 && offset.y >= layer->min_offset && offset.y <= layer->max_offset) {
+		return false;
+	}
+
+	// At rest only the screen is recorded, so edits cost no more than the
+	// batch would. While moving the layer covers the way to the target plus
+	// some slack in that direction, limited to keep positions well inside 16 bits.
+	f32 travel = target.y - translation.y;
+	f32 slack = area.h * 0.5f;
+	f32 reach = area.h * LAYER_MAX_REACH;
+	layer->min_offset = travel < 0 ? MAX(travel - slack, -reach) : 0;
+	layer->max_offset = travel > 0 ? MIN(travel + slack, reach) : 0;
+
+	layer->vert_count = 0;
+	layer->origin = translation;
+	layer->key = key;
+	layer->valid = true;
+
+	r->recording = layer;
+	r->cull = rect_init(area.x, area.y - layer->max_offset, area.w, area.h + layer->max_offset - layer->min_offset);
+	return true;
+}
+
+void rendererEndLayer(Renderer* r, RenderLayer *layer) {
+	r->recording = NULL;
+	r->cull = rect_init(0, 0, r->screen_width, r->screen_height);
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		return;
+	}
+
+	if (!layer->vao) {
+		glGenVertexArrays(1, &layer->vao);
+		glBindVertexArray(layer->vao);
+		glGenBuffers(1, &layer->vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, layer->vbo);
+		setupVertexAttributes();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, r->ibo);
+	}
+
+	profilerBeginPhase(PROFILE_UPLOAD);
+	glBindBuffer(GL_ARRAY_BUFFER, layer->vbo);
+	if (layer->gpu_capacity < layer->capacity) {
+		layer->gpu_capacity = layer->capacity;
+		glBufferData(GL_ARRAY_BUFFER, layer->gpu_capacity * sizeof(Render_Vertex), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, layer->vert_count * sizeof(Render_Vertex), layer->vertices);
+	profilerEndPhase(PROFILE_UPLOAD);
+
+	r->stats.bytes_uploaded += layer->vert_count * sizeof(Render_Vertex);
+}
+
+void rendererDrawLayer(Renderer* r, RenderLayer *layer, vec2 translation) {
+	flushBatch(r);
+	if (layer->vert_count == 0) {
+		return;
+	}
+
+	translation = vec2_init(roundf(translation.x), roundf(translation.y));
+	vec2 offset = vec2_sub(translation, layer->origin);
+
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		for (u32 i = 0; i < layer->vert_count; i += 4) {
+			softRendererPushQuad(&r->soft, softQuadFromVertices(&layer->vertices[i], &r->theme, (i32)offset.x, (i32)offset.y));
+		}
+		return;
+	}
+
+	u32 program = r->font_format == GLYPH_ATLAS_SDF ? r->sdf_shader : r->shader;
+	glUseProgram(program);
+	i32 translate_loc = glGetUniformLocation(program, "u_translate");
+	glUniform2f(translate_loc, offset.x, offset.y);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, r->textures.texture);
+	glBindVertexArray(layer->vao);
+
+	// The shared index buffer covers MAX_QUADS, bigger layers go in chunks
+	for (u32 first = 0; first < layer->vert_count; first += MAX_VERTICES) {
+		u32 quads = MIN(layer->vert_count - first, MAX_VERTICES) / 4;
+		glDrawElementsBaseVertex(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, NULL, (GLint)first);
+		r->stats.draw_calls++;
+	}
+
+	glUniform2f(translate_loc, 0, 0);
+}
+
+void rendererDestroyLayer(RenderLayer *layer) {
+	if (layer->vao) {
+		glDeleteBuffers(1, &layer->vbo);
+		glDeleteVertexArrays(1, &layer->vao);
+	}
+	free(layer->vertices);
+	*layer = (RenderLayer) { 0 };
+}
+
+bool rendererBeginCache(Renderer* r, RenderCache *cache, u64 key, rect area) {
+	// Tiles already keep unchanged parts of the screen in software
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		return true;
+	}
+
+	// Whole pixels so the composite maps texels 1:1 onto the screen
+	area = rect_init(roundf(area.x), roundf(area.y), roundf(area.w), roundf(area.h));
+	bool same_area = memcmp(&area, &cache->area, sizeof(area)) == 0;
+	if (cache->valid && cache->key == key && same_area) {
+		return false;
+	}
+	if (area.w <= 0 || area.h <= 0) {
+		cache->valid = false;
+		return false;
+	}
+
+	// Whatever is batched belongs to the screen
+	flushBatch(r);
+
+	if (!cache->fbo) {
+		glGenFramebuffers(1, &cache->fbo);
+		glGenTextures(1, &cache->texture);
+		glBindTexture(GL_TEXTURE_2D, cache->texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &cache->prev_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, cache->fbo);
+	if (cache->width != (u32)area.w || cache->height != (u32)area.h) {
+		cache->width = (u32)area.w;
+		cache->height = (u32)area.h;
+		glBindTexture(GL_TEXTURE_2D, cache->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cache->width, cache->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cache->texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("Render cache framebuffer (%ux%u) is incomplete", cache->width, cache->height);
+			exit(1);
+		}
+	}
+
+	cache->area = area;
+	cache->key = key;
+	cache->valid = true;
+
+	glViewport(0, 0, cache->width, cache->height);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// Keep the destination premultiplied so the composite is a plain "over"
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	setProjection(r, mat4_ortho(area.x, area.x + area.w, area.y + area.h, area.y, -0.01, 1.0));
+	r->cull = area;
+	return true;
+}
+
+void rendererEndCache(Renderer* r, RenderCache *cache) {
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		return;
+	}
+	flushBatch(r);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (u32)cache->prev_fbo);
+	glViewport(0, 0, (i32)r->screen_width, (i32)r->screen_height);
+	glClearColor(r->clear_color.r, r->clear_color.g, r->clear_color.b, r->clear_color.a);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	setProjection(r, r->projection);
+	r->cull = rect_init(0, 0, r->screen_width, r->screen_height);
+}
+
+// Composites a premultiplied texture over the area with one quad.
+static void drawTexture(Renderer* r, u32 texture, rect a) {
+	flushBatch(r);
+
+	// UVs in texels like the rest of the batch
+	Color white = COLOR_WHITE;
+	packVertex(&r->vertices[0], vec2_init(a.x, a.y), white, vec2_init(0, 0), 0);
+	packVertex(&r->vertices[1], vec2_init(a.x + a.w, a.y), white, vec2_init(a.w, 0), 0);
+	packVertex(&r->vertices[2], vec2_init(a.x + a.w, a.y + a.h), white, vec2_init(a.w, a.h), 0);
+	packVertex(&r->vertices[3], vec2_init(a.x, a.y + a.h), white, vec2_init(0, a.h), 0);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUseProgram(r->composite_shader);
+	glBindVertexArray(r->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, r->vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, 4 * sizeof(Render_Vertex), r->vertices);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	r->stats.draw_calls++;
+	r->stats.bytes_uploaded += 4 * sizeof(Render_Vertex);
+}
+
+void rendererDrawCache(Renderer* r, RenderCache *cache) {
+	if (!cache->valid || r->backend == RENDER_BACKEND_SOFTWARE) {
+		return;
+	}
+	drawTexture(r, cache->texture, cache->area);
+}
+
+void rendererDestroyCache(RenderCache *cache) {
+	if (cache->fbo) {
+		glDeleteFramebuffers(1, &cache->fbo);
+		glDeleteTextures(1, &cache->texture);
+	}
+	*cache = (RenderCache) { 0 };
+}
+
+void rendererSetClip(Renderer* r, rect area) {
+	// Whole pixels, the same ones for both backends
+	i32 x0 = (i32)roundf(area.x);
+	i32 y0 = (i32)roundf(area.y);
+	i32 x1 = (i32)roundf(area.x + area.w);
+	i32 y1 = (i32)roundf(area.y + area.h);
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		softRendererSetClip(&r->soft, x0, y0, x1, y1);
+		return;
+	}
+	flushBatch(r);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x0, y0, MAX(x1 - x0, 0), MAX(y1 - y0, 0));
+}
+
+void rendererResetClip(Renderer* r) {
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		softRendererResetClip(&r->soft);
+		return;
+	}
+	flushBatch(r);
+	glDisable(GL_SCISSOR_TEST);
 }
 
 void rendererResizeWindow (Renderer* r, i32 width, i32 height) {
@@ -192,78 +530,106 @@ void rendererResizeWindow (Renderer* r, i32 width, i32 height) {
 	r->projection = mat4_ortho(0, (f32)width, (f32)height, 0, -0.01, 1.0);
 	r->screen_width = (f32)width;
 	r->screen_height = (f32)height;
+	r->cull = rect_init(0, 0, r->screen_width, r->screen_height);
+	setProjection(r, r->projection);
 
-	// pass the updated projection to the shader
-	u32 proj_loc = glGetUniformLocation(r->shader, "u_proj");
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, r->projection.a);
+	if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		softRendererResize(&r->soft, (u32)width, (u32)height);
+	}
 }
 
-static void pushQuad (Renderer* r, vec2 a, vec2 b, vec2 c, vec2 d,
-					Color a_color, Color b_color, Color c_color, Color d_color,
-					vec2 a_uv, vec2 b_uv, vec2 c_uv, vec2 d_uv,
-					u32 texture) {
-	
-	/* 	CULLING
-		This if statement causes textures to glitch out */
-	// if (((b.x) < 0 || a.x > r->screen_width || a.y > r->screen_height)){
-	// 	return;	
-	// }
-
-	// 1248 is just an invalid value since this is an unsigned number, -1 doesnt work
-	u32 tex_index = 1248;
-	for (u32 i = 0; i < r->texture_count; i++) {
-		if (r->textures[i] == texture) {
-			tex_index = i;
-			break;
-		}
+void rendererSetTheme(Renderer* r, const ColorTheme *theme) {
+	if (memcmp(&r->theme, theme, sizeof(*theme)) == 0) {
+		return;
 	}
+	r->theme = *theme;
+	glBindBuffer(GL_UNIFORM_BUFFER, r->palette_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(r->theme), &r->theme);
+	r->stats.bytes_uploaded += sizeof(r->theme);
+}
 
-	// r->texture_count < 8 confirms we don't write more than the available
-	// texture slots
-	if (tex_index == 1248 && r->texture_count < 8) {
-		r->textures[r->texture_count] = texture;
-		tex_index = r->texture_count;
-		r->texture_count += 1;
+void rendererSetBackend(Renderer* r, RenderBackend backend) {
+	if (backend == r->backend) {
+		return;
 	}
+	r->backend = backend;
 
-	// Flush the batch if it is full. We don't like segfaults on this channel.
-	if (r->vert_count == MAX_VERTICES || tex_index == 1248) {
-		rendererEnd(r);
-		r->vert_count = 0;
-		r->indices_count = 0;
-		r->texture_count = 0;
+	if (backend == RENDER_BACKEND_SOFTWARE) {
+		softRendererInit(&r->soft, (u32)r->screen_width, (u32)r->screen_height);
+	} else {
+		softRendererDestroy(&r->soft);
 	}
 
-	// Insert info for each vertex and increment the count
-	r->vertices[r->vert_count].pos = a;
-	r->vertices[r->vert_count].color = a_color;
-	r->vertices[r->vert_count].uv = a_uv;
-	r->vertices[r->vert_count].tex_index = tex_index;
-	r->vert_count++;
+	// Neither backend can use what the other one retained
+	for (u32 i = 0; i < MAX_PANES; i++) {
+		r->text_layers[i].valid = false;
+	}
+	r->status_cache.valid = false;
+	r->dialog_cache.valid = false;
+}
 
-	r->vertices[r->vert_count].pos = b;
-	r->vertices[r->vert_count].color = b_color;
-	r->vertices[r->vert_count].uv = b_uv;
-	r->vertices[r->vert_count].tex_index = tex_index;
-	r->vert_count++;
+void rendererSetLigatures(Renderer* r, bool enabled) {
+	if (enabled && !shaperAvailable()) {
+		LOG_WARN("ligatures need HarfBuzz, build with `make HARFBUZZ=1`", "");
+		enabled = false;
+	}
+	r->ligatures = enabled;
+}
 
-	r->vertices[r->vert_count].pos = c;
-	r->vertices[r->vert_count].color = c_color;
-	r->vertices[r->vert_count].uv = c_uv;
-	r->vertices[r->vert_count].tex_index = tex_index;
-	r->vert_count++;
+static void pushQuad (Renderer* r, vec2 a, vec2 b, vec2 c, vec2 d,
+					Color a_color, Color b_color, Color c_color, Color d_color,
+					vec2 a_uv, vec2 b_uv, vec2 c_uv, vec2 d_uv,
+					u32 layer) {
+	
+	// Skip quads that are entirely outside the cull area (the screen, or what a
+	// layer being recorded covers). Besides saving upload bandwidth this
+	// keeps far away text from overflowing the 16 bit positions.
+	f32 min_x = MIN(MIN(a.x, b.x), MIN(c.x, d.x));
+	f32 max_x = MAX(MAX(a.x, b.x), MAX(c.x, d.x));
+	f32 min_y = MIN(MIN(a.y, b.y), MIN(c.y, d.y));
+	f32 max_y = MAX(MAX(a.y, b.y), MAX(c.y, d.y));
+	rect cull = r->cull;
+	if (max_x < cull.x || min_x > cull.x + cull.w || max_y < cull.y || min_y > cull.y + cull.h) {
+		return;
+	}
 
-	r->vertices[r->vert_count].pos = d;
-	r->vertices[r->vert_count].color = d_color;
-	r->vertices[r->vert_count].uv = d_uv;
-	r->vertices[r->vert_count].tex_index = tex_index;
-	r->vert_count++;
+	Render_Vertex *v;
+	Render_Vertex soft_quad[4];
+	RenderLayer *recording = r->recording;
+	if (recording) {
+		// Layers are kept across frames, so they grow instead of flushing
+		if (recording->vert_count == recording->capacity) {
+			recording->capacity = recording->capacity ? recording->capacity * 2 : MAX_VERTICES;
+			recording->vertices = (Render_Vertex *)realloc(recording->vertices, recording->capacity * sizeof(Render_Vertex));
+		}
+		v = &recording->vertices[recording->vert_count];
+		recording->vert_count += 4;
+	} else if (r->backend == RENDER_BACKEND_SOFTWARE) {
+		v = soft_quad;
+	} else {
+		// Flush the batch if it is full. We don't like segfaults on this channel.
+		if (r->vert_count == MAX_VERTICES) {
+			flushBatch(r);
+			r->stats.flushes++;
+		}
+		v = &r->vertices[r->vert_count];
+		r->vert_count += 4;
+		r->indices_count += 6;
+	}
+
+	// Insert info for each vertex
+	packVertex(&v[0], a, a_color, a_uv, layer);
+	packVertex(&v[1], b, b_color, b_uv, layer);
+	packVertex(&v[2], c, c_color, c_uv, layer);
+	packVertex(&v[3], d, d_color, d_uv, layer);
+	if (v == soft_quad) {
+		softRendererPushQuad(&r->soft, softQuadFromVertices(v, &r->theme, 0, 0));
+	}
 
-	r->indices_count += 6;
+	r->stats.quads++;
 }
 
 void renderQuad(Renderer* r, rect quad, Color color) {
-	u32 texture = rendererGetWhiteTexture();
 	vec2 uv_min = vec2_init(0, 1);  // Bottom-left
     vec2 uv_max = vec2_init(1, 0);  // Top-right
 
@@ -278,13 +644,14 @@ void renderQuad(Renderer* r, rect quad, Color color) {
 		vec2_init(uv_max.x, uv_min.y), 
 		uv_max, 
 		vec2_init(uv_min.x, uv_max.y),
-		texture
+		r->white_layer
 	);
 }
 
-void renderTexturedQuad(Renderer* r, rect quad, Color tint, u32 texture) {
-    vec2 uv_min = vec2_init(0, 1);  // Bottom-left
-    vec2 uv_max = vec2_init(1, 0);  // Top-right
+void renderTexturedQuad(Renderer* r, rect quad, Color tint, u32 layer, vec2 texture_size) {
+	// UVs are in texels
+    vec2 uv_min = vec2_init(0, texture_size.y);  // Bottom-left
+    vec2 uv_max = vec2_init(texture_size.x, 0);  // Top-right
 
 	pushQuad (
 		r,
@@ -297,50 +664,44 @@ void renderTexturedQuad(Renderer* r, rect quad, Color tint, u32 texture) {
 		vec2_init(uv_max.x, uv_min.y), 
 		uv_max, 
 		vec2_init(uv_min.x, uv_max.y),
-		texture
+		layer
 	);
 }
 
-void renderChar(Renderer* r, char character, vec2 *pos, GlyphAtlas *atlas, Color tint) {
-	// If the character is a newline, don't do anything.
-	if (character == '\n') {
-		return;
-	}
-
-	size_t glyph_index = character;
-	if (glyph_index >= GLYPH_METRICS_CAPACITY) {
-		glyph_index = '?';
-	}
+// Where a glyph drawn with its pen at pos lands, and its texel UVs. Advances the pen.
+static rect glyphRect(GlyphMetric metric, f32 s, vec2 *pos, vec2 *uv_min, vec2 *uv_max) {
+	rect quad = rect_init(pos->x + metric.bl * s, pos->y - (metric.bh - metric.bt) * s, metric.bw * s, metric.bh * s);
 
-	GlyphMetric metric = atlas->metrics[glyph_index];
-	f32 x2 = pos->x + metric.bl;
-	f32 y2 = pos->y - (metric.bh - metric.bt);
-	f32 w  = metric.bw;
-	f32 h  = metric.bh;
+	// UVs are in texels, the shader normalizes them against the atlas size
+	*uv_min = vec2_init(metric.tx, metric.ty + metric.bh);
+	*uv_max = vec2_init(metric.tx + metric.bw, metric.ty);
 
-	f32 u0 = metric.tx;
-	f32 v0 = 0.0f;
-	f32 u1 = (metric.tx) + (w / (f32)atlas->atlas_width);
-	f32 v1 = h / (f32)atlas->atlas_height;
+	// advance the position by the width of the character
+	pos->x += metric.ax * s;
+	return quad;
+}
 
-	vec2 uv_min = vec2_init(u0, v1);
-	vec2 uv_max = vec2_init(u1, v0);
+void renderChar(Renderer* r, u32 codepoint, vec2 *pos, GlyphAtlas *atlas, Color tint) {
+	// If the character is a newline, don't do anything.
+	if (codepoint == '\n') {
+		return;
+	}
 
-	// advance the position by the width of the character
-	pos->x += metric.ax;
+	vec2 uv_min, uv_max;
+	rect quad = glyphRect(glyphAtlasGetGlyph(atlas, codepoint), atlas->scale, pos, &uv_min, &uv_max);
 
 	pushQuad (
 		r,
-		vec2_init(x2, y2), 
-		vec2_init(x2 + w, y2), 
-		vec2_init(x2 + w, y2 + h), 
-		vec2_init(x2, y2 + h),
+		vec2_init(quad.x, quad.y), 
+		vec2_init(quad.x + quad.w, quad.y), 
+		vec2_init(quad.x + quad.w, quad.y + quad.h), 
+		vec2_init(quad.x, quad.y + quad.h),
 		tint, tint, tint, tint,
 		uv_min, 
 		vec2_init(uv_max.x, uv_min.y), 
 		uv_max, 
 		vec2_init(uv_min.x, uv_max.y),
-		atlas->glyphs_texture
+		atlas->layer
 	);
 }
 
@@ -348,318 +709,679 @@ void renderText(Renderer* r, char *data, vec2 *pos, GlyphAtlas *atlas, Color tin
 	vec2 init_pos = vec2_init(pos->x, pos->y);
 
 	size_t len_data = strlen(data);
-	for (size_t i = 0; i < len_data; i++) {
+	size_t i = 0;
+	while (i < len_data) {
 		// If the character is a newline, move down and back over to the left.
 		if (data[i] == '\n') {
 			pos->x = init_pos.x;
-			pos->y -= atlas->atlas_height;
+			pos->y -= atlas->line_height;
+			i++;
 			continue;
 		}
 
 		// Render the character
-		renderChar(r, data[i], pos, atlas, tint);
+		size_t codepoint_len = 1;
+		u32 codepoint = utf8Decode(&data[i], &codepoint_len);
+		renderChar(r, codepoint, pos, atlas, tint);
+		i += codepoint_len;
 	}
 }
 
 //~ Helper stuff
-u32 _cached_white = 4096;
-
-u32 rendererGetWhiteTexture() {
-	if (_cached_white == 4096) {
-		u32 tex;
-		u8 image[4] = { 255, 255, 255, 255 };
-		glGenTextures(1, &tex);
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		_cached_white = tex;
+// Hashes what everything drawn with the current font depends on, besides the text itself.
+static u64 hashFontState(u64 key, Renderer* r, const AppContext *ctx) {
+	GlyphAtlas *atlas = &r->font_atlases[ctx->font_id];
+	key = fnv1a(key, &ctx->font_id, sizeof(ctx->font_id));
+	key = fnv1a(key, &r->font_generation, sizeof(r->font_generation));
+	key = fnv1a(key, &atlas->evictions, sizeof(atlas->evictions));
+	key = fnv1a(key, &r->screen_width, sizeof(r->screen_width));
+	key = fnv1a(key, &r->screen_height, sizeof(r->screen_height));
+	return key;
+}
+
+// Everything the editor's text layer depends on, apart from the scroll position.
+// Its colors are palette indices, so the theme isn't part of it.
+static u64 textLayerKey(Renderer* r, const EditorView *v) {
+	i32 selection_size = v->cursor.selection_size;
+	size_t selection[2] = { 0, 0 };
+	if (selection_size != 0) {
+		selection[0] = MIN(v->cursor.buffer_pos, v->cursor.buffer_pos - selection_size);
+		selection[1] = MAX(v->cursor.buffer_pos, v->cursor.buffer_pos - selection_size);
+	}
+
+	u64 key = fnv1a(FNV_OFFSET_BASIS, &v->text->revision, sizeof(v->text->revision));
+	key = fnv1a(key, selection, sizeof(selection));
+	key = fnv1a(key, &v->cursor.disp_row, sizeof(v->cursor.disp_row));
+	key = fnv1a(key, &v->text_pos, sizeof(v->text_pos));
+	key = fnv1a(key, &v->frame, sizeof(v->frame));
+	key = fnv1a(key, &v->gutter.digits, sizeof(v->gutter.digits));
+	key = fnv1a(key, &r->ligatures, sizeof(r->ligatures));
+	return hashFontState(key, r, &v->ctx);
+}
+
+// Lines of text each job builds at least. Below this waking threads costs
+// more than they save.
+#define TEXT_LINES_PER_JOB 48
+
+// A run of whole lines of the editor's text, built into its own slice of the
+// text layer. Jobs only read the view, the glyph atlas (through
+// glyphAtlasPeekGlyph) and the shaper (through shaperFind), so they run on
+// the worker threads. Colors are written as palette indices, see THEME_PALETTE.
+typedef struct {
+	Renderer *r;
+	const EditorView *v;
+	const AppContext *ctx;
+	rect cull;
+
+	size_t token_begin;
+	size_t token_end;
+	size_t buffer_pos; // buffer position of token_begin
+	vec2 pos;          // pen position at token_begin, the start of a line
+
+	Render_Vertex *vertices; // preallocated slice of the layer
+	u32 vert_count;
+	u32 capacity;
+} TextJob;
+
+// pushQuad for a job's slice, only for axis aligned quads in a theme color.
+static void jobPushQuad(TextJob *job, rect quad, u8 palette, vec2 uv_min, vec2 uv_max, u32 layer) {
+	rect cull = job->cull;
+	if (quad.x + quad.w < cull.x || quad.x > cull.x + cull.w || quad.y + quad.h < cull.y || quad.y > cull.y + cull.h) {
+		return;
+	}
+	if (job->vert_count + 4 > job->capacity) {
+		LOG_ERROR("text job slice of %u vertices overflowed", job->capacity);
+		exit(1);
 	}
-	return _cached_white;
+
+	Render_Vertex *v = &job->vertices[job->vert_count];
+	Color white = COLOR_WHITE;
+	packVertex(&v[0], vec2_init(quad.x, quad.y), white, uv_min, layer);
+	packVertex(&v[1], vec2_init(quad.x + quad.w, quad.y), white, vec2_init(uv_max.x, uv_min.y), layer);
+	packVertex(&v[2], vec2_init(quad.x + quad.w, quad.y + quad.h), white, uv_max, layer);
+	packVertex(&v[3], vec2_init(quad.x, quad.y + quad.h), white, vec2_init(uv_min.x, uv_max.y), layer);
+	for (u32 i = 0; i < 4; i++) {
+		v[i].palette = palette;
+	}
+	job->vert_count += 4;
 }
 
-static void renderSelectionOnToken (Renderer* r, Editor *e, AppContext *ctx, vec2 adj_text_pos, size_t buffer_pos, size_t token_len, Color selection_color) {
-	i32 selection_size = e->cursor.selection_size;
-	size_t selection_beg = e->cursor.buffer_pos - selection_size;
-	size_t selection_end = e->cursor.buffer_pos;
-	i32 selection_offset_x = 0;
-	i32 selection_offset_w = 0;
-	f32 selection_x = adj_text_pos.x;
-	f32 selection_w = 0.0;
-	size_t token_end = buffer_pos + token_len;
+// renderText for a job's slice.
+static void jobText(TextJob *job, GlyphAtlas *atlas, const char *data, size_t len, vec2 *pos, u8 palette) {
+	f32 line_x = pos->x;
+	size_t i = 0;
+	while (i < len) {
+		if (data[i] == '\n') {
+			pos->x = line_x;
+			pos->y -= atlas->line_height;
+			i++;
+			continue;
+		}
+
+		size_t codepoint_len = 1;
+		u32 codepoint = utf8Decode(&data[i], &codepoint_len);
+		vec2 uv_min, uv_max;
+		rect quad = glyphRect(glyphAtlasPeekGlyph(atlas, codepoint), atlas->scale, pos, &uv_min, &uv_max);
+		jobPushQuad(job, quad, palette, uv_min, uv_max, atlas->layer);
+		i += codepoint_len;
+	}
+}
 
-	/*
-	the selection starts before the token and extends through it - color whole token
-	the selection starts after the token and extends behind it - color whole token
-	*/
-	if (selection_size != 0) {
-		if ((selection_beg <= buffer_pos && selection_end >= token_end) ||
-			(selection_beg >= token_end && selection_end <= buffer_pos)) {
-				selection_x = adj_text_pos.x;
-				selection_w = r->glyph_adv * token_len;
+// jobText for the glyphs of a shaped run.
+static void jobShapedRun(TextJob *job, GlyphAtlas *atlas, const ShapedRun *run, vec2 *pos, u8 palette) {
+	const ShapedGlyph *glyphs = job->r->shaper.glyphs + run->first;
+	f32 s = atlas->scale;
+	for (u32 i = 0; i < run->count; i++) {
+		vec2 pen = vec2_init(pos->x + glyphs[i].x_offset * s, pos->y + glyphs[i].y_offset * s);
+		vec2 uv_min, uv_max;
+		rect quad = glyphRect(glyphAtlasPeekGlyph(atlas, glyphs[i].glyph), s, &pen, &uv_min, &uv_max);
+		jobPushQuad(job, quad, palette, uv_min, uv_max, atlas->layer);
+		pos->x += glyphs[i].advance * s;
+	}
+}
+
+// Columns count codepoints, like getBufColumn.
+static size_t textColumn(const TextSnapshot *t, size_t line_beg, size_t pos) {
+	size_t column = 0;
+	for (size_t i = line_beg; i < pos; i++) {
+		if (!utf8IsContinuation(t->text[i])) {
+			column++;
+		}
+	}
+	return column;
+}
+
+// Draws the part of the selection on the line starting at line_beg as a single
+// quad. Called once per line while walking the tokens, so a selection costs at
+// most one quad per visible line no matter how much of the file it covers.
+static void jobSelectionLine(TextJob *job, size_t line_beg, vec2 line_pos) {
+	const EditorView *v = job->v;
+	const AppContext *ctx = job->ctx;
+	i32 selection_size = v->cursor.selection_size;
+	if (selection_size == 0) {
+		return;
+	}
+
+	// Only lines inside the cull area matter
+	f32 y = line_pos.y - ctx->descender;
+	if (y + ctx->line_height < job->cull.y || y > job->cull.y + job->cull.h) {
+		return;
+	}
+
+	size_t selection_lo = MIN(v->cursor.buffer_pos, v->cursor.buffer_pos - selection_size);
+	size_t selection_hi = MAX(v->cursor.buffer_pos, v->cursor.buffer_pos - selection_size);
+	if (selection_hi <= line_beg) {
+		return;
+	}
+
+	const TextSnapshot *t = v->text;
+	const char *newline = memchr(t->text + line_beg, '\n', t->length - line_beg);
+	size_t line_end = newline ? (size_t)(newline - t->text) : t->length;
+	if (selection_lo > line_end) {
+		return;
+	}
+
+	f32 glyph_adv = job->r->glyph_adv;
+	size_t beg = MAX(selection_lo, line_beg);
+	size_t end = MIN(selection_hi, line_end);
+	f32 x = line_pos.x + glyph_adv * textColumn(t, line_beg, beg);
+	f32 w = glyph_adv * textColumn(t, beg, end);
+
+	// Selecting past the end of the line includes its newline
+	if (selection_hi > line_end) {
+		w += glyph_adv;
+	}
+	jobPushQuad(job, rect_init(x, y, w, ctx->line_height), THEME_PALETTE(user_selection), vec2_init(0, 1), vec2_init(1, 0), job->r->white_layer);
+}
+
+static u8 tokenPalette(TokenType type) {
+	switch (type) {
+		case TOKEN_COMMENT_SINGLE: return THEME_PALETTE(single_line_comment);
+		case TOKEN_COMMENT_MULTI: return THEME_PALETTE(multiline_comment);
+		case TOKEN_STRING_LITERAL_DOUBLE: return THEME_PALETTE(double_quote_string);
+		case TOKEN_STRING_LITERAL_SINGLE: return THEME_PALETTE(single_quote_string);
+		case TOKEN_ESCAPE_SEQUENCE: return THEME_PALETTE(number);
+		case TOKEN_NUMBER: return THEME_PALETTE(number);
+		case TOKEN_SYMBOL: return THEME_PALETTE(symbol);
+		case TOKEN_PREPROCESSOR_DIRECTIVE: return THEME_PALETTE(keyword);
+		case TOKEN_KEYWORD: return THEME_PALETTE(keyword);
+		case TOKEN_SECONDARY_KEYWORD: return THEME_PALETTE(secondary_keyword);
+		case TOKEN_BUILT_IN_TYPE: return THEME_PALETTE(built_in_type);
+		case TOKEN_FUNCTION_NAME: return THEME_PALETTE(function_name);
+		case TOKEN_TYPE_NAME: return THEME_PALETTE(type);
+		default: return THEME_PALETTE(foreground);
+	}
+}
+
+// End of the run of tokens from begin that is shaped as a whole: tokens of the
+// same color on one line. Returns begin for tokens spanning lines, those are
+// drawn a codepoint at a time.
+static size_t textRunEnd(const TextSnapshot *t, size_t begin, size_t end) {
+	u8 palette = tokenPalette(t->tokens[begin].type);
+	size_t i = begin;
+	while (i < end && tokenPalette(t->tokens[i].type) == palette && !memchr(t->text + t->tokens[i].offset, '\n', t->tokens[i].length)) {
+		i++;
+	}
+	return i;
+}
+
+// Tokens are consecutive, so a run is a single slice of the text
+static const char *textRun(const TextSnapshot *t, size_t begin, size_t end, size_t *len) {
+	*len = t->tokens[end - 1].offset + t->tokens[end - 1].length - t->tokens[begin].offset;
+	return t->text + t->tokens[begin].offset;
+}
+
+static u64 textRunKey(u32 font_id, const TextSnapshot *t, size_t begin, size_t end) {
+	size_t len = 0;
+	const char *text = textRun(t, begin, end, &len);
+	return fnv1a(shaperKey(font_id), text, len);
+}
+
+// Shapes the run (when it isn't cached) and loads its glyphs into the atlas,
+// for jobs to find. Returns how many glyphs it has.
+static u32 prepareTextRun(Renderer *r, u32 font_id, const TextSnapshot *t, size_t begin, size_t end) {
+	GlyphAtlas *atlas = &r->font_atlases[font_id];
+	u64 key = textRunKey(font_id, t, begin, end);
+	const ShapedRun *run = shaperFind(&r->shaper, key);
+	if (!run) {
+		size_t len = 0;
+		const char *text = textRun(t, begin, end, &len);
+		run = shaperShape(&r->shaper, key, font_id, atlas, text, len);
+		r->stats.shaped_runs++;
+	}
+	if (!run) {
+		return 0;
+	}
+
+	const ShapedGlyph *glyphs = r->shaper.glyphs + run->first;
+	for (u32 i = 0; i < run->count; i++) {
+		glyphAtlasGetGlyph(atlas, glyphs[i].glyph);
+	}
+	return run->count;
+}
+
+// Selection and syntax highlighted text of the job's lines.
+static void buildTextJob(void *item) {
+	TextJob *job = (TextJob *)item;
+	const TextSnapshot *t = job->v->text;
+	GlyphAtlas *atlas = &job->r->font_atlases[job->ctx->font_id];
+	f32 line_x = job->pos.x;
+
+	size_t buffer_pos = job->buffer_pos;
+	bool line_start = true;
+	vec2 pos = job->pos;
+	size_t run_end = job->token_begin; // tokens before it were drawn by a shaped run
+
+	for (size_t i = job->token_begin; i < job->token_end; i++) {
+		TextToken token = t->tokens[i];
+		const char *text = t->text + token.offset;
+		size_t token_len = token.length;
+
+		// Selections go under the text, so emit them for every line the
+		// token starts (multiline comments and strings can start several)
+		if (line_start) {
+			jobSelectionLine(job, buffer_pos, vec2_init(line_x, pos.y));
+			line_start = false;
+		}
+		if (token.type == TOKEN_NEW_LINE) {
+			line_start = true;
+		} else {
+			vec2 inner_pos = vec2_init(line_x, pos.y);
+			for (size_t k = 0; k + 1 < token_len; k++) {
+				if (text[k] == '\n') {
+					inner_pos.y -= atlas->line_height;
+					jobSelectionLine(job, buffer_pos + k + 1, inner_pos);
+				}
+			}
 		}
-		/* the selection starts on the token and extends through it to the right - color part of token */	
-		else if (selection_beg > buffer_pos && selection_beg < token_end && selection_end >= buffer_pos + token_len) {
-			selection_offset_x = selection_beg - buffer_pos;
-			selection_offset_w = token_len - selection_offset_x;
-			selection_x = adj_text_pos.x + r->glyph_adv * selection_offset_x;
-			selection_w = r->glyph_adv * selection_offset_w;
+		buffer_pos += token_len;
+
+		if (job->r->ligatures && i >= run_end) {
+			run_end = textRunEnd(t, i, job->token_end);
+			const ShapedRun *run = run_end > i ? shaperFind(&job->r->shaper, textRunKey(job->ctx->font_id, t, i, run_end)) : NULL;
+			if (run) {
+				jobShapedRun(job, atlas, run, &pos, tokenPalette(token.type));
+			} else {
+				run_end = i;
+			}
 		}
-		/* the selection starts on the token and extends through it to the left - color part of token */
-		else if (selection_beg > buffer_pos && selection_beg <= token_end && selection_end <= buffer_pos) {
-			selection_offset_w = selection_beg - buffer_pos;
-			selection_x = adj_text_pos.x;
-			selection_w = r->glyph_adv * selection_offset_w;
+		if (i >= run_end) {
+			jobText(job, atlas, text, token_len, &pos, tokenPalette(token.type));
 		}
-		/* the selection starts before the token and ends in it - color part of token */
-		else if (selection_beg <= buffer_pos && selection_end >= buffer_pos && selection_end <= token_end) {
-			selection_offset_w = selection_end - buffer_pos;
-			selection_x = adj_text_pos.x;
-			selection_w = r->glyph_adv * selection_offset_w;
-		} 
-		/* selection stars after the token and ends in it */
-		else if ((selection_beg >= token_end && (selection_end >= buffer_pos && selection_end <= token_end))) {
-			selection_offset_x = selection_end - buffer_pos;
-			selection_offset_w = token_len - selection_offset_x;
-			selection_x = adj_text_pos.x + r->glyph_adv * selection_offset_x;
-			selection_w = r->glyph_adv * selection_offset_w;
-		} 
-		/* selection starts in the token and ends in the token */
-		else if (selection_beg > buffer_pos && selection_end <= token_end) {
-			selection_offset_x = MIN(selection_beg, selection_end) - buffer_pos;
-			selection_offset_w = abs(selection_size);
-			selection_x = adj_text_pos.x + r->glyph_adv * selection_offset_x;
-			selection_w = r->glyph_adv * selection_offset_w;
-			
+		if (token.type == TOKEN_NEW_LINE) {
+			pos.x = line_x;
 		}
-		renderQuad(r, rect_init(selection_x, adj_text_pos.y - ctx->descender, selection_w, ctx->line_height), selection_color);
-	} 
+	}
 }
 
-void renderEditor(Renderer* r, Editor *e, AppContext *ctx, f32 delta_time, ColorTheme theme) {
-	UNUSED(delta_time);
+// Index of the first line start at or after line, or of the end.
+static size_t findLineStart(const TextSnapshot *t, i64 line) {
+	size_t low = 0;
+	size_t high = t->line_start_count - 1;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if ((i64)t->line_starts[mid].line >= line) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
 
-	renderQuad(r, e->frame, theme.background);
-	GlyphAtlas atlas = r->font_atlases[ctx->font_id];
-	
-	if (e->mode != EDITOR_MODE_OPEN) {
-		vec2 init_pos = vec2_init(e->text_pos.x, e->text_pos.y - ctx->line_height);
-		vec2 adj_text_pos = vec2_add(init_pos, e->scroll_pos);
-		
-		// Render line highlight
-		if (e->mode == EDITOR_MODE_NORMAL) {
-			renderQuad(r, rect_init(e->frame.x, e->cursor.screen_pos.y, e->frame.w, atlas.atlas_height), theme.current_line);
+static void setJobStart(TextJob *job, const TextLineStart *start, vec2 text_pos, f32 line_height) {
+	job->token_begin = start->token;
+	job->buffer_pos = start->offset;
+	job->pos = vec2_init(text_pos.x, text_pos.y - (f32)start->line * line_height);
+}
+
+// Selection, syntax highlighted text and line numbers. These only move when
+// scrolling, so they are recorded into the text layer at the given scroll.
+// The lines that can be visible are split into jobs run as jobs,
+// each writing into its own slice of the layer; the slices are then packed
+// together in order, so the layer is the same as building it on one thread.
+static void renderEditorText(Renderer* r, const EditorView *v, vec2 scroll_pos) {
+	const AppContext *ctx = &v->ctx;
+	const TextSnapshot *t = v->text;
+	GlyphAtlas *atlas = &r->font_atlases[ctx->font_id];
+	RenderLayer *layer = r->recording;
+	rect cull = r->cull;
+	f32 cull_top = cull.y + cull.h;
+	f32 line_height = atlas->line_height;
+	vec2 text_pos = vec2_add(vec2_init(v->text_pos.x, v->text_pos.y - ctx->line_height), scroll_pos);
+
+	// Lines whose pen is within a line of the cull area, line n has its pen at
+	// text_pos.y - n * line_height
+	i64 first_line = MAX((i64)floorf((text_pos.y - cull_top) / line_height) - 1, 0);
+	i64 last_line = MAX((i64)ceilf((text_pos.y - cull.y) / line_height) + 1, first_line);
+
+	u32 job_count = (u32)CLAMP(1, (last_line - first_line + 1) / TEXT_LINES_PER_JOB, jobsThreadCount() + 1);
+	TextJob jobs[WORKERS_MAX + 2];
+	i64 job_lines[WORKERS_MAX + 2];
+	for (u32 j = 0; j <= job_count; j++) {
+		job_lines[j] = first_line + (last_line + 1 - first_line) * j / job_count;
+	}
+
+	// A job starts on the first line start at or after its first line, except
+	// the first job, which starts on the last one before it in case a
+	// multiline token reaches into the visible lines.
+	size_t first = findLineStart(t, job_lines[0]);
+	if ((i64)t->line_starts[first].line > job_lines[0] && first > 0) {
+		first--;
+	}
+	setJobStart(&jobs[0], &t->line_starts[first], text_pos, line_height);
+	for (u32 j = 1; j <= job_count; j++) {
+		const TextLineStart *start = &t->line_starts[findLineStart(t, job_lines[j])];
+		jobs[j - 1].token_end = start->token;
+		if (j < job_count) {
+			setJobStart(&jobs[j], start, text_pos, line_height);
 		}
+	}
 
-		// Render the tokens
-		size_t buffer_pos = 0;
-		
-		for (size_t i = 0; i < e->lexer.token_count; i++) {
-			Token curToken = e->lexer.tokens[i];
-			size_t token_len = strlen(curToken.text);
-			
-			renderSelectionOnToken (r, e, ctx, adj_text_pos, buffer_pos, token_len, theme.user_selection);
-			buffer_pos += token_len;
-			
-			switch(curToken.type) {
-				case TOKEN_COMMENT_SINGLE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.single_line_comment);
-				break;
-
-				case TOKEN_COMMENT_MULTI:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.multiline_comment);
-				break;
-
-				case TOKEN_STRING_LITERAL_DOUBLE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.double_quote_string);
-				break;
-
-				case TOKEN_STRING_LITERAL_SINGLE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.single_quote_string);
-				break;
-
-				case TOKEN_ESCAPE_SEQUENCE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.number);
-				break;
-
-				case TOKEN_NUMBER:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.number);
-				break;
-
-				case TOKEN_SYMBOL:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.symbol);
-				break;
-
-				case TOKEN_NEW_LINE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.foreground);
-					adj_text_pos.x = init_pos.x;
-				break;
-
-				case TOKEN_PREPROCESSOR_DIRECTIVE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.keyword);
-				break;
-
-				case TOKEN_KEYWORD:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.keyword);
-				break;
-
-				case TOKEN_SECONDARY_KEYWORD:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.secondary_keyword);
-				break;
-
-				case TOKEN_BUILT_IN_TYPE:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.built_in_type);
-				break;
-
-				case TOKEN_FUNCTION_NAME:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.function_name);
-				break;
-
-				case TOKEN_TYPE_NAME:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.type);
-				break;
-				
-				default:
-					renderText(r, e->lexer.tokens[i].text, &adj_text_pos, &atlas, theme.foreground);
-				break;
+	// Line numbers of the lines that can be visible go last, built here
+	vec2 gutter_text_pos = vec2_init(r->glyph_adv, v->frame.y + v->frame.h - ctx->line_height);
+	gutter_text_pos = vec2_add(gutter_text_pos, scroll_pos);
+	i32 first_number = (i32)MAX(floorf((gutter_text_pos.y - cull_top) / ctx->line_height), 1);
+	i32 last_number = (i32)MIN(ceilf((gutter_text_pos.y - cull.y) / ctx->line_height) + 2, (f32)v->line_count);
+	TextJob *numbers = &jobs[job_count];
+
+	// Slices are sized for a glyph per byte (and per shaped glyph) plus a
+	// selection quad per line. Glyphs outside ASCII and runs that aren't
+	// shaped yet are loaded here, jobs can't touch the atlas or the shaper.
+	if (r->ligatures) {
+		shaperTrim(&r->shaper);
+	}
+	u32 total_capacity = 0;
+	for (u32 j = 0; j <= job_count; j++) {
+		TextJob *job = &jobs[j];
+		job->r = r;
+		job->v = v;
+		job->ctx = ctx;
+		job->cull = cull;
+		job->vert_count = 0;
+		if (job == numbers) {
+			job->capacity = (u32)MAX(last_number - first_number + 1, 0) * 10 * 4;
+			total_capacity += job->capacity;
+			break;
+		}
+
+		size_t bytes = 0;
+		size_t lines = 1;
+		size_t run_end = job->token_begin;
+		for (size_t i = job->token_begin; i < job->token_end; i++) {
+			if (r->ligatures && i >= run_end) {
+				run_end = textRunEnd(t, i, job->token_end);
+				if (run_end > i) {
+					bytes += prepareTextRun(r, ctx->font_id, t, i, run_end);
+				}
+			}
+
+			const char *text = t->text + t->tokens[i].offset;
+			size_t len = t->tokens[i].length;
+			size_t k = 0;
+			while (k < len) {
+				size_t codepoint_len = 1;
+				if (text[k] == '\n') {
+					lines++;
+				} else if ((u8)text[k] >= 0x80) {
+					glyphAtlasGetGlyph(atlas, utf8Decode(&text[k], &codepoint_len));
+				}
+				k += codepoint_len;
 			}
+			bytes += len;
 		}
+		job->capacity = (u32)(bytes + lines) * 4;
+		total_capacity += job->capacity;
+	}
+
+	if (layer->vert_count + total_capacity > layer->capacity) {
+		layer->capacity = MAX(layer->vert_count + total_capacity, layer->capacity * 2);
+		layer->vertices = (Render_Vertex *)realloc(layer->vertices, layer->capacity * sizeof(Render_Vertex));
+	}
+	Render_Vertex *slice = layer->vertices + layer->vert_count;
+	for (u32 j = 0; j <= job_count; j++) {
+		jobs[j].vertices = slice;
+		slice += jobs[j].capacity;
+	}
+
+	jobsRunBatch(buildTextJob, jobs, sizeof(TextJob), job_count, PROFILE_JOB_TEXT);
+
+	i32 cur_line = v->cursor.disp_row;
+	for (i32 i = first_number; i <= last_number; ++i) {
+		char num[11];
+		i32 gutter_digit_padding = MAX(v->gutter.digits, 2);
+		i32 length = snprintf(num, sizeof(num), "%*d", gutter_digit_padding, i);
+		vec2 pos = vec2_init(v->frame.x + r->glyph_adv, gutter_text_pos.y - (i - 1) * ctx->line_height);
+		jobText(numbers, atlas, num, (size_t)MIN(length, 10), &pos, cur_line == i ? THEME_PALETTE(user_selection) : THEME_PALETTE(gutter_foreground));
+	}
+
+	// Submit the slices in order
+	for (u32 j = 0; j <= job_count; j++) {
+		memmove(layer->vertices + layer->vert_count, jobs[j].vertices, jobs[j].vert_count * sizeof(Render_Vertex));
+		layer->vert_count += jobs[j].vert_count;
+		r->stats.quads += jobs[j].vert_count / 4;
+	}
+}
+
+static void renderSaveDialog(Renderer* r, const EditorView *v, ColorTheme theme) {
+	GlyphAtlas *atlas = &r->font_atlases[v->ctx.font_id];
+	char *text = v->dialog_text;
+	rect frame = v->dialog_frame;
+
+	// The border sits just outside the frame on the right and top
+	rect area = rect_init(frame.x, frame.y, frame.w + 1, frame.h + 1);
+	u64 key = fnv1a(FNV_OFFSET_BASIS, text, strlen(text));
+	key = fnv1a(key, &frame, sizeof(frame));
+	key = fnv1a(key, &v->dialog_input_box, sizeof(v->dialog_input_box));
+	key = hashFontState(key, r, &v->ctx);
+	key = fnv1a(key, &theme, sizeof(theme));
+
+	if (rendererBeginCache(r, &r->dialog_cache, key, area)) {
+		renderQuad(r, frame, theme.background);
 		
+		rect left_border_quad = rect_init(frame.x, frame.y, 1, frame.h);
+		renderQuad(r, left_border_quad, theme.user_selection);
 
-		if (e->mode == EDITOR_MODE_SAVE) {
-			SaveDialog sd = e->sd;
+		rect right_border_quad = rect_init(frame.x + frame.w, frame.y, 1, frame.h);
+		renderQuad(r, right_border_quad, theme.user_selection);
 
-			renderQuad(r, sd.frame, theme.background);
-			
-			rect left_border_quad = rect_init(sd.frame.x, sd.frame.y, 1, sd.frame.h);
-			renderQuad(r, left_border_quad, theme.user_selection);
+		rect top_border_quad = rect_init(frame.x, frame.y + frame.h, frame.w, 1);
+		renderQuad(r, top_border_quad, theme.user_selection);
 
-			rect right_border_quad = rect_init(sd.frame.x + sd.frame.w, sd.frame.y, 1, sd.frame.h);
-			renderQuad(r, right_border_quad, theme.user_selection);
+		rect bottom_border_quad = rect_init(frame.x, frame.y, frame.w, 1);
+		renderQuad(r, bottom_border_quad, theme.user_selection);
 
-			rect top_border_quad = rect_init(sd.frame.x, sd.frame.y + sd.frame.h, sd.frame.w, 1);
-			renderQuad(r, top_border_quad, theme.user_selection);
+		vec2 title_pos = v->dialog_title_pos;
+		renderText(r, "Save As:", &title_pos, atlas, theme.foreground);
+		renderQuad(r, v->dialog_input_box, theme.current_line);
 
-			rect bottom_border_quad = rect_init(sd.frame.x, sd.frame.y, sd.frame.w, 1);
-			renderQuad(r, bottom_border_quad, theme.user_selection);
+		// render text in dialog input box
+		vec2 text_pos = v->dialog_text_pos;
+		renderText(r, text, &text_pos, atlas, theme.foreground);
+		rendererEndCache(r, &r->dialog_cache);
+	}
+	rendererDrawCache(r, &r->dialog_cache);
 
-			renderText(r, "Save As:", &sd.title_pos, &atlas, theme.foreground);
-			renderQuad(r, sd.input_box, theme.current_line);
+	// Render cursor
+	rect cursor_quad = rect_init(v->dialog_cursor.screen_pos.x, v->dialog_cursor.screen_pos.y, 3, atlas->line_height);
+	Color cursor_color = theme.foreground;
+	cursor_color.a = v->dialog_cursor.alpha;
+	renderQuad(r, cursor_quad, cursor_color);
+}
 
-			// Render cursor
-			rect cursor_quad = rect_init(sd.cursor.screen_pos.x, sd.cursor.screen_pos.y, 3, atlas.atlas_height);
-			Color cursor_color = theme.foreground;
-			cursor_color.a = sd.cursor.alpha;
-			renderQuad(r, cursor_quad, cursor_color);
+static void renderStatusLine(Renderer* r, const EditorView *v, ColorTheme theme) {
+	const AppContext *ctx = &v->ctx;
+	GlyphAtlas *atlas = &r->font_atlases[ctx->font_id];
+
+	// Work out the text first, it is the cache key
+	char name[sizeof(v->file_name) + 32] = "";
+	char doc_perc_txt[8] = "";
+	if (v->mode == EDITOR_MODE_NORMAL || v->mode == EDITOR_MODE_SAVE) {
+		if (v->load_progress >= 0.0f) {
+			snprintf(name, sizeof(name), "%s  loading %d%%", v->file_name, (i32)(v->load_progress * 100.0f));
+		} else {
+			snprintf(name, sizeof(name), "%s", v->file_name);
+		}
 
-			// render text in dialog input box
-			char *text = getBufString(sd.buf);
-			renderText(r, text, &sd.text_pos, &atlas, theme.foreground);
+		f32 per = (v->scroll_pos.y / (((v->line_count + 2) * ctx->line_height) - r->screen_height)) * 100.0;
+		if ((v->line_count * ctx->line_height) < r->screen_height) {
+			strcpy(doc_perc_txt, "All");
+		} else if (per < 1.0) {
+			strcpy(doc_perc_txt, "Top");
+		} else if (per >= 100.0) {
+			strcpy(doc_perc_txt, "Bot");
 		} else {
-			// Render cursor
-			rect cursor_quad = rect_init(e->cursor.screen_pos.x, e->cursor.screen_pos.y, 3, atlas.atlas_height);
+			sprintf(doc_perc_txt, "%d%c", (i32)per, '%');
+		}
+	} else if (v->mode == EDITOR_MODE_OPEN) {
+		strcpy(name, "browser");
+	}
+	
+	char col_row_disp[24];
+	sprintf(col_row_disp, "%lu,%lu", v->cursor.disp_row, v->cursor.disp_column);
+
+	u64 key = fnv1a(FNV_OFFSET_BASIS, name, sizeof(name));
+	key = fnv1a(key, doc_perc_txt, sizeof(doc_perc_txt));
+	key = fnv1a(key, col_row_disp, sizeof(col_row_disp));
+	key = hashFontState(key, r, ctx);
+	key = fnv1a(key, &theme, sizeof(theme));
+
+	if (rendererBeginCache(r, &r->status_cache, key, rect_init(0, 0, r->screen_width, ctx->line_height * 2))) {
+		renderQuad(r, rect_init(0, ctx->line_height, r->screen_width, ctx->line_height), theme.gutter_foreground);
+		renderQuad(r, rect_init(0, 0, r->screen_width, ctx->line_height), theme.background);
+
+		vec2 mode_text_pos = vec2_init(r->glyph_adv * 2.0, ctx->line_height + r->descender);
+		renderText(r, name, &mode_text_pos, atlas, theme.foreground);
+
+		vec2 doc_perc_pos = vec2_init(r->screen_width - (4 * r->glyph_adv), ctx->line_height + r->descender);
+		renderText(r, doc_perc_txt, &doc_perc_pos, atlas, theme.foreground);
+
+		vec2 col_row_disp_pos = vec2_init(r->screen_width - (strlen(col_row_disp) * r->glyph_adv) - (r->glyph_adv * 6), ctx->line_height + r->descender);
+		renderText(r, col_row_disp, &col_row_disp_pos, atlas, theme.foreground);
+		rendererEndCache(r, &r->status_cache);
+	}
+	rendererDrawCache(r, &r->status_cache);
+}
+
+// One pane, clipped to its frame. Only the focused pane shows its cursor,
+// the browser and the current line.
+static void renderPane(Renderer* r, const EditorView *v, RenderLayer *layer, bool focused, ColorTheme theme) {
+	const AppContext *ctx = &v->ctx;
+	GlyphAtlas *atlas = &r->font_atlases[ctx->font_id];
+	rendererSetClip(r, v->frame);
+
+	renderQuad(r, v->frame, theme.background);
+	
+	if (v->mode != EDITOR_MODE_OPEN) {
+		// Render line highlight
+		if (v->mode == EDITOR_MODE_NORMAL && focused) {
+			renderQuad(r, rect_init(v->frame.x, v->cursor.screen_pos.y, v->frame.w, atlas->line_height), theme.current_line);
+		}
+
+		// Text is only rebuilt when it changes (or scrolls past what the layer
+		// covers), smooth scrolling just moves the layer. It isn't put in a
+		// RenderCache: compositing the whole text area costs more fill than
+		// drawing the retained glyphs again. Every pane has its own layer of
+		// just its lines, built from the same snapshot and shaped runs.
+		if (rendererBeginLayer(r, layer, textLayerKey(r, v), v->frame, v->scroll_pos, v->target_scroll_pos)) {
+			renderEditorText(r, v, layer->origin);
+			rendererEndLayer(r, layer);
+		}
+
+		rendererDrawLayer(r, layer, v->scroll_pos);
+
+		// Render cursor
+		if (v->mode == EDITOR_MODE_NORMAL && focused) {
+			rect cursor_quad = rect_init(v->cursor.screen_pos.x, v->cursor.screen_pos.y, 3, atlas->line_height);
 			Color cursor_color = theme.foreground;
-			cursor_color.a = e->cursor.alpha;
+			cursor_color.a = v->cursor.alpha;
 			renderQuad(r, cursor_quad, cursor_color);
 		}
 
 	} else {
-		vec2 init_text_pos = vec2_init(e->text_pos.x, e->text_pos.y - ctx->line_height);
-		vec2 adj_text_pos = init_text_pos;
-		Cursor selection = e->browser.cursor;
+		vec2 text_pos = vec2_init(v->text_pos.x, v->text_pos.y - ctx->line_height);
+		Cursor selection = v->browser_cursor;
 		// Render selection highlight
 		rect selection_highlight = rect_init(selection.screen_pos.x, selection.screen_pos.y, selection.width, ctx->line_height);
 		renderQuad(r, selection_highlight, theme.user_selection);
 
-		for (size_t i = 0; i < e->browser.num_paths; i++){
-			if (e->browser.items[i].is_dir) {
-				char *dir_with_slash = (char *)malloc(strlen(e->browser.items[i].name_ext) + 2);
-				strcpy(dir_with_slash, e->browser.items[i].name_ext);
-				strcat(dir_with_slash, "/");
-				renderText(r, dir_with_slash, &adj_text_pos, &atlas, theme.foreground);
-				free(dir_with_slash);
-			} else {
-				renderText(r, e->browser.items[i].name_ext, &adj_text_pos, &atlas, theme.foreground);
-			}
-			renderText(r, "\n", &adj_text_pos, &atlas, theme.foreground);
-			adj_text_pos.x = init_text_pos.x;
-		}
+		renderText(r, v->browser_text, &text_pos, atlas, theme.foreground);
 	}
 
 	// gutter	
 	// render divider
-	renderQuad(r, rect_init(e->gutter.gutter_width + r->glyph_adv, 0, 1, r->screen_height), theme.gutter_foreground);
+	renderQuad(r, rect_init(v->frame.x + v->gutter.gutter_width + r->glyph_adv, v->frame.y, 1, v->frame.h), theme.gutter_foreground);
 	
-	vec2 gutter_text_pos = vec2_init(0, e->frame.y + e->frame.h - ctx->line_height);
-	gutter_text_pos.x = r->glyph_adv;
-	if (e->mode != EDITOR_MODE_OPEN) {
-		gutter_text_pos = vec2_add(gutter_text_pos, e->scroll_pos);
-		i32 cur_line = e->cursor.disp_row;
-		for (i32 i = 1; i <= (i32)e->line_count; ++i) {
-			char num[11];
-			i32 gutter_digit_padding = MAX(e->gutter.digits, 2);
-			sprintf(num, "%*d", gutter_digit_padding, i);
-			renderText(r, num, &gutter_text_pos, &atlas, cur_line == i ? theme.user_selection : theme.gutter_foreground);
-			gutter_text_pos.x = r->glyph_adv;
-			gutter_text_pos.y -= ctx->line_height;
-		}
-	} else {
-		gutter_text_pos = vec2_add(gutter_text_pos, e->browser.scroll_pos);
-		for (size_t i = 0; i < e->browser.num_paths; i++) {
+	// (line numbers are part of the text layer)
+	if (v->mode == EDITOR_MODE_OPEN) {
+		f32 gutter_x = v->frame.x + r->glyph_adv;
+		vec2 gutter_text_pos = vec2_init(gutter_x, v->frame.y + v->frame.h - ctx->line_height);
+		gutter_text_pos = vec2_add(gutter_text_pos, v->browser_scroll_pos);
+		for (size_t i = 0; i < v->browser_count; i++) {
 			char num[4];
 			sprintf(num, "%3s", "~");
-			renderText(r, num, &gutter_text_pos, &atlas, theme.gutter_foreground);
-			gutter_text_pos.x = r->glyph_adv;
+			renderText(r, num, &gutter_text_pos, atlas, theme.gutter_foreground);
+			gutter_text_pos.x = gutter_x;
 			gutter_text_pos.y -= ctx->line_height;
 		}
 	}
 
-	// Status line
-	renderQuad(r, rect_init(0, ctx->line_height, r->screen_width, ctx->line_height), theme.gutter_foreground);
+	rendererResetClip(r);
+}
 
-	renderQuad(r, rect_init(0, 0, r->screen_width, ctx->line_height), theme.background);
-	vec2 mode_text_pos = vec2_init(r->glyph_adv * 2.0, ctx->line_height + r->descender);
-	if (e->mode == EDITOR_MODE_NORMAL || e->mode == EDITOR_MODE_SAVE) {
-		if (e->file_path) {
-			char *name = get_filename_from_path(e->file_path);
-			if (name) {
-				renderText(r, name, &mode_text_pos, &atlas, theme.foreground);
-				free(name);
-			} else {
-				renderText(r, "(null)", &mode_text_pos, &atlas, theme.foreground);
-			}
-		} else {
-			renderText(r, "(null)", &mode_text_pos, &atlas, theme.foreground);
-		}
+void renderEditor(Renderer* r, const EditorView *views, u32 view_count, u32 focused, ColorTheme theme) {
+	rendererSetTheme(r, &theme);
 
-		f32 per = (e->scroll_pos.y / (((e->line_count + 2) * ctx->line_height) - r->screen_height)) * 100.0;
-		vec2 doc_perc_pos = vec2_init(r->screen_width - (4 * r->glyph_adv), ctx->line_height + r->descender);
-		if ((e->line_count * ctx->line_height) < r->screen_height) {
-			renderText(r, "All", &doc_perc_pos, &atlas, theme.foreground);
-		} else {
-			if (per < 1.0) {
-				renderText(r, "Top", &doc_perc_pos, &atlas, theme.foreground);
-			} else if (per >= 100.0) {
-				renderText(r, "Bot", &doc_perc_pos, &atlas, theme.foreground);
-			} else {
-				char doc_perc_txt[4];
-				sprintf(doc_perc_txt, "%d%c", (i32)per, '%');
-				renderText(r, doc_perc_txt, &doc_perc_pos, &atlas, theme.foreground);
-			}
+	for (u32 i = 0; i < view_count; i++) {
+		renderPane(r, &views[i], &r->text_layers[i], i == focused, theme);
+	}
+
+	// Borders on the left and top of the panes that have a neighbor there
+	for (u32 i = 0; i < view_count; i++) {
+		rect frame = views[i].frame;
+		if (frame.x > 0) {
+			renderQuad(r, rect_init(frame.x, frame.y, 1, frame.h), theme.gutter_foreground);
+		}
+		if (frame.y + frame.h < r->screen_height) {
+			renderQuad(r, rect_init(frame.x, frame.y + frame.h - 1, frame.w, 1), theme.gutter_foreground);
 		}
-	} else if (e->mode == EDITOR_MODE_OPEN) {
-		renderText(r, "browser", &mode_text_pos, &atlas, theme.foreground);
 	}
-	
-	char col_row_disp[24];
-	sprintf(col_row_disp, "%lu,%lu", e->cursor.disp_row, e->cursor.disp_column);
-	vec2 col_row_disp_pos = vec2_init(r->screen_width - (strlen(col_row_disp) * r->glyph_adv) - (r->glyph_adv * 6), ctx->line_height + r->descender);
-	renderText(r, col_row_disp, &col_row_disp_pos, &atlas, theme.foreground);
+
+	// The dialog and the status line go over every pane
+	const EditorView *v = &views[focused];
+	if (v->mode == EDITOR_MODE_SAVE) {
+		renderSaveDialog(r, v, theme);
+	}
+	renderStatusLine(r, v, theme);
 }
 
 u32 rendererLoadFont(Renderer *r, const char *path, u32 size_px) {
+	// Reuse a loaded atlas if we can. SDF atlases are size independent, so a
+	// font size change only rescales them.
+	for (u32 i = 0; i < r->font_atlas_count; i++) {
+		GlyphAtlas *atlas = &r->font_atlases[i];
+		if (!atlas->face || atlas->format != r->font_format || strcmp(atlas->font_path, path) != 0) {
+			continue;
+		}
+		if (atlas->format == GLYPH_ATLAS_SDF || atlas->size_px == size_px) {
+			rendererSetFontSize(r, i, size_px);
+			return i;
+		}
+	}
+
+	// Find a free slot
+	u32 font_id = r->font_atlas_count;
+	for (u32 i = 0; i < r->font_atlas_count; i++) {
+		if (!r->font_atlases[i].face) {
+			font_id = i;
+			break;
+		}
+	}
+	if (font_id >= MAX_FONT_ATLASES) {
+		LOG_ERROR("Cannot load font %s: all %d font slots are in use", path, MAX_FONT_ATLASES);
+		exit(1);
+	}
+
 	// Load a face
 	FT_Face face;
 	if(FT_New_Face(r->ft, path, 0, &face)) {
@@ -667,16 +1389,42 @@ u32 rendererLoadFont(Renderer *r, const char *path, u32 size_px) {
 		exit(1);
 	}
 
-	// Set the size of the font in pixels
-	FT_Set_Pixel_Sizes(face, 0, size_px);
+	// Set the size of the font in pixels. SDF glyphs are rasterized once at
+	// a fixed size and scaled when drawn.
+	u32 raster_size = r->font_format == GLYPH_ATLAS_SDF ? GLYPH_SDF_BASE_SIZE : size_px;
+	FT_Set_Pixel_Sizes(face, 0, raster_size);
 
-	//Make the atlas
-	GlyphAtlas atlas;
-	glyphAtlasInit(&atlas, face, &r->glyph_adv, &r->descender);
+	//Make the atlas in place, glyphs are added to it as they are first drawn
+	GlyphAtlas *atlas = &r->font_atlases[font_id];
+	glyphAtlasInit(atlas, face, r->font_format, path, raster_size, &r->textures, &r->glyph_adv, &r->descender);
 
-	//Store atlas
-	u32 font_id = r->font_atlas_count;
-	r->font_atlases[r->font_atlas_count] = atlas;
-	r->font_atlas_count++;
+	if (font_id == r->font_atlas_count) {
+		r->font_atlas_count++;
+	}
+	rendererSetFontSize(r, font_id, size_px);
 	return font_id;
 }
+
+void rendererReleaseFont(Renderer *r, u32 font_id) {
+	GlyphAtlas *atlas = &r->font_atlases[font_id];
+	if (!atlas->face) {
+		return;
+	}
+	shaperReleaseFont(&r->shaper, font_id);
+	glyphAtlasDestroy(atlas);
+	atlas->font_path = NULL;
+	atlas->face = NULL;
+}
+
+void rendererSetFontSize(Renderer *r, u32 font_id, u32 size_px) {
+	GlyphAtlas *atlas = &r->font_atlases[font_id];
+	glyphAtlasSetScale(atlas, (f32)size_px / (f32)atlas->size_px);
+	r->font_generation++;
+	r->glyph_adv = atlas->glyph_adv * atlas->scale;
+	r->descender = atlas->descender * atlas->scale;
+
+	if (atlas->format == GLYPH_ATLAS_SDF) {
+		glUseProgram(r->sdf_shader);
+		glUniform1f(glGetUniformLocation(r->sdf_shader, "u_sdf_scale"), atlas->scale);
+	}
+}
@@ -1,29 +1,97 @@
 #pragma once
 #include "util.h"
 #include "font.h"
-#include "editor.h"
+#include "texarray.h"
+#include "softrender.h"
+#include "workers.h"
+#include "shaper.h"
+#include "view.h"
 
 #define INITIAL_SCREEN_WIDTH 1080
 #define INITIAL_SCREEN_HEIGHT 720
 
 
-#define MAX_QUADS 1024
+#define MAX_QUADS 8192
 #define MAX_VERTICES MAX_QUADS * 4
-#define MAX_INDICES MAX_VERTICES * 6
+#define MAX_INDICES MAX_QUADS * 6
 
+// Packed to 16 bytes since the whole batch is re-uploaded every frame.
+// Positions are whole pixels and UVs are texels, so both fit in 16 bits.
 typedef struct {
-	vec2 pos;
-	Color color;
-	vec2 uv;
-	float tex_index;
+	i16 x, y;
+	u16 u, v;
+	u8 color[4];    // RGBA, normalized in the shader
+	u8 layer;       // layer of the renderer's texture array
+	u8 palette;     // THEME_PALETTE of the color, which color then tints. 0 for none
+	u8 padding[2];
 } Render_Vertex;
 
+// Retained geometry refers to theme colors by index into the ColorTheme, which
+// is uploaded as a uniform buffer, so a new theme doesn't rebuild it.
+#define PALETTE_BINDING 0
+#define PALETTE_SIZE 16
+#define THEME_PALETTE(field) ((u8)(1 + offsetof(ColorTheme, field) / sizeof(Color)))
+_Static_assert(sizeof(ColorTheme) == PALETTE_SIZE * sizeof(Color), "ColorTheme must be an array of colors for the palette");
+
+typedef enum {
+	RENDER_BACKEND_GL,       // quads are batched and drawn by OpenGL
+	RENDER_BACKEND_SOFTWARE  // quads are rasterized on the CPU, GL only presents
+} RenderBackend;
+
+// Per-frame batch statistics, reset by rendererBegin.
+typedef struct {
+	u32 quads;
+	u32 draw_calls;
+	u32 flushes;
+	u64 bytes_uploaded;
+	u32 shaped_runs; // runs of text that missed the shape cache
+} RenderStats;
+
+// How far (in screen heights) a layer may be recorded past the screen.
+#define LAYER_MAX_REACH 2.0f
+
+// Geometry recorded once and drawn again on later frames with a translation
+// uniform, so scrolling moves it without rebuilding or re-uploading it.
+// Recording culls against the area the screen sweeps over on its way to the
+// target translation; the layer stays usable while the screen is inside it.
+typedef struct {
+	u32 vao;
+	u32 vbo;
+	Render_Vertex *vertices;
+	u32 vert_count;
+	u32 capacity;     // vertices allocated on the cpu
+	u32 gpu_capacity; // vertices allocated in the vbo
+
+	vec2 origin;      // translation the layer was recorded at
+	f32 min_offset;   // vertical offsets from origin the recording covers
+	f32 max_offset;
+	u64 key;          // hash of everything the contents depend on
+	bool valid;
+} RenderLayer;
+
+// A region of the screen drawn once into a texture and composited with a
+// single quad on later frames, until its key (or area) changes. Contents are
+// stored with premultiplied alpha so they blend like drawing them directly.
+typedef struct {
+	u32 fbo;
+	u32 texture;
+	u32 width;
+	u32 height;
+	rect area;
+	u64 key;
+	bool valid;
+	i32 prev_fbo; // framebuffer to go back to after rendering into the cache
+} RenderCache;
+
 typedef struct {
 	// The required OpenGL objects
 	u32 vao;
 	u32 vbo;
 	u32 ibo;
 	u32 shader;
+	u32 sdf_shader;
+	u32 composite_shader;
+	u32 palette_ubo;
 	
 	mat4 projection;
 	
@@ -32,19 +100,46 @@ typedef struct {
 	u32 vert_count;
 	u32 indices_count;
 	
-	// Texture stuff
-	u32 textures[8];
-	u32 texture_count;
+	// Every texture the batch can sample (glyph atlases and the white
+	// texture) is a layer of this array, so textures never force a flush.
+	TextureArray textures;
+	u32 white_layer;
+
+	// Theme the palette buffer holds
+	ColorTheme theme;
 
 	// Misc
 	Color clear_color;
+	RenderStats stats;
+
+	RenderBackend backend;
+	SoftRenderer soft;
+
+	// Editor text is shaped in runs when set (fonts with ligatures), see Shaper
+	bool ligatures;
+	Shaper shaper;
+
+	// Quads entirely outside this area are dropped
+	rect cull;
+
+	// Set while a layer is being recorded, quads go there instead of the batch
+	RenderLayer *recording;
+
+	// Scrolling text of the editor, one per pane
+	RenderLayer text_layers[MAX_PANES];
+
+	// Parts of the editor that rarely change, composited from textures
+	RenderCache status_cache;
+	RenderCache dialog_cache;
 
 	// Fonts
 	FT_Library ft;
-	GlyphAtlas font_atlases[8];
+	GlyphAtlas font_atlases[MAX_FONT_ATLASES];
 	u32 font_atlas_count;
+	GlyphAtlasFormat font_format; // format used for newly loaded fonts (and picks the shader)
 	f32 glyph_adv;
 	f32 descender;
+	u64 font_generation; // bumped whenever a font is loaded or resized
 
 	// Screen size info
 	f32 screen_width;
@@ -58,17 +153,60 @@ void rendererBegin(Renderer* r);
 void rendererEnd(Renderer* r);
 void rendererResizeWindow (Renderer* r, i32 width, i32 height);
 
+// Uploads the theme palette vertices index into, when it changed. Called by
+// renderEditor with the theme it draws, so fading between themes is cheap.
+void rendererSetTheme(Renderer* r, const ColorTheme *theme);
+
+// Switches between GPU rendering and the CPU rasterizer. The software backend
+// only samples bitmap atlases, load fonts with GLYPH_ATLAS_BITMAP for it.
+void rendererSetBackend(Renderer* r, RenderBackend backend);
+
+// Shapes the editor's text with HarfBuzz so ligatures are drawn. Stays off
+// (with a warning) when built without HarfBuzz.
+void rendererSetLigatures(Renderer* r, bool enabled);
+
+// Starts recording into the layer unless what it holds is still usable for
+// this key and translation. Returns false (and records nothing) when it is,
+// otherwise quads go into the layer until rendererEndLayer.
+// target is where the translation is heading (the end of a scroll animation),
+// area is the part of the screen the layer is drawn in.
+bool rendererBeginLayer(Renderer* r, RenderLayer *layer, u64 key, rect area, vec2 translation, vec2 target);
+void rendererEndLayer(Renderer* r, RenderLayer *layer);
+
+// Draws the layer moved by translation. Quads batched so far are drawn first
+// to keep the order they were submitted in.
+void rendererDrawLayer(Renderer* r, RenderLayer *layer, vec2 translation);
+void rendererDestroyLayer(RenderLayer *layer);
+
+// Starts drawing into the cache when its contents are stale for this key and
+// area, until rendererEndCache. Returns false when the cached texture is reused.
+bool rendererBeginCache(Renderer* r, RenderCache *cache, u64 key, rect area);
+void rendererEndCache(Renderer* r, RenderCache *cache);
+
+// Composites the cache over what has been drawn so far.
+void rendererDrawCache(Renderer* r, RenderCache *cache);
+void rendererDestroyCache(RenderCache *cache);
+
+// Only the area is drawn to until rendererResetClip. Not for use around caches.
+void rendererSetClip(Renderer* r, rect area);
+void rendererResetClip(Renderer* r);
+
 void renderTriangle(Renderer* r,
 						  vec2 a, vec2 b, vec2 c,
 						  Color a_color, Color b_color, Color c_color,
 						  vec2 a_uv, vec2 b_uv, vec2 c_uv,
 						  u32 texture);
 
-u32  rendererGetWhiteTexture();
 void renderQuad(Renderer* r, rect quad, Color color);
-void renderTexturedQuad(Renderer* r, rect quad, Color tint, u32 texture);
-void renderChar(Renderer* r, char character, vec2 *pos, GlyphAtlas *atlas, Color tint);
+void renderTexturedQuad(Renderer* r, rect quad, Color tint, u32 layer, vec2 texture_size);
+void renderChar(Renderer* r, u32 codepoint, vec2 *pos, GlyphAtlas *atlas, Color tint);
 void renderText(Renderer* r, char *text, vec2 *pos, GlyphAtlas *atlas, Color tint);
-void renderEditor(Renderer* r, Editor *e, AppContext *ctx,f32 delta_time, ColorTheme theme);
+// Draws the panes of the editor from their views, with the status line of the
+// focused one.
+void renderEditor(Renderer* r, const EditorView *views, u32 view_count, u32 focused, ColorTheme theme);
+
+u32 rendererLoadFont(Renderer *r, const char *path, u32 size_px);
+void rendererReleaseFont(Renderer *r, u32 font_id);
 
-u32 rendererLoadFont(Renderer *r, const char *path, u32 size_px);
\ No newline at end of file
+// Changes the drawn size of a font. For SDF fonts this is just a scale, no glyphs are re-rasterized.
+void rendererSetFontSize(Renderer *r, u32 font_id, u32 size_px);
\ No newline at end of file
@@ -0,0 +1,75 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include "renderthread.h"
+
+static void *renderThreadMain(void *arg) {
+	RenderThread *t = (RenderThread *)arg;
+	t->init(t->user);
+
+	for (;;) {
+		sem_wait(&t->wake);
+		if (atomic_load(&t->quit)) {
+			break;
+		}
+
+		RenderCallFn call = atomic_load(&t->call);
+		if (call) {
+			call(t->call_arg);
+			atomic_store(&t->call, NULL);
+
+			// Whatever is waiting was built before the call
+			atomic_fetch_and(&t->middle, ~RENDER_SLOT_FRESH);
+			sem_post(&t->done);
+			continue;
+		}
+
+		if (atomic_load(&t->middle) & RENDER_SLOT_FRESH) {
+			t->front = atomic_exchange(&t->middle, t->front) & ~RENDER_SLOT_FRESH;
+			t->render(t->user, t->front);
+		}
+	}
+	return NULL;
+}
+
+void renderThreadStart(RenderThread *t, RenderCallFn init, RenderFn render, void *user) {
+	t->back = 0;
+	atomic_init(&t->middle, 1);
+	t->front = 2;
+	t->init = init;
+	t->render = render;
+	t->user = user;
+	atomic_init(&t->call, NULL);
+	t->call_arg = NULL;
+	atomic_init(&t->quit, false);
+	sem_init(&t->wake, 0, 0);
+	sem_init(&t->done, 0, 0);
+
+	if (pthread_create(&t->thread, NULL, renderThreadMain, t) != 0) {
+		LOG_ERROR("Failed to start the render thread.", "");
+		exit(1);
+	}
+}
+
+void renderThreadStop(RenderThread *t) {
+	atomic_store(&t->quit, true);
+	sem_post(&t->wake);
+	pthread_join(t->thread, NULL);
+	sem_destroy(&t->wake);
+	sem_destroy(&t->done);
+}
+
+u32 renderThreadBackSlot(const RenderThread *t) {
+	return t->back;
+}
+
+void renderThreadPublish(RenderThread *t) {
+	t->back = atomic_exchange(&t->middle, t->back | RENDER_SLOT_FRESH) & ~RENDER_SLOT_FRESH;
+	sem_post(&t->wake);
+}
+
+void renderThreadCall(RenderThread *t, RenderCallFn fn, void *arg) {
+	t->call_arg = arg;
+	atomic_store(&t->call, fn);
+	sem_post(&t->wake);
+	sem_wait(&t->done);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "util.h"
+
+// Frames between the two threads: one being written, one being drawn and the
+// newest finished one waiting between them.
+#define RENDER_THREAD_SLOTS 3
+
+// Set on the waiting slot while it holds a frame that hasn't been drawn.
+#define RENDER_SLOT_FRESH 0x4u
+
+typedef void (*RenderFn)(void *user, u32 slot);
+typedef void (*RenderCallFn)(void *arg);
+
+// A thread that owns the GL context and draws the frames the editor thread
+// publishes, so input is handled while a frame renders or waits on the swap.
+// Frames are handed over through a triple buffer of slots the caller keeps:
+// the editor writes the back slot and publishing swaps it with the waiting
+// one, the render thread swaps the waiting slot with the one it drew when it
+// is fresh. Only slot indices are exchanged, atomically, so neither thread
+// ever waits for the other. Frames published faster than they're drawn are
+// skipped, the newest one always wins.
+typedef struct {
+	pthread_t thread;
+	sem_t wake; // posted for every publish and call, lets the thread sleep
+	sem_t done; // posted when a call has run
+
+	u32 back;           // slot the editor thread writes
+	u32 front;          // slot the render thread draws
+	atomic_uint middle; // slot between them, with RENDER_SLOT_FRESH
+
+	RenderCallFn init;
+	RenderFn render;
+	void *user;
+
+	// Set by renderThreadCall, call is stored last so call_arg is seen with it
+	_Atomic(RenderCallFn) call;
+	void *call_arg;
+	atomic_bool quit;
+} RenderThread;
+
+// Starts the thread. init(user) runs on it first (to make the GL context
+// current there), then render(user, slot) for every frame that gets drawn.
+void renderThreadStart(RenderThread *t, RenderCallFn init, RenderFn render, void *user);
+void renderThreadStop(RenderThread *t);
+
+// Slot the next frame goes into. It belongs to the editor thread until published.
+u32 renderThreadBackSlot(const RenderThread *t);
+void renderThreadPublish(RenderThread *t);
+
+// Runs fn(arg) on the render thread between frames and waits for it, for the
+// GL work of the editor thread (loading fonts, switching backends). Frames
+// published before the call aren't drawn, they may refer to what fn changed.
+void renderThreadCall(RenderThread *t, RenderCallFn fn, void *arg);
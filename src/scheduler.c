@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+void schedulerInit(Scheduler *s) {
+    s->task_count = 0;
+    s->task_capacity = 8;
+    s->tasks = (Task *)malloc(s->task_capacity * sizeof(Task));
+    s->next = 0;
+    s->last_time = 0.0;
+}
+
+void schedulerDestroy(Scheduler *s) {
+    free(s->tasks);
+    s->tasks = NULL;
+    s->task_count = 0;
+}
+
+void schedulerAdd(Scheduler *s, TaskStepFn step, void *arg) {
+    for (u32 i = 0; i < s->task_count; i++) {
+        if (s->tasks[i].step == step && s->tasks[i].arg == arg) {
+            return;
+        }
+    }
+
+    if (s->task_count >= s->task_capacity) {
+        s->task_capacity *= 2;
+        s->tasks = (Task *)realloc(s->tasks, s->task_capacity * sizeof(Task));
+    }
+    s->tasks[s->task_count++] = (Task) { step, arg };
+}
+
+static void removeTask(Scheduler *s, u32 index) {
+    memmove(&s->tasks[index], &s->tasks[index + 1], (s->task_count - index - 1) * sizeof(Task));
+    s->task_count--;
+    if (s->next > index) {
+        s->next--;
+    }
+}
+
+void schedulerCancel(Scheduler *s, void *arg) {
+    for (u32 i = s->task_count; i > 0; i--) {
+        if (s->tasks[i - 1].arg == arg) {
+            removeTask(s, i - 1);
+        }
+    }
+}
+
+void schedulerRun(Scheduler *s, f64 deadline) {
+    f64 start = getTimeSeconds();
+    f64 now = start;
+    while (s->task_count > 0 && now < deadline) {
+        if (s->next >= s->task_count) {
+            s->next = 0;
+        }
+
+        u32 index = s->next;
+        Task task = s->tasks[index];
+        if (task.step(task.arg, MIN(deadline, now + SCHEDULER_SLICE))) {
+            removeTask(s, index);
+        } else {
+            s->next++;
+        }
+        now = getTimeSeconds();
+    }
+    s->last_time = now - start;
+}
+
+u32 schedulerQueueDepth(const Scheduler *s) {
+    return s->task_count;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "util.h"
+
+// Longest a single step may run before another task gets its turn.
+#define SCHEDULER_SLICE 0.001
+
+// Does some of a task's work, returning before the deadline (getTimeSeconds)
+// if it can. Returns true once the task is done.
+typedef bool (*TaskStepFn)(void *arg, f64 deadline);
+
+typedef struct {
+    TaskStepFn step;
+    void *arg;
+} Task;
+
+// Runs resumable tasks on the editor thread within a time budget, so long
+// operations are spread over frames instead of dropping them. Tasks take
+// turns in slices, in the order they were added.
+typedef struct {
+    Task *tasks;
+    u32 task_count;
+    u32 task_capacity;
+    u32 next;
+
+    // Time the tasks ran in the last schedulerRun
+    f64 last_time;
+} Scheduler;
+
+void schedulerInit(Scheduler *s);
+void schedulerDestroy(Scheduler *s);
+
+// Does nothing if the same step is already queued for arg.
+void schedulerAdd(Scheduler *s, TaskStepFn step, void *arg);
+
+// Drops the tasks working on arg, for when arg goes away.
+void schedulerCancel(Scheduler *s, void *arg);
+
+// Runs tasks until they are all done or the deadline passed.
+void schedulerRun(Scheduler *s, f64 deadline);
+u32 schedulerQueueDepth(const Scheduler *s);
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "shader.h"
+
+// A cache file holds the header followed by the program binary.
+#define PROGRAM_CACHE_MAGIC 0x47525050u // "PPRG"
+#define PROGRAM_CACHE_VERSION 1
+
+typedef struct {
+	u32 magic;
+	u32 version;
+	u64 key;
+	u32 format;
+	u32 length;
+} ProgramCacheHeader;
+
+static bool programBinariesSupported() {
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+		return false;
+	}
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+// Binaries only load on the driver build that produced them, so it's part of the key.
+static u64 programKey(const char *vert_source, const char *frag_source) {
+	const char *strings[] = {
+		(const char *)glGetString(GL_VENDOR),
+		(const char *)glGetString(GL_RENDERER),
+		(const char *)glGetString(GL_VERSION),
+		vert_source,
+		frag_source
+	};
+	u64 key = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+		const char *s = strings[i] ? strings[i] : "";
+		key = fnv1a(key, s, strlen(s) + 1);
+	}
+	return key;
+}
+
+static bool loadProgramBinary(u32 program, const char *cache_path, u64 key) {
+	FILE *fp = fopen(cache_path, "rb");
+	if (!fp) {
+		return false;
+	}
+
+	ProgramCacheHeader header;
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1
+		&& header.magic == PROGRAM_CACHE_MAGIC
+		&& header.version == PROGRAM_CACHE_VERSION
+		&& header.key == key
+		&& header.length > 0;
+
+	u8 *binary = NULL;
+	if (ok) {
+		binary = (u8 *)malloc(header.length);
+		ok = fread(binary, 1, header.length, fp) == header.length;
+	}
+	fclose(fp);
+
+	// The driver may still refuse it (an update that kept the version string)
+	GLint linked = GL_FALSE;
+	if (ok) {
+		glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	free(binary);
+	return linked == GL_TRUE;
+}
+
+// Writes to a temporary file first so a crash never leaves a torn cache behind.
+static void saveProgramBinary(u32 program, const char *cache_path, u64 key) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	ProgramCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+
+	u8 *binary = (u8 *)malloc((size_t)length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, binary);
+	header.format = format;
+	header.length = (u32)written;
+
+	size_t tmp_length = strlen(cache_path) + 5;
+	char *tmp_path = (char *)malloc(tmp_length);
+	snprintf(tmp_path, tmp_length, "%s.tmp", cache_path);
+
+	FILE *fp = fopen(tmp_path, "wb");
+	bool ok = fp && written > 0;
+	if (fp) {
+		ok = ok
+			&& fwrite(&header, sizeof(header), 1, fp) == 1
+			&& fwrite(binary, 1, header.length, fp) == header.length;
+		ok = fclose(fp) == 0 && ok;
+	}
+
+	if (!ok || rename(tmp_path, cache_path) != 0) {
+		LOG_DEBUG("Could not write program cache %s", cache_path);
+		remove(tmp_path);
+	}
+	free(tmp_path);
+	free(binary);
+}
+
+static u32 compileShader(GLenum type, const char *name, const char *source) {
+	u32 module = glCreateShader(type);
+	GLint length = (GLint)strlen(source);
+	glShaderSource(module, 1, (const GLchar *const *)&source, &length);
+	glCompileShader(module);
+
+	i32 status;
+	glGetShaderiv(module, GL_COMPILE_STATUS, &status);
+	if (status == GL_FALSE) {
+		printf("%s Shader Compilation failed (%s)!", type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", name);
+		i32 info_length = 0;
+		glGetShaderiv(module, GL_INFO_LOG_LENGTH, &info_length);
+
+		GLchar *info = (GLchar *)malloc(info_length * sizeof(GLchar));
+		glGetShaderInfoLog(module, info_length * sizeof(GLchar), NULL, info);
+		printf("%s", info);
+		free(info);
+	}
+	return module;
+}
+
+u32 shaderProgramCreate(const char *name, const char *vert_source, const char *frag_source) {
+	u32 program = glCreateProgram();
+
+	u64 key = 0;
+	char *cache_path = NULL;
+	if (programBinariesSupported()) {
+		key = programKey(vert_source, frag_source);
+		char file_name[32];
+		snprintf(file_name, sizeof(file_name), "%016llx.program", (unsigned long long)key);
+		cache_path = getCachePath(file_name);
+		if (cache_path && loadProgramBinary(program, cache_path, key)) {
+			free(cache_path);
+			return program;
+		}
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	u32 vert_module = compileShader(GL_VERTEX_SHADER, name, vert_source);
+	u32 frag_module = compileShader(GL_FRAGMENT_SHADER, name, frag_source);
+	glAttachShader(program, vert_module);
+	glAttachShader(program, frag_module);
+
+	i32 linked;
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE) {
+		printf("Program Linking Failed (%s):\n", name);
+		i32 length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+
+		GLchar *info = (GLchar *)malloc(length * sizeof(GLchar));
+		glGetProgramInfoLog(program, length, NULL, info);
+		printf("%s", info);
+		free(info);
+	}
+
+	glDetachShader(program, vert_module);
+	glDetachShader(program, frag_module);
+	glDeleteShader(vert_module);
+	glDeleteShader(frag_module);
+
+	if (linked == GL_TRUE && cache_path) {
+		saveProgramBinary(program, cache_path, key);
+	}
+	free(cache_path);
+	return program;
+}
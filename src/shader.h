@@ -0,0 +1,14 @@
+#pragma once
+#include "util.h"
+
+// Sources of shaders/, compiled into the binary by the Makefile
+// (build/shader_sources.c), so the editor runs from any directory.
+extern const char shader_glyph_vert[];
+extern const char shader_glyph_frag[];
+extern const char shader_glyph_sdf_frag[];
+extern const char shader_composite_frag[];
+
+// Compiles and links a program, name is only used in error messages. When the
+// driver can hand out program binaries the linked program is cached on disk,
+// keyed by the driver and the sources, and later launches skip compiling.
+u32 shaderProgramCreate(const char *name, const char *vert_source, const char *frag_source);
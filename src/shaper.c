@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include "shaper.h"
+
+#ifdef MYTE_HARFBUZZ
+#include <hb.h>
+#include <hb-ft.h>
+#endif
+
+#define SHAPER_INITIAL_RUNS 256
+#define SHAPER_INITIAL_GLYPHS 1024
+
+// 0 marks empty slots
+static u64 slotKey(u64 key) {
+	return key ? key : 1;
+}
+
+static void insertRun(Shaper *s, ShapedRun run) {
+	size_t mask = s->run_capacity - 1;
+	size_t slot = run.key & mask;
+	while (s->runs[slot].key != 0) {
+		slot = (slot + 1) & mask;
+	}
+	s->runs[slot] = run;
+	s->run_count++;
+}
+
+static void growRuns(Shaper *s) {
+	ShapedRun *old = s->runs;
+	size_t old_capacity = s->run_capacity;
+	s->run_capacity *= 2;
+	s->runs = (ShapedRun *)calloc(s->run_capacity, sizeof(ShapedRun));
+	s->run_count = 0;
+	for (size_t i = 0; i < old_capacity; i++) {
+		if (old[i].key != 0) {
+			insertRun(s, old[i]);
+		}
+	}
+	free(old);
+}
+
+static void clearRuns(Shaper *s) {
+	memset(s->runs, 0, s->run_capacity * sizeof(ShapedRun));
+	s->run_count = 0;
+	s->glyph_count = 0;
+}
+
+void shaperInit(Shaper *s) {
+	memset(s->fonts, 0, sizeof(s->fonts));
+	s->buffer = NULL;
+	s->run_count = 0;
+	s->run_capacity = SHAPER_INITIAL_RUNS;
+	s->runs = (ShapedRun *)calloc(s->run_capacity, sizeof(ShapedRun));
+	s->glyph_count = 0;
+	s->glyph_capacity = SHAPER_INITIAL_GLYPHS;
+	s->glyphs = (ShapedGlyph *)malloc(s->glyph_capacity * sizeof(ShapedGlyph));
+}
+
+void shaperDestroy(Shaper *s) {
+	for (u32 i = 0; i < MAX_FONT_ATLASES; i++) {
+		shaperReleaseFont(s, i);
+	}
+#ifdef MYTE_HARFBUZZ
+	hb_buffer_destroy((hb_buffer_t *)s->buffer);
+#endif
+	s->buffer = NULL;
+	free(s->runs);
+	free(s->glyphs);
+}
+
+bool shaperAvailable() {
+#ifdef MYTE_HARFBUZZ
+	return true;
+#else
+	return false;
+#endif
+}
+
+void shaperReleaseFont(Shaper *s, u32 font_id) {
+	if (!s->fonts[font_id]) {
+		return;
+	}
+#ifdef MYTE_HARFBUZZ
+	hb_font_destroy((hb_font_t *)s->fonts[font_id]);
+#endif
+	s->fonts[font_id] = NULL;
+
+	// Another font may take the id, and runs don't record theirs
+	clearRuns(s);
+}
+
+void shaperTrim(Shaper *s) {
+	if (s->run_count > SHAPER_MAX_RUNS) {
+		clearRuns(s);
+	}
+}
+
+u64 shaperKey(u32 font_id) {
+	return fnv1a(FNV_OFFSET_BASIS, &font_id, sizeof(font_id));
+}
+
+const ShapedRun *shaperFind(const Shaper *s, u64 key) {
+	key = slotKey(key);
+	size_t mask = s->run_capacity - 1;
+	size_t slot = key & mask;
+	while (s->runs[slot].key != 0) {
+		if (s->runs[slot].key == key) {
+			return &s->runs[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+#ifdef MYTE_HARFBUZZ
+// Appends the glyphs of the text to the pool. Hinted advances, like the
+// atlas's metrics, so shaped text stays on the same grid as unshaped text.
+static u32 shapeText(Shaper *s, u32 font_id, GlyphAtlas *atlas, const char *text, size_t len) {
+	hb_font_t *font = (hb_font_t *)s->fonts[font_id];
+	if (!font) {
+		font = hb_ft_font_create_referenced(atlas->face);
+		hb_ft_font_set_load_flags(font, FT_LOAD_DEFAULT);
+		s->fonts[font_id] = font;
+	}
+	if (!s->buffer) {
+		s->buffer = hb_buffer_create();
+	}
+
+	hb_buffer_t *buffer = (hb_buffer_t *)s->buffer;
+	hb_buffer_clear_contents(buffer);
+	hb_buffer_add_utf8(buffer, text, (int)len, 0, (int)len);
+	hb_buffer_guess_segment_properties(buffer);
+	hb_shape(font, buffer, NULL, 0);
+
+	unsigned int count = 0;
+	hb_glyph_info_t *infos = hb_buffer_get_glyph_infos(buffer, &count);
+	hb_glyph_position_t *positions = hb_buffer_get_glyph_positions(buffer, &count);
+
+	if (s->glyph_count + count > s->glyph_capacity) {
+		s->glyph_capacity = MAX(s->glyph_count + count, s->glyph_capacity * 2);
+		s->glyphs = (ShapedGlyph *)realloc(s->glyphs, s->glyph_capacity * sizeof(ShapedGlyph));
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		// Glyphs a codepoint maps to anyway are kept as that codepoint, they
+		// share the atlas entries (and the baked ASCII) of unshaped text
+		size_t codepoint_len = 1;
+		u32 codepoint = utf8Decode(&text[infos[i].cluster], &codepoint_len);
+		bool nominal = FT_Get_Char_Index(atlas->face, codepoint) == infos[i].codepoint;
+
+		ShapedGlyph *glyph = &s->glyphs[s->glyph_count + i];
+		glyph->glyph = nominal ? codepoint : GLYPH_INDEX_FLAG | infos[i].codepoint;
+		glyph->x_offset = positions[i].x_offset / 64.0f;
+		glyph->y_offset = positions[i].y_offset / 64.0f;
+		glyph->advance = (f32)(positions[i].x_advance / 64);
+	}
+	return count;
+}
+#else
+static u32 shapeText(Shaper *s, u32 font_id, GlyphAtlas *atlas, const char *text, size_t len) {
+	UNUSED(s);
+	UNUSED(font_id);
+	UNUSED(atlas);
+	UNUSED(text);
+	UNUSED(len);
+	return 0;
+}
+#endif
+
+const ShapedRun *shaperShape(Shaper *s, u64 key, u32 font_id, GlyphAtlas *atlas, const char *text, size_t len) {
+	if (!shaperAvailable()) {
+		return NULL;
+	}
+	const ShapedRun *cached = shaperFind(s, key);
+	if (cached) {
+		return cached;
+	}
+
+	ShapedRun run = { .key = slotKey(key), .first = (u32)s->glyph_count };
+	run.count = shapeText(s, font_id, atlas, text, len);
+	s->glyph_count += run.count;
+
+	if ((s->run_count + 1) * 2 > s->run_capacity) {
+		growRuns(s);
+	}
+	insertRun(s, run);
+	return shaperFind(s, key);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "util.h"
+#include "font.h"
+
+// Runs the shaper holds before shaperTrim starts over.
+#define SHAPER_MAX_RUNS 8192
+
+// A glyph of a shaped run. Offsets and advance are unscaled, like GlyphMetric.
+typedef struct {
+	u32 glyph; // codepoint, or glyph index tagged with GLYPH_INDEX_FLAG
+	f32 x_offset;
+	f32 y_offset;
+	f32 advance;
+} ShapedGlyph;
+
+typedef struct {
+	u64 key;   // 0 marks an empty slot
+	u32 first; // into the shaper's glyph pool
+	u32 count;
+} ShapedRun;
+
+// Turns runs of text into positioned glyphs with HarfBuzz, so fonts with
+// programming ligatures ("->", "!=") can draw them. Shaped runs are cached by
+// the hash of (font, text), so only new or edited runs are shaped again.
+// Without HarfBuzz (built without HARFBUZZ=1) nothing is ever shaped.
+typedef struct {
+	void *fonts[MAX_FONT_ATLASES]; // hb_font_t of each atlas, made on first use
+	void *buffer;                  // hb_buffer_t reused for every run
+
+	// Open addressed by key
+	ShapedRun *runs;
+	size_t run_count;
+	size_t run_capacity;
+
+	ShapedGlyph *glyphs;
+	size_t glyph_count;
+	size_t glyph_capacity;
+} Shaper;
+
+void shaperInit(Shaper *s);
+void shaperDestroy(Shaper *s);
+
+// Whether this build can shape at all.
+bool shaperAvailable();
+
+// Forgets the font (and everything shaped with it), call before its face goes.
+void shaperReleaseFont(Shaper *s, u32 font_id);
+
+// Drops every run once there are more than SHAPER_MAX_RUNS. Runs handed out
+// before are invalid afterwards, so only call it between passes.
+void shaperTrim(Shaper *s);
+
+// Key of a run: fnv1a of the font id followed by the text. The text may be
+// hashed piece by piece.
+u64 shaperKey(u32 font_id);
+
+// The run shaped under key, or NULL. Never modifies the shaper, so several
+// threads may find runs while nobody shapes.
+const ShapedRun *shaperFind(const Shaper *s, u64 key);
+
+// Shapes the text with the atlas's face and caches it under key, unless it is
+// cached already. Returns NULL when shaping isn't available.
+const ShapedRun *shaperShape(Shaper *s, u64 key, u32 font_id, GlyphAtlas *atlas, const char *text, size_t len);
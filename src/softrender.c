@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "softrender.h"
+
+// Pixels are RGBA8 in memory order, read as little endian u32s.
+static u32 packColor(Color c) {
+	u32 r = (u32)(CLAMP(0.0f, c.r, 1.0f) * 255.0f + 0.5f);
+	u32 g = (u32)(CLAMP(0.0f, c.g, 1.0f) * 255.0f + 0.5f);
+	u32 b = (u32)(CLAMP(0.0f, c.b, 1.0f) * 255.0f + 0.5f);
+	return r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+// x / 255, rounded, exact for x <= 255 * 255
+static inline u32 div255(u32 x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// The framebuffer is opaque, so only the color channels are blended.
+static inline void blendPixel(u32 *dst, u32 color, u32 alpha) {
+	u32 d = *dst;
+	u32 inv = 255 - alpha;
+	u32 r = div255((color & 0xFF) * alpha + (d & 0xFF) * inv);
+	u32 g = div255(((color >> 8) & 0xFF) * alpha + ((d >> 8) & 0xFF) * inv);
+	u32 b = div255(((color >> 16) & 0xFF) * alpha + ((d >> 16) & 0xFF) * inv);
+	*dst = r | (g << 8) | (b << 16) | 0xFF000000u;
+}
+
+#if defined(__SSE2__)
+// Same as div255 on eight 16 bit lanes
+static inline __m128i div255x8(__m128i x) {
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Blends two pixels (unpacked to 16 bit lanes) with their own alphas.
+// The source alpha lane is 255, so the destination stays opaque.
+static inline __m128i blendPair(__m128i src, __m128i dst, __m128i alpha) {
+	__m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+	return div255x8(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inv)));
+}
+#endif
+
+static void blendSpanSolid(u32 *dst, u32 count, u32 color, u32 alpha) {
+	color |= 0xFF000000u;
+	if (alpha == 255) {
+		for (u32 i = 0; i < count; i++) {
+			dst[i] = color;
+		}
+		return;
+	}
+
+	u32 i = 0;
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	__m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((i32)color), zero);
+	__m128i a = _mm_set1_epi16((i16)alpha);
+	for (; i + 4 <= count; i += 4) {
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		__m128i lo = blendPair(src, _mm_unpacklo_epi8(d, zero), a);
+		__m128i hi = blendPair(src, _mm_unpackhi_epi8(d, zero), a);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		blendPixel(&dst[i], color, alpha);
+	}
+}
+
+// Blends color over the span with alpha scaled by a coverage byte per pixel.
+static void blendSpanCoverage(u32 *dst, u32 count, u32 color, u32 alpha, const u8 *coverage) {
+	color |= 0xFF000000u;
+
+	u32 i = 0;
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	__m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((i32)color), zero);
+	for (; i + 4 <= count; i += 4) {
+		// Most of a glyph's box is empty
+		u32 c0 = coverage[i], c1 = coverage[i + 1], c2 = coverage[i + 2], c3 = coverage[i + 3];
+		if ((c0 | c1 | c2 | c3) == 0) {
+			continue;
+		}
+		i16 a0 = (i16)div255(c0 * alpha), a1 = (i16)div255(c1 * alpha);
+		i16 a2 = (i16)div255(c2 * alpha), a3 = (i16)div255(c3 * alpha);
+
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		__m128i lo = blendPair(src, _mm_unpacklo_epi8(d, zero), _mm_set_epi16(a1, a1, a1, a1, a0, a0, a0, a0));
+		__m128i hi = blendPair(src, _mm_unpackhi_epi8(d, zero), _mm_set_epi16(a3, a3, a3, a3, a2, a2, a2, a2));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		if (coverage[i]) {
+			blendPixel(&dst[i], color, div255(coverage[i] * alpha));
+		}
+	}
+}
+
+// Draws the part of the quad inside the clip rectangle (one tile).
+static void rasterQuad(SoftRenderer *s, const SoftQuad *q, i32 cx0, i32 cy0, i32 cx1, i32 cy1, TextureArray *textures, u32 white_layer) {
+	i32 x0 = MAX(q->x0, cx0);
+	i32 y0 = MAX(q->y0, cy0);
+	i32 x1 = MIN(q->x1, cx1);
+	i32 y1 = MIN(q->y1, cy1);
+	u32 alpha = q->color[3];
+	if (x0 >= x1 || y0 >= y1 || alpha == 0) {
+		return;
+	}
+
+	u32 color = q->color[0] | ((u32)q->color[1] << 8) | ((u32)q->color[2] << 16);
+	TextureLayer *tex = &textures->layers[q->layer];
+	if (q->layer == white_layer || !tex->pixels) {
+		for (i32 y = y0; y < y1; y++) {
+			blendSpanSolid(s->pixels + (size_t)y * s->width + x0, (u32)(x1 - x0), color, alpha);
+		}
+		return;
+	}
+
+	// Nearest texel under each pixel center
+	f32 du = (q->u1 - q->u0) / (f32)(q->x1 - q->x0);
+	f32 dv = (q->v1 - q->v0) / (f32)(q->y1 - q->y0);
+	u8 coverage[SOFT_TILE_SIZE];
+	for (i32 y = y0; y < y1; y++) {
+		i32 ty = (i32)floorf(q->v0 + ((f32)(y - q->y0) + 0.5f) * dv);
+		if (ty < 0 || ty >= (i32)tex->height) {
+			continue;
+		}
+		const u8 *row = tex->pixels + (size_t)ty * tex->width;
+		for (i32 x = x0; x < x1; x++) {
+			i32 tx = (i32)floorf(q->u0 + ((f32)(x - q->x0) + 0.5f) * du);
+			coverage[x - x0] = (tx >= 0 && tx < (i32)tex->width) ? row[tx] : 0;
+		}
+		blendSpanCoverage(s->pixels + (size_t)y * s->width + x0, (u32)(x1 - x0), color, alpha, coverage);
+	}
+}
+
+// Tiles the quad touches, false if it is off screen.
+static bool quadTiles(SoftRenderer *s, const SoftQuad *q, u32 *tx0, u32 *ty0, u32 *tx1, u32 *ty1) {
+	if (q->x1 <= 0 || q->y1 <= 0 || q->x0 >= (i32)s->width || q->y0 >= (i32)s->height || q->x0 >= q->x1 || q->y0 >= q->y1) {
+		return false;
+	}
+	*tx0 = (u32)MAX(q->x0, 0) / SOFT_TILE_SIZE;
+	*ty0 = (u32)MAX(q->y0, 0) / SOFT_TILE_SIZE;
+	*tx1 = (u32)(MIN(q->x1, (i32)s->width) - 1) / SOFT_TILE_SIZE;
+	*ty1 = (u32)(MIN(q->y1, (i32)s->height) - 1) / SOFT_TILE_SIZE;
+	return true;
+}
+
+void softRendererInit(SoftRenderer *s, u32 width, u32 height) {
+	memset(s, 0, sizeof(*s));
+	glGenTextures(1, &s->texture);
+	glBindTexture(GL_TEXTURE_2D, s->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	softRendererResize(s, width, height);
+}
+
+void softRendererDestroy(SoftRenderer *s) {
+	glDeleteTextures(1, &s->texture);
+	free(s->pixels);
+	free(s->quads);
+	free(s->tile_hashes);
+	free(s->prev_tile_hashes);
+	free(s->dirty);
+	free(s->bin_offsets);
+	free(s->bin_items);
+	memset(s, 0, sizeof(*s));
+}
+
+void softRendererResize(SoftRenderer *s, u32 width, u32 height) {
+	s->width = MAX(width, 1);
+	s->height = MAX(height, 1);
+	s->pixels = (u32 *)realloc(s->pixels, (size_t)s->width * s->height * sizeof(u32));
+
+	s->tiles_x = (s->width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+	s->tiles_y = (s->height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+	size_t tile_count = (size_t)s->tiles_x * s->tiles_y;
+	s->tile_hashes = (u64 *)realloc(s->tile_hashes, tile_count * sizeof(u64));
+	s->prev_tile_hashes = (u64 *)realloc(s->prev_tile_hashes, tile_count * sizeof(u64));
+	s->dirty = (bool *)realloc(s->dirty, tile_count * sizeof(bool));
+	s->bin_offsets = (u32 *)realloc(s->bin_offsets, (tile_count + 1) * sizeof(u32));
+	s->redraw_all = true;
+
+	glBindTexture(GL_TEXTURE_2D, s->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, s->width, s->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+}
+
+void softRendererBegin(SoftRenderer *s) {
+	s->quad_count = 0;
+	s->clipping = false;
+}
+
+void softRendererSetClip(SoftRenderer *s, i32 x0, i32 y0, i32 x1, i32 y1) {
+	s->clip_x0 = x0;
+	s->clip_y0 = y0;
+	s->clip_x1 = x1;
+	s->clip_y1 = y1;
+	s->clipping = true;
+}
+
+void softRendererResetClip(SoftRenderer *s) {
+	s->clipping = false;
+}
+
+// Cuts the quad to the clip area, moving its UVs along so the texels under
+// the pixels that are left stay the same. False when nothing is left.
+static bool clipQuad(const SoftRenderer *s, SoftQuad *q) {
+	i32 x0 = MAX(q->x0, s->clip_x0);
+	i32 y0 = MAX(q->y0, s->clip_y0);
+	i32 x1 = MIN(q->x1, s->clip_x1);
+	i32 y1 = MIN(q->y1, s->clip_y1);
+	if (x0 >= x1 || y0 >= y1) {
+		return false;
+	}
+
+	f32 du = (q->u1 - q->u0) / (f32)(q->x1 - q->x0);
+	f32 dv = (q->v1 - q->v0) / (f32)(q->y1 - q->y0);
+	q->u1 = q->u0 + (f32)(x1 - q->x0) * du;
+	q->u0 = q->u0 + (f32)(x0 - q->x0) * du;
+	q->v1 = q->v0 + (f32)(y1 - q->y0) * dv;
+	q->v0 = q->v0 + (f32)(y0 - q->y0) * dv;
+	q->x0 = x0;
+	q->y0 = y0;
+	q->x1 = x1;
+	q->y1 = y1;
+	return true;
+}
+
+void softRendererPushQuad(SoftRenderer *s, SoftQuad quad) {
+	if (s->clipping && !clipQuad(s, &quad)) {
+		return;
+	}
+	if (s->quad_count == s->quad_capacity) {
+		s->quad_capacity = s->quad_capacity ? s->quad_capacity * 2 : 4096;
+		s->quads = (SoftQuad *)realloc(s->quads, s->quad_capacity * sizeof(SoftQuad));
+	}
+	s->quads[s->quad_count++] = quad;
+}
+
+u64 softRendererEnd(SoftRenderer *s, TextureArray *textures, u32 white_layer, Color clear_color) {
+	u32 tile_count = s->tiles_x * s->tiles_y;
+	u32 tx0, ty0, tx1, ty1;
+
+	// Glyphs may have moved around in the atlases
+	if (textures->revision != s->texture_revision) {
+		s->texture_revision = textures->revision;
+		s->redraw_all = true;
+	}
+
+	// A tile's hash covers every quad touching it, in order
+	for (u32 t = 0; t < tile_count; t++) {
+		s->tile_hashes[t] = FNV_OFFSET_BASIS;
+	}
+	for (u32 i = 0; i < s->quad_count; i++) {
+		const SoftQuad *q = &s->quads[i];
+		if (!quadTiles(s, q, &tx0, &ty0, &tx1, &ty1)) {
+			continue;
+		}
+		for (u32 ty = ty0; ty <= ty1; ty++) {
+			for (u32 tx = tx0; tx <= tx1; tx++) {
+				u64 *hash = &s->tile_hashes[ty * s->tiles_x + tx];
+				*hash = fnv1a(*hash, q, sizeof(*q));
+			}
+		}
+	}
+
+	s->dirty_tiles = 0;
+	for (u32 t = 0; t < tile_count; t++) {
+		s->dirty[t] = s->redraw_all || s->tile_hashes[t] != s->prev_tile_hashes[t];
+		s->dirty_tiles += s->dirty[t];
+	}
+	u64 *swap = s->prev_tile_hashes;
+	s->prev_tile_hashes = s->tile_hashes;
+	s->tile_hashes = swap;
+	s->redraw_all = false;
+
+	if (s->dirty_tiles == 0) {
+		return 0;
+	}
+
+	// Bin the quads into the dirty tiles they touch
+	memset(s->bin_offsets, 0, (tile_count + 1) * sizeof(u32));
+	for (u32 i = 0; i < s->quad_count; i++) {
+		if (!quadTiles(s, &s->quads[i], &tx0, &ty0, &tx1, &ty1)) {
+			continue;
+		}
+		for (u32 ty = ty0; ty <= ty1; ty++) {
+			for (u32 tx = tx0; tx <= tx1; tx++) {
+				u32 t = ty * s->tiles_x + tx;
+				s->bin_offsets[t + 1] += s->dirty[t];
+			}
+		}
+	}
+	for (u32 t = 0; t < tile_count; t++) {
+		s->bin_offsets[t + 1] += s->bin_offsets[t];
+	}
+	u32 total = s->bin_offsets[tile_count];
+	if (total > s->bin_capacity) {
+		s->bin_capacity = total * 2;
+		s->bin_items = (u32 *)realloc(s->bin_items, s->bin_capacity * sizeof(u32));
+	}
+
+	// Filling advances each tile's offset to its end, shift them back after
+	for (u32 i = 0; i < s->quad_count; i++) {
+		if (!quadTiles(s, &s->quads[i], &tx0, &ty0, &tx1, &ty1)) {
+			continue;
+		}
+		for (u32 ty = ty0; ty <= ty1; ty++) {
+			for (u32 tx = tx0; tx <= tx1; tx++) {
+				u32 t = ty * s->tiles_x + tx;
+				if (s->dirty[t]) {
+					s->bin_items[s->bin_offsets[t]++] = i;
+				}
+			}
+		}
+	}
+	for (u32 t = tile_count; t > 0; t--) {
+		s->bin_offsets[t] = s->bin_offsets[t - 1];
+	}
+	s->bin_offsets[0] = 0;
+
+	// Redraw the dirty tiles from scratch
+	u32 clear = packColor(clear_color);
+	for (u32 t = 0; t < tile_count; t++) {
+		if (!s->dirty[t]) {
+			continue;
+		}
+		i32 cx0 = (i32)((t % s->tiles_x) * SOFT_TILE_SIZE);
+		i32 cy0 = (i32)((t / s->tiles_x) * SOFT_TILE_SIZE);
+		i32 cx1 = MIN(cx0 + SOFT_TILE_SIZE, (i32)s->width);
+		i32 cy1 = MIN(cy0 + SOFT_TILE_SIZE, (i32)s->height);
+		for (i32 y = cy0; y < cy1; y++) {
+			blendSpanSolid(s->pixels + (size_t)y * s->width + cx0, (u32)(cx1 - cx0), clear, 255);
+		}
+		for (u32 b = s->bin_offsets[t]; b < s->bin_offsets[t + 1]; b++) {
+			rasterQuad(s, &s->quads[s->bin_items[b]], cx0, cy0, cx1, cy1, textures, white_layer);
+		}
+	}
+
+	// One upload per run of tile rows holding dirty tiles, so the cursor and
+	// the status line don't drag everything between them along
+	glBindTexture(GL_TEXTURE_2D, s->texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	u64 bytes = 0;
+	u32 run_start = s->tiles_y;
+	for (u32 ty = 0; ty <= s->tiles_y; ty++) {
+		bool row_dirty = false;
+		for (u32 tx = 0; ty < s->tiles_y && tx < s->tiles_x && !row_dirty; tx++) {
+			row_dirty = s->dirty[ty * s->tiles_x + tx];
+		}
+		if (row_dirty && run_start == s->tiles_y) {
+			run_start = ty;
+		} else if (!row_dirty && run_start != s->tiles_y) {
+			u32 y0 = run_start * SOFT_TILE_SIZE;
+			u32 y1 = MIN(ty * SOFT_TILE_SIZE, s->height);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, s->width, y1 - y0, GL_RGBA, GL_UNSIGNED_BYTE, s->pixels + (size_t)y0 * s->width);
+			bytes += (u64)(y1 - y0) * s->width * sizeof(u32);
+			run_start = s->tiles_y;
+		}
+	}
+	return bytes;
+}
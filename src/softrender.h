@@ -0,0 +1,67 @@
+#pragma once
+#include "util.h"
+#include "texarray.h"
+
+// Side of the square tiles the screen is split into for damage tracking.
+#define SOFT_TILE_SIZE 32
+
+// An axis aligned quad in whole pixels. UVs are the texels at (x0, y0) and
+// (x1, y1), sampled nearest. No implicit padding, the quad is hashed as bytes.
+typedef struct {
+	i32 x0, y0, x1, y1;
+	f32 u0, v0, u1, v1;
+	u8 color[4];
+	u8 layer;
+	u8 padding[3];
+} SoftQuad;
+
+// CPU rasterizer for machines where GL itself is software (X forwarding, VMs
+// without a GPU). Quads are collected for the whole frame, the screen is split
+// into tiles, and only tiles whose quads differ from the last frame are drawn
+// and uploaded. The framebuffer is presented through a single GL texture.
+typedef struct {
+	u32 width;
+	u32 height;
+	u32 *pixels; // RGBA8, bottom row first like the GL texture
+
+	SoftQuad *quads;
+	u32 quad_count;
+	u32 quad_capacity;
+
+	u32 tiles_x;
+	u32 tiles_y;
+	u64 *tile_hashes;
+	u64 *prev_tile_hashes;
+	bool *dirty;
+
+	// Quads overlapping each dirty tile, as offsets into bin_items
+	u32 *bin_offsets;
+	u32 *bin_items;
+	u32 bin_capacity;
+
+	// Quads are cut to this area as they are pushed, see softRendererSetClip
+	i32 clip_x0, clip_y0, clip_x1, clip_y1;
+	bool clipping;
+
+	bool redraw_all;
+	u64 texture_revision;
+
+	u32 texture;
+	u32 dirty_tiles; // tiles redrawn by the last frame
+} SoftRenderer;
+
+void softRendererInit(SoftRenderer *s, u32 width, u32 height);
+void softRendererDestroy(SoftRenderer *s);
+void softRendererResize(SoftRenderer *s, u32 width, u32 height);
+
+void softRendererBegin(SoftRenderer *s);
+void softRendererPushQuad(SoftRenderer *s, SoftQuad quad);
+
+// Quads pushed from now on only cover the area (x1, y1 exclusive) until
+// softRendererResetClip. Cut quads keep sampling the same texels.
+void softRendererSetClip(SoftRenderer *s, i32 x0, i32 y0, i32 x1, i32 y1);
+void softRendererResetClip(SoftRenderer *s);
+
+// Draws the tiles that changed since the last frame and uploads them to the
+// texture. Quads on white_layer are untextured. Returns the bytes uploaded.
+u64 softRendererEnd(SoftRenderer *s, TextureArray *textures, u32 white_layer, Color clear_color);
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <string.h>
+#include "texarray.h"
+
+static void uploadLayer(TextureArray *ta, u32 layer, u32 x, u32 y, u32 w, u32 h) {
+	TextureLayer *l = &ta->layers[layer];
+	if (!l->pixels || w == 0 || h == 0) {
+		return;
+	}
+	ta->revision++;
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ta->texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, l->width);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, w, h, 1, GL_RED, GL_UNSIGNED_BYTE, l->pixels + (size_t)y * l->width + x);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// Recreates the GPU storage and uploads every layer again from its mirror.
+static void reallocate(TextureArray *ta, u32 size, u32 layer_count) {
+	ta->size = size;
+	ta->layer_count = layer_count;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ta->texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, size, size, layer_count, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	for (u32 i = 0; i < layer_count; i++) {
+		if (ta->layers[i].used) {
+			uploadLayer(ta, i, 0, 0, ta->layers[i].width, ta->layers[i].height);
+		}
+	}
+}
+
+void textureArrayInit(TextureArray *ta, u32 initial_size) {
+	memset(ta, 0, sizeof(*ta));
+
+	GLint max_texture_size = 0;
+	GLint max_layers = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+	ta->max_size = MIN((u32)max_texture_size, TEXTURE_ARRAY_MAX_SIZE);
+	if ((u32)max_layers < TEXTURE_ARRAY_MAX_LAYERS) {
+		LOG_ERROR("GPU only supports %d texture array layers, need %d", max_layers, TEXTURE_ARRAY_MAX_LAYERS);
+		exit(1);
+	}
+
+	glGenTextures(1, &ta->texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ta->texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	reallocate(ta, initial_size, 2);
+}
+
+void textureArrayDestroy(TextureArray *ta) {
+	glDeleteTextures(1, &ta->texture);
+}
+
+i32 textureArrayAcquire(TextureArray *ta) {
+	for (u32 i = 0; i < TEXTURE_ARRAY_MAX_LAYERS; i++) {
+		if (ta->layers[i].used) {
+			continue;
+		}
+
+		ta->layers[i] = (TextureLayer) { .pixels = NULL, .width = 0, .height = 0, .used = true };
+		if (i >= ta->layer_count) {
+			reallocate(ta, ta->size, i + 1);
+		}
+		return (i32)i;
+	}
+	return -1;
+}
+
+void textureArrayRelease(TextureArray *ta, u32 layer) {
+	ta->layers[layer] = (TextureLayer) { 0 };
+}
+
+void textureArraySetLayer(TextureArray *ta, u32 layer, const u8 *pixels, u32 width, u32 height) {
+	TextureLayer *l = &ta->layers[layer];
+	l->pixels = pixels;
+	l->width = width;
+	l->height = height;
+
+	u32 needed = MAX(width, height);
+	if (needed > ta->size) {
+		u32 size = ta->size;
+		while (size < needed) {
+			size *= 2;
+		}
+		if (size > ta->max_size) {
+			LOG_ERROR("Texture array layer of %ux%u exceeds the maximum texture size %u", width, height, ta->max_size);
+			exit(1);
+		}
+		reallocate(ta, size, ta->layer_count);
+		return;
+	}
+	uploadLayer(ta, layer, 0, 0, width, height);
+}
+
+void textureArrayUploadRegion(TextureArray *ta, u32 layer, u32 x, u32 y, u32 w, u32 h) {
+	uploadLayer(ta, layer, x, y, w, h);
+}
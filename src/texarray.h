@@ -0,0 +1,46 @@
+#pragma once
+#include <GL/glew.h>
+#include "util.h"
+
+#define TEXTURE_ARRAY_MAX_LAYERS 16
+
+// Every layer is as large as the largest user, so one atlas growing costs its
+// size in VRAM for each layer. Layers stop growing here (4MB each, atlases
+// evict glyphs instead), and only the layers in use are allocated.
+#define TEXTURE_ARRAY_MAX_SIZE 2048
+
+typedef struct {
+	// CPU mirror owned by whoever acquired the layer. Kept so every layer can
+	// be uploaded again when the array has to be reallocated.
+	const u8 *pixels;
+	u32 width;
+	u32 height;
+	bool used;
+} TextureLayer;
+
+// Every glyph atlas and the white texture live in one GL_TEXTURE_2D_ARRAY
+// (single channel) so a frame can be drawn without switching textures.
+// Layers share one size, large enough for the biggest user. Users keep their
+// own logical size in the top left corner of their layer and address it in texels.
+typedef struct {
+	GLuint texture;
+	u32 size;
+	u32 max_size;
+	u32 layer_count; // layers allocated on the GPU
+	TextureLayer layers[TEXTURE_ARRAY_MAX_LAYERS];
+	u64 revision;    // bumped whenever texels change
+} TextureArray;
+
+void textureArrayInit(TextureArray *ta, u32 initial_size);
+void textureArrayDestroy(TextureArray *ta);
+
+// Returns a free layer, or -1 when all TEXTURE_ARRAY_MAX_LAYERS are in use.
+i32  textureArrayAcquire(TextureArray *ta);
+void textureArrayRelease(TextureArray *ta, u32 layer);
+
+// Points the layer at a (possibly new) CPU mirror and uploads all of it,
+// growing the array if it doesn't fit.
+void textureArraySetLayer(TextureArray *ta, u32 layer, const u8 *pixels, u32 width, u32 height);
+
+// Uploads a sub-rectangle of the layer's CPU mirror.
+void textureArrayUploadRegion(TextureArray *ta, u32 layer, u32 x, u32 y, u32 w, u32 h);
@@ -1,7 +1,9 @@
+#define _XOPEN_SOURCE 700
 #include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 vec2 vec2_clamp(vec2 vec, rect quad) {
     return (vec2) {
@@ -389,6 +391,16 @@ int checkPath(const char *path) {
     }
 }
 
+bool getFileStamp(const char *path, FileStamp *stamp) {
+    struct stat s;
+    if (stat(path, &s) != 0) {
+        *stamp = (FileStamp) { 0 };
+        return false;
+    }
+    *stamp = (FileStamp) { .size = s.st_size, .mtime_sec = s.st_mtim.tv_sec, .mtime_nsec = s.st_mtim.tv_nsec };
+    return true;
+}
+
 const char *getFileExtFromPath (const char *path) {
     const char *dot = strrchr(path, '.');
     if (!dot || dot == path) {
@@ -398,6 +410,29 @@ const char *getFileExtFromPath (const char *path) {
 }
 
 /* Be sure to call free()! */
+char *getCanonicalPath(const char *path) {
+    char *canonical = realpath(path, NULL);
+    if (canonical) {
+        return canonical;
+    }
+
+    // Not there yet, like a new file about to be saved
+    const char *slash = strrchr(path, '/');
+    char *dir = slash ? strndup(path, MAX(slash - path, 1)) : strdup(".");
+    char *canonical_dir = realpath(dir, NULL);
+    free(dir);
+    if (!canonical_dir) {
+        return strdup(path);
+    }
+
+    const char *name = slash ? slash + 1 : path;
+    size_t length = strlen(canonical_dir) + strlen(name) + 2;
+    canonical = (char *)malloc(length);
+    snprintf(canonical, length, "%s/%s", strcmp(canonical_dir, "/") == 0 ? "" : canonical_dir, name);
+    free(canonical_dir);
+    return canonical;
+}
+
 char *getFileNameFromPath(const char *path) {
     const char *last_slash = strrchr(path, '/');
 
@@ -494,6 +529,71 @@ char *readFile(const char *file_path) {
     return read_buf;
 }
 
+u32 utf8Decode(const char *s, size_t *len) {
+    const u8 *b = (const u8 *)s;
+    u32 codepoint = 0;
+    size_t count = 0;
+
+    if (b[0] < 0x80) {
+        *len = 1;
+        return b[0];
+    } else if ((b[0] & 0xE0) == 0xC0) {
+        codepoint = b[0] & 0x1F;
+        count = 2;
+    } else if ((b[0] & 0xF0) == 0xE0) {
+        codepoint = b[0] & 0x0F;
+        count = 3;
+    } else if ((b[0] & 0xF8) == 0xF0) {
+        codepoint = b[0] & 0x07;
+        count = 4;
+    } else {
+        *len = 1;
+        return UTF8_REPLACEMENT_CHAR;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (!utf8IsContinuation(s[i])) {
+            *len = 1;
+            return UTF8_REPLACEMENT_CHAR;
+        }
+        codepoint = (codepoint << 6) | (b[i] & 0x3F);
+    }
+    *len = count;
+    return codepoint;
+}
+
+size_t utf8Encode(u32 codepoint, char *out) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    } else if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    } else if (codepoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    } else {
+        out[0] = (char)(0xF0 | (codepoint >> 18));
+        out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (codepoint & 0x3F));
+        return 4;
+    }
+}
+
+size_t utf8Length(const char *s) {
+    size_t count = 0;
+    for (; *s; s++) {
+        if (!utf8IsContinuation(*s)) {
+            count++;
+        }
+    }
+    return count;
+}
+
 static const char *level_strings[] = {
   "DEBUG", "INFO", "WARN", "ERROR",
 };
@@ -518,4 +618,40 @@ f32 ease_out (f32 start, f32 end, f32 t) {
     t = t - 1.0f;  // Adjust t for cubic easing
     f32 eased_t = t * t * t + 1.0f;  // Apply cubic ease-out
     return start + eased_t * (end - start);;
-}
\ No newline at end of file
+}
+
+f64 getTimeSeconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec / 1000000000.0;
+}
+
+u64 fnv1a(u64 hash, const void *data, size_t length) {
+    const u8 *bytes = (const u8 *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+char *getCachePath(const char *file_name) {
+    char dir[1024];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && xdg[0]) {
+        snprintf(dir, sizeof(dir), "%s/myte", xdg);
+    } else if (home && home[0]) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+        mkdir(dir, 0755);
+        snprintf(dir, sizeof(dir), "%s/.cache/myte", home);
+    } else {
+        return NULL;
+    }
+    mkdir(dir, 0755);
+
+    size_t length = strlen(dir) + strlen(file_name) + 2;
+    char *path = (char *)malloc(length);
+    snprintf(path, length, "%s/%s", dir, file_name);
+    return path;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 #include <math.h>
 #include <stdarg.h>
 #include <sys/stat.h>
@@ -153,6 +154,15 @@ typedef enum {
 
 // Returns 0 if the path points to a file, 1 if the path points to a directory and -1 if there is an error.
 i32 checkPath (const char *path);
+
+// Size and modification time, to tell if a file changed since it was last seen
+typedef struct { i64 size; i64 mtime_sec; i64 mtime_nsec; } FileStamp;
+
+// Returns false, zeroing the stamp, if the file can't be stat'd.
+bool getFileStamp(const char *path, FileStamp *stamp);
+static inline bool fileStampEqual(FileStamp a, FileStamp b) {
+    return a.size == b.size && a.mtime_sec == b.mtime_sec && a.mtime_nsec == b.mtime_nsec;
+}
 const char *getFileExtFromPath(const char *path);
 
 /* Be sure to call free()! */
@@ -161,8 +171,31 @@ char* get_filename_from_path(const char* filepath);
 
 FileType getFileType(const char *file_name, const char *file_ext);
 
+// Absolute path without "." "..", or symlinks, so one file always has the same
+// path. A file that doesn't exist yet gets its directory's. Be sure to call free()!
+char *getCanonicalPath(const char *path);
+
 char *readFile(const char *file_name);
 
+// Returns $XDG_CACHE_HOME/myte/<file_name> (or ~/.cache/myte/...), creating
+// the directory if needed. NULL when neither is set. Be sure to call free()!
+char *getCachePath(const char *file_name);
+
+// UTF-8
+#define UTF8_REPLACEMENT_CHAR 0xFFFD
+
+static inline bool utf8IsContinuation(char c) { return ((u8)c & 0xC0) == 0x80; }
+
+// Decodes the codepoint at s and stores the number of bytes it used in len.
+// Malformed sequences decode to UTF8_REPLACEMENT_CHAR and consume one byte.
+u32 utf8Decode(const char *s, size_t *len);
+
+// Writes the encoding of codepoint into out (at least 4 bytes), returns the byte count.
+size_t utf8Encode(u32 codepoint, char *out);
+
+// Number of codepoints in the null terminated string.
+size_t utf8Length(const char *s);
+
 // Some logging stuff
 
 enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
@@ -175,4 +208,11 @@ enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
 void log_log(i32 level, const char *file, int line, const char *fmt, ...);
 
 f32 lerp (f32 start, f32 end, f32 t);
-f32 ease_out (f32 start, f32 end, f32 t);
\ No newline at end of file
+f32 ease_out (f32 start, f32 end, f32 t);
+
+// Seconds since an arbitrary point, for timing. Doesn't need a window.
+f64 getTimeSeconds();
+
+// 64 bit FNV-1a. Chain calls (passing the previous result) to hash several fields.
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+u64 fnv1a(u64 hash, const void *data, size_t length);
\ No newline at end of file
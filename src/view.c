@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+#include "view.h"
+
+void editorViewInit(EditorView *v) {
+    memset(v, 0, sizeof(EditorView));
+}
+
+void editorViewDestroy(EditorView *v) {
+    if (v->text) {
+        textSnapshotRelease(v->text);
+    }
+    free(v->dialog_text);
+    free(v->browser_text);
+    editorViewInit(v);
+}
+
+static void reserveText(char **text, size_t *capacity, size_t length) {
+    if (length + 1 > *capacity) {
+        *capacity = MAX(length + 1, *capacity * 2);
+        *text = (char *)realloc(*text, *capacity);
+    }
+}
+
+void editorViewUpdate(EditorView *v, Editor *ed, const EditorPane *pane, AppContext *ctx) {
+    // Take the new reference first, the old one may be the last of the same snapshot
+    TextSnapshot *text = editorTextSnapshot(ed);
+    if (v->text) {
+        textSnapshotRelease(v->text);
+    }
+    v->text = text;
+    v->ctx = *ctx;
+
+    v->mode = ed->mode;
+    v->frame = ed->frame;
+    v->text_pos = ed->text_pos;
+    v->scroll_pos = ed->scroll_pos;
+    v->target_scroll_pos = ed->target_scroll_pos;
+    v->line_count = ed->line_count;
+    v->gutter = ed->gutter;
+    v->cursor = ed->cursor;
+
+    // Panes without focus only show the text, the browser and dialog belong
+    // to the focused one
+    if (pane) {
+        v->mode = EDITOR_MODE_NORMAL;
+        v->frame = pane->frame;
+        v->text_pos = editorTextPos(ed, ctx, pane->frame);
+        v->scroll_pos = pane->scroll_pos;
+        v->target_scroll_pos = pane->target_scroll_pos;
+        v->cursor = pane->cursor;
+        return;
+    }
+
+    char *file_name = ed->file_path ? get_filename_from_path(ed->file_path) : NULL;
+    snprintf(v->file_name, sizeof(v->file_name), "%s", file_name ? file_name : "(null)");
+    free(file_name);
+    v->load_progress = editorLoading(ed) ? editorLoadProgress(ed) : -1.0f;
+
+    if (ed->mode == EDITOR_MODE_SAVE) {
+        char *dialog_text = getBufString(ed->sd.buf);
+        size_t length = strlen(dialog_text);
+        reserveText(&v->dialog_text, &v->dialog_capacity, length);
+        memcpy(v->dialog_text, dialog_text, length + 1);
+        free(dialog_text);
+
+        v->dialog_frame = ed->sd.frame;
+        v->dialog_title_pos = ed->sd.title_pos;
+        v->dialog_text_pos = ed->sd.text_pos;
+        v->dialog_input_box = ed->sd.input_box;
+        v->dialog_cursor = ed->sd.cursor;
+    }
+
+    if (ed->mode == EDITOR_MODE_OPEN) {
+        FileBrowser *browser = &ed->browser;
+        size_t length = 0;
+        for (size_t i = 0; i < browser->num_paths; i++) {
+            length += strlen(browser->items[i].name_ext) + 2;
+        }
+        reserveText(&v->browser_text, &v->browser_capacity, length);
+
+        char *end = v->browser_text;
+        for (size_t i = 0; i < browser->num_paths; i++) {
+            size_t name_length = strlen(browser->items[i].name_ext);
+            memcpy(end, browser->items[i].name_ext, name_length);
+            end += name_length;
+            if (browser->items[i].is_dir) {
+                *end++ = '/';
+            }
+            *end++ = '\n';
+        }
+        *end = '\0';
+
+        v->browser_count = browser->num_paths;
+        v->browser_scroll_pos = browser->scroll_pos;
+        v->browser_cursor = browser->cursor;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "editor.h"
+#include "context.h"
+
+// Panes the window can be split into, each drawn from its own view.
+#define MAX_PANES 4
+
+// Everything renderEditor draws of an editor, copied out of it once per frame
+// so the renderer (on its own thread) never reads the editor itself. The text
+// is shared by the views of a revision, the rest is small enough to copy.
+typedef struct {
+    TextSnapshot *text;
+    AppContext ctx;
+
+    EditorMode mode;
+    rect frame;
+    vec2 text_pos;
+    vec2 scroll_pos;
+    vec2 target_scroll_pos;
+    size_t line_count;
+    Gutter gutter;
+    Cursor cursor;
+    char file_name[256];
+    f32 load_progress; // of the file, negative once it's all loaded
+
+    // Save dialog, while in EDITOR_MODE_SAVE
+    char *dialog_text;
+    size_t dialog_capacity;
+    rect dialog_frame;
+    vec2 dialog_title_pos;
+    vec2 dialog_text_pos;
+    rect dialog_input_box;
+    Cursor dialog_cursor;
+
+    // File browser, while in EDITOR_MODE_OPEN. Its names one per line,
+    // directories with a trailing slash.
+    char *browser_text;
+    size_t browser_capacity;
+    size_t browser_count;
+    vec2 browser_scroll_pos;
+    Cursor browser_cursor;
+} EditorView;
+
+void editorViewInit(EditorView *v);
+void editorViewDestroy(EditorView *v);
+
+// Copies the editor's current state into the view, reusing its allocations.
+// Must run on the thread that edits the editor, while nobody draws the view.
+// With a pane, the view is of that pane instead of the one the editor works with.
+void editorViewUpdate(EditorView *v, Editor *ed, const EditorPane *pane, AppContext *ctx);
@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "watcher.h"
+
+// Events that leave a file with new contents: written in place, or
+// another file renamed over it.
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+static void *fileWatcherMain(void *arg) {
+    FileWatcher *w = (FileWatcher *)arg;
+    _Alignas(struct inotify_event) char events[4096];
+    struct pollfd fds[2] = {
+        { .fd = w->fd, .events = POLLIN },
+        { .fd = w->quit_pipe[0], .events = POLLIN }
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Stopped watching files: %s", strerror(errno));
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+
+        ssize_t length = read(w->fd, events, sizeof(events));
+        if (length <= 0) {
+            continue;
+        }
+
+        pthread_mutex_lock(&w->lock);
+        for (char *p = events; p < events + length;) {
+            struct inotify_event *event = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            // Events were dropped, any of the files may have changed
+            bool overflow = event->mask & IN_Q_OVERFLOW;
+            if (!overflow && event->len == 0) {
+                continue;
+            }
+            for (u32 i = 0; i < w->file_count; i++) {
+                WatchedFile *file = &w->files[i];
+                if (overflow || (file->wd == event->wd && strcmp(file->name, event->name) == 0)) {
+                    file->changed = true;
+                    atomic_store(&w->changed, true);
+                }
+            }
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+void fileWatcherInit(FileWatcher *w) {
+    w->file_count = 0;
+    atomic_init(&w->changed, false);
+    pthread_mutex_init(&w->lock, NULL);
+
+    // Without inotify the editor works as before, changes need a reload
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        LOG_WARN("Can't watch files for changes: %s", strerror(errno));
+        return;
+    }
+    if (pipe(w->quit_pipe) != 0) {
+        LOG_ERROR("Failed to make the file watcher's pipe.", "");
+        exit(1);
+    }
+    if (pthread_create(&w->thread, NULL, fileWatcherMain, w) != 0) {
+        LOG_ERROR("Failed to start the file watcher thread.", "");
+        exit(1);
+    }
+}
+
+void fileWatcherDestroy(FileWatcher *w) {
+    if (w->fd >= 0) {
+        if (write(w->quit_pipe[1], "q", 1) != 1) {
+            LOG_ERROR("Failed to stop the file watcher thread.", "");
+        }
+        pthread_join(w->thread, NULL);
+        close(w->quit_pipe[0]);
+        close(w->quit_pipe[1]);
+        close(w->fd);
+        w->fd = -1;
+    }
+
+    for (u32 i = 0; i < w->file_count; i++) {
+        free(w->files[i].path);
+        free(w->files[i].name);
+    }
+    w->file_count = 0;
+    pthread_mutex_destroy(&w->lock);
+}
+
+void fileWatcherAdd(FileWatcher *w, const char *path) {
+    if (w->fd < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    for (u32 i = 0; i < w->file_count; i++) {
+        if (strcmp(w->files[i].path, path) == 0) {
+            w->files[i].refs++;
+            pthread_mutex_unlock(&w->lock);
+            return;
+        }
+    }
+    if (w->file_count == MAX_WATCHED_FILES) {
+        pthread_mutex_unlock(&w->lock);
+        LOG_WARN("Watching too many files, changes to %s won't be seen", path);
+        return;
+    }
+
+    // A directory watched for another file gives back the same watch
+    const char *slash = strrchr(path, '/');
+    char *dir = slash ? strndup(path, MAX(slash - path, 1)) : strdup(".");
+    int wd = inotify_add_watch(w->fd, dir, WATCH_EVENTS);
+    free(dir);
+    if (wd < 0) {
+        pthread_mutex_unlock(&w->lock);
+        LOG_WARN("Can't watch %s: %s", path, strerror(errno));
+        return;
+    }
+
+    w->files[w->file_count++] = (WatchedFile) {
+        .path = strdup(path),
+        .name = strdup(slash ? slash + 1 : path),
+        .wd = wd,
+        .refs = 1,
+        .changed = false
+    };
+    pthread_mutex_unlock(&w->lock);
+}
+
+void fileWatcherRemove(FileWatcher *w, const char *path) {
+    pthread_mutex_lock(&w->lock);
+    for (u32 i = 0; i < w->file_count; i++) {
+        WatchedFile file = w->files[i];
+        if (strcmp(file.path, path) != 0) {
+            continue;
+        }
+        if (--w->files[i].refs > 0) {
+            break;
+        }
+
+        memmove(&w->files[i], &w->files[i + 1], (w->file_count - i - 1) * sizeof(WatchedFile));
+        w->file_count--;
+        free(file.path);
+        free(file.name);
+
+        // Keep the directory watched while other files in it are
+        bool shared = false;
+        for (u32 j = 0; j < w->file_count; j++) {
+            shared |= w->files[j].wd == file.wd;
+        }
+        if (!shared) {
+            inotify_rm_watch(w->fd, file.wd);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+void fileWatcherPoll(FileWatcher *w, FileChangedFn changed, void *user) {
+    // Nothing changed, the usual case
+    if (!atomic_load(&w->changed)) {
+        return;
+    }
+
+    // The callbacks run without the lock, they may watch other files
+    char *paths[MAX_WATCHED_FILES];
+    u32 count = 0;
+    pthread_mutex_lock(&w->lock);
+    atomic_store(&w->changed, false);
+    for (u32 i = 0; i < w->file_count; i++) {
+        if (w->files[i].changed) {
+            w->files[i].changed = false;
+            paths[count++] = strdup(w->files[i].path);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    for (u32 i = 0; i < count; i++) {
+        changed(user, paths[i]);
+        free(paths[i]);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <pthread.h>
+#include <stdatomic.h>
+#include "util.h"
+
+// Files a watcher can keep an eye on at once.
+#define MAX_WATCHED_FILES 128
+
+typedef struct {
+    char *path; // as it was given to fileWatcherAdd
+    char *name; // last part of path
+    int wd;     // inotify watch of its directory
+    u32 refs;
+    bool changed;
+} WatchedFile;
+
+// Tells when files change on disk, through inotify. The directories of the
+// files are watched rather than the files, so a file replaced by a rename
+// (like most editors save) is still seen. A thread sleeps on the events, the
+// editor thread only checks an atomic flag when nothing changed.
+typedef struct {
+    int fd;
+    int quit_pipe[2];
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    WatchedFile files[MAX_WATCHED_FILES];
+    u32 file_count;
+    atomic_bool changed; // some file has changed set
+} FileWatcher;
+
+typedef void (*FileChangedFn)(void *user, const char *path);
+
+void fileWatcherInit(FileWatcher *w);
+void fileWatcherDestroy(FileWatcher *w);
+
+// A path added more than once is watched until it was removed as often.
+void fileWatcherAdd(FileWatcher *w, const char *path);
+void fileWatcherRemove(FileWatcher *w, const char *path);
+
+// Calls changed(user, path) for every file that changed since the last poll.
+// A file written several times in between is reported once.
+void fileWatcherPoll(FileWatcher *w, FileChangedFn changed, void *user);
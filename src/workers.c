@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include "workers.h"
+
+static JobSystem jobs;
+
+// Index of this thread's queue, -1 until a helper thread first makes a job
+static _Thread_local i32 thread_index = -1;
+
+//~ Deque
+
+// Returns false when the deque is full.
+static bool dequePush(JobDeque *d, Job *job) {
+	i64 b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+	i64 t = atomic_load_explicit(&d->top, memory_order_acquire);
+	if (b - t >= JOBS_PER_THREAD) {
+		return false;
+	}
+	atomic_store_explicit(&d->slots[b % JOBS_PER_THREAD], job, memory_order_relaxed);
+	atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+	return true;
+}
+
+static Job *dequePop(JobDeque *d) {
+	i64 b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	i64 t = atomic_load_explicit(&d->top, memory_order_relaxed);
+	if (t > b) {
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	Job *job = atomic_load_explicit(&d->slots[b % JOBS_PER_THREAD], memory_order_relaxed);
+	if (t == b) {
+		// The last job, a thief may be taking it too
+		if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+			job = NULL;
+		}
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+static Job *dequeSteal(JobDeque *d) {
+	i64 t = atomic_load_explicit(&d->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	i64 b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+	if (t >= b) {
+		return NULL;
+	}
+
+	Job *job = atomic_load_explicit(&d->slots[t % JOBS_PER_THREAD], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+		return NULL;
+	}
+	return job;
+}
+
+//~ Scheduling
+
+static u32 currentThread() {
+	if (thread_index < 0) {
+		u32 helper = atomic_fetch_add(&jobs.helper_count, 1);
+		if (helper >= JOB_HELPERS_MAX) {
+			LOG_ERROR("More than %d threads besides the workers make jobs", JOB_HELPERS_MAX);
+			exit(1);
+		}
+		thread_index = (i32)(WORKERS_MAX + helper);
+	}
+	return (u32)thread_index;
+}
+
+// Own deque first, then steal from every other one, starting next to ours
+static Job *findJob(u32 self) {
+	Job *job = dequePop(&jobs.queues[self].deque);
+	if (!job) {
+		u32 helpers = MIN(atomic_load(&jobs.helper_count), JOB_HELPERS_MAX);
+		u32 count = jobs.thread_count + helpers;
+		u32 start = self < WORKERS_MAX ? self : jobs.thread_count + (self - WORKERS_MAX);
+		for (u32 i = 1; i < count && !job; i++) {
+			u32 k = (start + i) % count;
+			u32 victim = k < jobs.thread_count ? k : WORKERS_MAX + (k - jobs.thread_count);
+			job = dequeSteal(&jobs.queues[victim].deque);
+		}
+	}
+	if (job) {
+		atomic_fetch_sub(&jobs.queued, 1);
+	}
+	return job;
+}
+
+static void runJob(Job *job);
+
+static void pushJob(Job *job) {
+	if (!dequePush(&jobs.queues[currentThread()].deque, job)) {
+		// Full, run it right here instead
+		runJob(job);
+		return;
+	}
+
+	// Sleepers count themselves before checking for queued jobs, so either
+	// they see this job or we see them
+	atomic_fetch_add(&jobs.queued, 1);
+	if (atomic_load(&jobs.sleepers) > 0) {
+		pthread_mutex_lock(&jobs.lock);
+		pthread_cond_signal(&jobs.work_ready);
+		pthread_mutex_unlock(&jobs.lock);
+	}
+}
+
+static void unblockJob(Job *job) {
+	if (atomic_fetch_sub(&job->blockers, 1) == 1) {
+		pushJob(job);
+	}
+}
+
+static void finishJob(Job *job) {
+	// Once it's finished the job may be recycled, read it first
+	Job *parent = job->parent;
+	u32 dependent_count = job->dependent_count;
+	Job *dependents[JOB_DEPENDENTS_MAX];
+	memcpy(dependents, job->dependents, dependent_count * sizeof(Job *));
+
+	if (atomic_fetch_sub(&job->unfinished, 1) != 1) {
+		return;
+	}
+	for (u32 i = 0; i < dependent_count; i++) {
+		unblockJob(dependents[i]);
+	}
+	if (parent) {
+		finishJob(parent);
+	}
+}
+
+static void runJob(Job *job) {
+	if (job->fn) {
+		JobTimingHook hook = atomic_load(&jobs.timing_hook);
+		f64 start = hook ? getTimeSeconds() : 0.0;
+		job->fn(job->arg);
+		if (hook) {
+			hook(job->tag, getTimeSeconds() - start);
+		}
+	}
+	finishJob(job);
+}
+
+static void *workerMain(void *arg) {
+	thread_index = (i32)(uintptr_t)arg;
+	u32 self = (u32)thread_index;
+
+	while (!atomic_load(&jobs.quit)) {
+		Job *job = findJob(self);
+		if (job) {
+			runJob(job);
+			continue;
+		}
+
+		pthread_mutex_lock(&jobs.lock);
+		atomic_fetch_add(&jobs.sleepers, 1);
+		while (atomic_load(&jobs.queued) == 0 && !atomic_load(&jobs.quit)) {
+			pthread_cond_wait(&jobs.work_ready, &jobs.lock);
+		}
+		atomic_fetch_sub(&jobs.sleepers, 1);
+		pthread_mutex_unlock(&jobs.lock);
+	}
+	return NULL;
+}
+
+//~ API
+
+void jobsInit(u32 thread_count) {
+	jobs.queues = (JobQueue *)calloc(JOB_THREADS_MAX, sizeof(JobQueue));
+	atomic_init(&jobs.helper_count, 0);
+	atomic_init(&jobs.queued, 0);
+	atomic_init(&jobs.sleepers, 0);
+	atomic_init(&jobs.quit, false);
+	atomic_init(&jobs.timing_hook, NULL);
+	pthread_mutex_init(&jobs.lock, NULL);
+	pthread_cond_init(&jobs.work_ready, NULL);
+
+	// Set before starting any worker, they all steal from each other
+	jobs.thread_count = MIN(thread_count, WORKERS_MAX);
+	for (u32 i = 0; i < jobs.thread_count; i++) {
+		if (pthread_create(&jobs.threads[i], NULL, workerMain, (void *)(uintptr_t)i) != 0) {
+			LOG_ERROR("Couldn't start worker thread %u of %u", i + 1, jobs.thread_count);
+			exit(1);
+		}
+	}
+}
+
+void jobsDestroy() {
+	pthread_mutex_lock(&jobs.lock);
+	atomic_store(&jobs.quit, true);
+	pthread_cond_broadcast(&jobs.work_ready);
+	pthread_mutex_unlock(&jobs.lock);
+
+	for (u32 i = 0; i < jobs.thread_count; i++) {
+		pthread_join(jobs.threads[i], NULL);
+	}
+	jobs.thread_count = 0;
+
+	pthread_cond_destroy(&jobs.work_ready);
+	pthread_mutex_destroy(&jobs.lock);
+	free(jobs.queues);
+	jobs.queues = NULL;
+}
+
+u32 jobsDefaultThreads() {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cores <= 1) {
+		return 0;
+	}
+	return (u32)MIN(cores - 1, WORKERS_MAX);
+}
+
+u32 jobsThreadCount() {
+	return jobs.thread_count;
+}
+
+void jobsSetTimingHook(JobTimingHook hook) {
+	atomic_store(&jobs.timing_hook, hook);
+}
+
+Job *jobCreate(JobFn fn, void *arg, u32 tag) {
+	JobQueue *queue = &jobs.queues[currentThread()];
+	Job *job = &queue->jobs[queue->next_job];
+	queue->next_job = (queue->next_job + 1) % JOBS_PER_THREAD;
+
+	// Only happens with JOBS_PER_THREAD jobs of this thread in flight
+	jobWait(job);
+
+	job->fn = fn;
+	job->arg = arg;
+	job->tag = tag;
+	job->parent = NULL;
+	job->dependent_count = 0;
+	atomic_store(&job->unfinished, 1);
+	atomic_store(&job->blockers, 1);
+	return job;
+}
+
+Job *jobCreateChild(Job *parent, JobFn fn, void *arg, u32 tag) {
+	Job *job = jobCreate(fn, arg, tag);
+	job->parent = parent;
+	atomic_fetch_add(&parent->unfinished, 1);
+	return job;
+}
+
+void jobAddDependency(Job *job, Job *dependency) {
+	if (dependency->dependent_count == JOB_DEPENDENTS_MAX) {
+		LOG_ERROR("A job can only have %d dependents", JOB_DEPENDENTS_MAX);
+		exit(1);
+	}
+	dependency->dependents[dependency->dependent_count++] = job;
+	atomic_fetch_add(&job->blockers, 1);
+}
+
+void jobRun(Job *job) {
+	unblockJob(job);
+}
+
+bool jobDone(Job *job) {
+	return atomic_load(&job->unfinished) == 0;
+}
+
+void jobWait(Job *job) {
+	u32 self = currentThread();
+	while (!jobDone(job)) {
+		Job *next = findJob(self);
+		if (next) {
+			runJob(next);
+		} else {
+			sched_yield();
+		}
+	}
+}
+
+void jobsRunBatch(JobFn fn, void *items, size_t stride, u32 count, u32 tag) {
+	// Waking threads isn't worth it for a single item
+	if (jobs.thread_count == 0 || count <= 1) {
+		for (u32 i = 0; i < count; i++) {
+			Job job = { .fn = fn, .arg = (u8 *)items + i * stride, .tag = tag };
+			atomic_init(&job.unfinished, 1);
+			runJob(&job);
+		}
+		return;
+	}
+
+	Job *batch = jobCreate(NULL, NULL, tag);
+	for (u32 i = 0; i < count; i++) {
+		jobRun(jobCreateChild(batch, fn, (u8 *)items + i * stride, tag));
+	}
+	jobRun(batch);
+	jobWait(batch);
+}
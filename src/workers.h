@@ -0,0 +1,104 @@
+#pragma once
+#include <pthread.h>
+#include <stdatomic.h>
+#include "util.h"
+
+// Upper bound on worker threads the job system starts.
+#define WORKERS_MAX 15
+
+// Threads besides the workers that make jobs and help run them while they
+// wait (the editor and render threads).
+#define JOB_HELPERS_MAX 4
+#define JOB_THREADS_MAX (WORKERS_MAX + JOB_HELPERS_MAX)
+
+// Jobs a thread can have in flight, the size of its deque and job ring.
+#define JOBS_PER_THREAD 256
+
+// Jobs that can depend on a single job.
+#define JOB_DEPENDENTS_MAX 8
+
+typedef void (*JobFn)(void *arg);
+
+// Called with the tag of every job and how long it ran, on the thread that
+// ran it. Lets the profiler attribute time to what submitted the work.
+typedef void (*JobTimingHook)(u32 tag, f64 seconds);
+
+typedef struct Job {
+	JobFn fn; // NULL for jobs that only group their children
+	void *arg;
+	u32 tag;
+
+	struct Job *parent;
+	atomic_int unfinished; // the job itself and its children still running
+	atomic_int blockers;   // dependencies still running, plus one until jobRun
+	struct Job *dependents[JOB_DEPENDENTS_MAX];
+	u32 dependent_count;
+} Job;
+
+// Chase-Lev deque. Its own thread pushes and pops at the bottom (newest
+// first, while the data is warm), other threads steal from the top.
+typedef struct {
+	_Atomic(i64) top;
+	_Atomic(i64) bottom;
+	_Atomic(Job *) slots[JOBS_PER_THREAD];
+} JobDeque;
+
+typedef struct {
+	JobDeque deque;
+	Job jobs[JOBS_PER_THREAD]; // ring the thread's jobs are made in
+	u32 next_job;
+} JobQueue;
+
+// Work-stealing job system shared by everything that has work to spread over
+// the cores. Every thread that makes jobs gets a deque, idle workers steal
+// from the others and sleep when there is nothing left anywhere.
+typedef struct {
+	pthread_t threads[WORKERS_MAX];
+	u32 thread_count;
+
+	// Workers first, then the helper threads in the order they showed up
+	JobQueue *queues;
+	atomic_uint helper_count;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_ready;
+	atomic_int queued;   // jobs sitting in deques
+	atomic_int sleepers; // workers waiting on work_ready
+	atomic_bool quit;
+
+	_Atomic(JobTimingHook) timing_hook;
+} JobSystem;
+
+// The job system is a global like the profiler: the renderer, the font atlas
+// and the browser all submit to the same workers. Starts thread_count
+// workers (clamped to WORKERS_MAX), call before submitting anything.
+void jobsInit(u32 thread_count);
+void jobsDestroy();
+
+// One worker per core, minus the thread submitting the work.
+u32 jobsDefaultThreads();
+u32 jobsThreadCount();
+
+void jobsSetTimingHook(JobTimingHook hook);
+
+// Makes a job, it runs once jobRun was called and its dependencies are done.
+// Every job made must be run. Jobs are recycled from the making thread's
+// ring, so a job is only valid until that thread made JOBS_PER_THREAD more.
+Job *jobCreate(JobFn fn, void *arg, u32 tag);
+
+// A job the parent waits for: the parent only finishes after its children.
+// Make children before the parent finishes (before running it, or from it).
+Job *jobCreateChild(Job *parent, JobFn fn, void *arg, u32 tag);
+
+// The job won't start before dependency finished. Call before running either.
+void jobAddDependency(Job *job, Job *dependency);
+
+void jobRun(Job *job);
+bool jobDone(Job *job);
+
+// Runs other jobs (this thread's first) until the job has finished.
+void jobWait(Job *job);
+
+// Calls fn on each of the count items (stride bytes apart) and returns once
+// all of them are done, running some of them on the calling thread.
+void jobsRunBatch(JobFn fn, void *items, size_t stride, u32 count, u32 tag);